@@ -0,0 +1,332 @@
+#include "config.h"
+
+#include "bmc_boot_timing.hpp"
+
+#include "event_loop_stats.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/exception.hpp>
+
+#include <algorithm>
+#include <set>
+#include <variant>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
+constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
+constexpr auto SYSTEMD_INTERFACE = "org.freedesktop.systemd1.Manager";
+constexpr auto SYSTEMD_PRP_INTERFACE = "org.freedesktop.DBus.Properties";
+constexpr auto SYSTEMD_UNIT_INTERFACE = "org.freedesktop.systemd1.Unit";
+
+constexpr auto BOOT_TIMING_INTERFACE =
+    "xyz.openbmc_project.State.BMC.BootTiming";
+
+// Guard against dependency loops, real chains are far shorter than this
+constexpr size_t MAX_CHAIN_LENGTH = 64;
+
+// Bounds the calls made for one boot, the chain itself and what it waited
+// on are a small part of what's loaded
+constexpr size_t MAX_UNITS_READ = 256;
+
+BootTiming::BootTiming(sdbusplus::bus::bus& bus, const std::string& objPath,
+                       const std::string& target) :
+    bus(bus),
+    target(target), timingIntf(bus, objPath, BOOT_TIMING_INTERFACE)
+{
+    timingIntf.addProperty<uint64_t>("TotalMs", [this]() { return totalMs; });
+    timingIntf.addProperty<uint64_t>("UserspaceMs",
+                                     [this]() { return userspaceMs; });
+    timingIntf.addProperty<std::vector<std::string>>(
+        "CriticalChain", [this]() { return criticalChain; });
+    timingIntf.addProperty<std::vector<std::tuple<std::string, uint64_t>>>(
+        "SlowestUnits", [this]() { return slowestUnits; });
+
+    getPropertyAsync(SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE,
+                     "UserspaceTimestampMonotonic",
+                     [this](sdbusplus::message::message& reply) {
+                         std::variant<uint64_t> value;
+                         reply.read(value);
+                         userspaceStart = std::get<uint64_t>(value);
+                     });
+
+    // Only loaded units have timestamps, so this is also every unit worth
+    // reading, and saves a GetUnit for each
+    auto method = bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
+                                      SYSTEMD_INTERFACE, "ListUnits");
+    callAsync(method, [this](sdbusplus::message::message& reply) {
+        std::vector<std::tuple<std::string, std::string, std::string,
+                               std::string, std::string, std::string,
+                               sdbusplus::message::object_path, uint32_t,
+                               std::string, sdbusplus::message::object_path>>
+            units;
+        reply.read(units);
+        for (auto& unit : units)
+        {
+            unitPaths.emplace(std::move(std::get<0>(unit)),
+                              std::move(std::get<6>(unit).str));
+        }
+    });
+
+    // Neither call could be sent, publish what there is
+    if (calls.empty())
+    {
+        walk();
+    }
+}
+
+void BootTiming::callAsync(sdbusplus::message::message& method,
+                           ReplyHandler handler)
+{
+    auto& call = calls.emplace_back(this, std::move(handler));
+
+    sd_bus_slot* slot = nullptr;
+    auto r = sd_bus_call_async(bus.get(), &slot, method.get(), onReply, &call,
+                               0);
+    if (r < 0)
+    {
+        error("Failed to call systemd for boot timing: {ERRNO}", "ERRNO", -r);
+        calls.pop_back();
+        return;
+    }
+    call.slot.reset(slot);
+}
+
+void BootTiming::getPropertyAsync(const std::string& path, const char* iface,
+                                  const char* property, ReplyHandler handler)
+{
+    auto method = bus.new_method_call(SYSTEMD_SERVICE, path.c_str(),
+                                      SYSTEMD_PRP_INTERFACE, "Get");
+    method.append(iface, property);
+    callAsync(method, std::move(handler));
+}
+
+int BootTiming::onReply(sd_bus_message* msg, void* userdata,
+                        sd_bus_error* /*error*/)
+{
+    eventloop::Scope scope{"bmc.BootTiming"};
+
+    auto call = static_cast<Call*>(userdata);
+    auto timing = call->timing;
+
+    if (sd_bus_message_is_method_error(msg, nullptr))
+    {
+        // Units which are not loaded have no timestamps, skip them
+        debug("Boot timing call failed: {ERROR}", "ERROR",
+              sd_bus_message_get_error(msg)->name);
+    }
+    else
+    {
+        try
+        {
+            sdbusplus::message::message reply{msg};
+            call->handler(reply);
+        }
+        catch (const sdbusplus::exception::exception& e)
+        {
+            error("Failed reading boot timing reply: {ERROR}", "ERROR", e);
+        }
+    }
+
+    // The slot is held by sd-bus until the callback returns
+    timing->calls.remove_if(
+        [call](const auto& pending) { return &pending == call; });
+
+    // Each batch of calls is waited for before the walk moves on
+    if (timing->calls.empty())
+    {
+        timing->walk();
+    }
+
+    return 0;
+}
+
+void BootTiming::readUnitTimes(const std::string& unit)
+{
+    auto path = unitPaths.find(unit);
+    if ((path == unitPaths.end()) || (unitTimes.size() >= MAX_UNITS_READ))
+    {
+        unitTimes.emplace(unit, std::nullopt);
+        return;
+    }
+
+    unitTimes.emplace(unit, UnitTimes{});
+
+    // The map doesn't move its entries, so the handlers can hold on to it
+    auto& times = *unitTimes[unit];
+    getPropertyAsync(path->second, SYSTEMD_UNIT_INTERFACE,
+                     "InactiveExitTimestampMonotonic",
+                     [&times](sdbusplus::message::message& reply) {
+                         std::variant<uint64_t> value;
+                         reply.read(value);
+                         times.activating = std::get<uint64_t>(value);
+                     });
+    getPropertyAsync(path->second, SYSTEMD_UNIT_INTERFACE,
+                     "ActiveEnterTimestampMonotonic",
+                     [&times](sdbusplus::message::message& reply) {
+                         std::variant<uint64_t> value;
+                         reply.read(value);
+                         times.active = std::get<uint64_t>(value);
+                     });
+    getPropertyAsync(path->second, SYSTEMD_UNIT_INTERFACE, "After",
+                     [&times](sdbusplus::message::message& reply) {
+                         std::variant<std::vector<std::string>> value;
+                         reply.read(value);
+                         times.after = std::move(
+                             std::get<std::vector<std::string>>(value));
+                     });
+}
+
+void BootTiming::walk()
+{
+    // Anything not read yet stops the walk there, and is read for the
+    // next pass
+    static const std::optional<UnitTimes> unread;
+    std::vector<std::string> missing;
+    auto chain = findCriticalChain(
+        target,
+        [this, &missing](const std::string& unit) -> const auto& {
+            auto it = unitTimes.find(unit);
+            if (it == unitTimes.end())
+            {
+                missing.push_back(unit);
+                return unread;
+            }
+            return it->second;
+        });
+
+    for (const auto& unit : missing)
+    {
+        if (!unitTimes.contains(unit))
+        {
+            readUnitTimes(unit);
+        }
+    }
+
+    // Nothing left to read, or nothing that could be
+    if (calls.empty())
+    {
+        criticalChain = std::move(chain);
+        publish();
+    }
+}
+
+void BootTiming::publish()
+{
+    const auto& targetTimes = unitTimes[target];
+    if (targetTimes)
+    {
+        totalMs = targetTimes->active / 1000;
+        if ((userspaceStart != 0) && (targetTimes->active > userspaceStart))
+        {
+            userspaceMs = (targetTimes->active - userspaceStart) / 1000;
+        }
+        slowestUnits = findSlowestUnits(unitTimes, BOOT_TIMING_TOP_UNITS);
+    }
+    else
+    {
+        criticalChain.clear();
+    }
+
+    info("BMC reached {TARGET} in {TOTAL_MS}ms, userspace {USERSPACE_MS}ms, "
+         "critical chain of {CHAIN_LENGTH} units from {UNITS} read",
+         "TARGET", target, "TOTAL_MS", totalMs, "USERSPACE_MS", userspaceMs,
+         "CHAIN_LENGTH", criticalChain.size(), "UNITS", unitTimes.size());
+
+    timingIntf.emitAdded();
+}
+
+std::vector<std::string>
+    BootTiming::findCriticalChain(const std::string& target,
+                                  const UnitTimesLookup& getTimes)
+{
+    std::vector<std::string> chain;
+    std::set<std::string> visited;
+    std::string unit = target;
+
+    while (chain.size() < MAX_CHAIN_LENGTH)
+    {
+        chain.push_back(unit);
+        visited.insert(unit);
+
+        const auto& times = getTimes(unit);
+        if (!times)
+        {
+            break;
+        }
+
+        // The next link is the dependency that became active last before
+        // this unit started activating, it is what this unit waited on
+        std::string next;
+        uint64_t nextActive = 0;
+        for (const auto& dep : times->after)
+        {
+            if (visited.contains(dep))
+            {
+                continue;
+            }
+
+            const auto& depTimes = getTimes(dep);
+            if (!depTimes || (depTimes->active == 0))
+            {
+                continue;
+            }
+
+            if ((times->activating != 0) &&
+                (depTimes->active > times->activating))
+            {
+                continue;
+            }
+
+            if (depTimes->active > nextActive)
+            {
+                next = dep;
+                nextActive = depTimes->active;
+            }
+        }
+
+        if (next.empty())
+        {
+            break;
+        }
+        unit = next;
+    }
+
+    return chain;
+}
+
+std::vector<std::tuple<std::string, uint64_t>>
+    BootTiming::findSlowestUnits(const UnitTimesMap& times, size_t count)
+{
+    std::vector<std::tuple<std::string, uint64_t>> slowest;
+    for (const auto& [unit, unitTimes] : times)
+    {
+        if (!unitTimes || (unitTimes->activating == 0) ||
+            (unitTimes->active < unitTimes->activating))
+        {
+            continue;
+        }
+        slowest.emplace_back(
+            unit, (unitTimes->active - unitTimes->activating) / 1000);
+    }
+
+    count = std::min(slowest.size(), count);
+    std::partial_sort(slowest.begin(), slowest.begin() + count, slowest.end(),
+                      [](const auto& a, const auto& b) {
+                          return std::get<1>(a) > std::get<1>(b);
+                      });
+    slowest.resize(count);
+
+    return slowest;
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
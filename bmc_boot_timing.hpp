@@ -0,0 +1,182 @@
+#pragma once
+
+#include "property_interface.hpp"
+
+#include <systemd/sd-bus.h>
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/message.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class BootTiming
+ *  @brief Time the BMC took to reach its standby target
+ *  @details Reads the activation timestamps systemd keeps for each unit,
+ *  walks the critical chain back from the standby target the same way
+ *  systemd-analyze critical-chain does, and publishes the result on the
+ *  BMC object.
+ *
+ *  Every call to systemd is asynchronous, so the event loop keeps running
+ *  while the timing is gathered. The unit paths come from a single
+ *  ListUnits, and each step of the walk reads the units it's missing all
+ *  at once. The interface is put on D-Bus once the walk is done.
+ */
+class BootTiming
+{
+  public:
+    BootTiming() = delete;
+    BootTiming(const BootTiming&) = delete;
+    BootTiming& operator=(const BootTiming&) = delete;
+    BootTiming(BootTiming&&) = delete;
+    BootTiming& operator=(BootTiming&&) = delete;
+    ~BootTiming() = default;
+
+    /** @brief Starts gathering the boot timing, it's put on D-Bus once
+     *  systemd has answered
+     *
+     * @param[in] bus       - The Dbus bus object
+     * @param[in] objPath   - The BMC Dbus object path
+     * @param[in] target    - The target the BMC is Ready at
+     */
+    BootTiming(sdbusplus::bus::bus& bus, const std::string& objPath,
+               const std::string& target);
+
+    /** @brief Activation timestamps of a unit, CLOCK_MONOTONIC usec */
+    struct UnitTimes
+    {
+        uint64_t activating = 0;
+        uint64_t active = 0;
+        std::vector<std::string> after;
+    };
+
+    /** @brief Timestamps by unit, nullopt for units that aren't loaded */
+    using UnitTimesMap = std::map<std::string, std::optional<UnitTimes>>;
+
+    /** @brief Return the timestamps of a unit, nullopt if it isn't loaded */
+    using UnitTimesLookup =
+        std::function<const std::optional<UnitTimes>&(const std::string&)>;
+
+    /** @brief Walk the critical chain back from a target
+     *
+     * Each link is the After= dependency that became active last before
+     * the unit before it started activating.
+     *
+     * @param[in] target   - The unit to start from
+     * @param[in] getTimes - Looks up the timestamps of a unit
+     *
+     * @return The units on the chain, the target first
+     */
+    static std::vector<std::string>
+        findCriticalChain(const std::string& target,
+                          const UnitTimesLookup& getTimes);
+
+    /** @brief Return the slowest units to activate, slowest first
+     *
+     * @param[in] times - The timestamps of the units to pick from
+     * @param[in] count - How many to return at most
+     *
+     * @return The units and their activation time in ms
+     */
+    static std::vector<std::tuple<std::string, uint64_t>>
+        findSlowestUnits(const UnitTimesMap& times, size_t count);
+
+  private:
+    /** @brief Handles a reply, only called for successful ones */
+    using ReplyHandler = std::function<void(sdbusplus::message::message&)>;
+
+    /** @brief A call to systemd awaiting its reply */
+    struct Call
+    {
+        BootTiming* timing;
+        ReplyHandler handler;
+        std::unique_ptr<sd_bus_slot, decltype(&sd_bus_slot_unref)> slot{
+            nullptr, sd_bus_slot_unref};
+    };
+
+    /** @brief Call systemd without waiting for the reply
+     *
+     * @param[in] method  - The method call
+     * @param[in] handler - Handles the reply
+     */
+    void callAsync(sdbusplus::message::message& method, ReplyHandler handler);
+
+    /** @brief Read a systemd property without waiting for the reply
+     *
+     * @param[in] path     - The object path
+     * @param[in] iface    - The property's interface
+     * @param[in] property - The property
+     * @param[in] handler  - Handles the reply, a variant of the property
+     */
+    void getPropertyAsync(const std::string& path, const char* iface,
+                          const char* property, ReplyHandler handler);
+
+    /** @brief sd-bus callback for every reply */
+    static int onReply(sd_bus_message* msg, void* userdata,
+                       sd_bus_error* error);
+
+    /** @brief Start reading a unit's timestamps
+     *
+     * @param[in] unit - The systemd unit
+     */
+    void readUnitTimes(const std::string& unit);
+
+    /** @brief Walk the chain as far as the timestamps read so far go, and
+     *  read the units it's missing, or publish the timing if there are none
+     */
+    void walk();
+
+    /** @brief Put the timing on D-Bus */
+    void publish();
+
+    /** @brief The Dbus bus object */
+    sdbusplus::bus::bus& bus;
+
+    /** @brief The D-Bus object path of each loaded unit */
+    std::map<std::string, std::string> unitPaths;
+
+    /** @brief The target the BMC is Ready at */
+    const std::string target;
+
+    /** @brief Timestamps of every unit looked at */
+    UnitTimesMap unitTimes;
+
+    /** @brief Calls awaiting their reply */
+    std::list<Call> calls;
+
+    /** @brief When userspace started, CLOCK_MONOTONIC usec */
+    uint64_t userspaceStart = 0;
+
+    /** @brief Time from kernel start until the target was active */
+    uint64_t totalMs = 0;
+
+    /** @brief Time from userspace start until the target was active */
+    uint64_t userspaceMs = 0;
+
+    /** @brief Units on the critical chain, the target first */
+    std::vector<std::string> criticalChain;
+
+    /** @brief Slowest units to activate, and their activation time in ms */
+    std::vector<std::tuple<std::string, uint64_t>> slowestUnits;
+
+    /** @brief The boot timing D-Bus interface */
+    PropertyInterface timingIntf;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
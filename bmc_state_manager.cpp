@@ -1,19 +1,24 @@
 #include "bmc_state_manager.hpp"
 
+#include "state_machine.hpp"
 #include "utils.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 
 #include <gpiod.h>
-#include <sys/sysinfo.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/exception.hpp>
 
-#include <cassert>
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <system_error>
 
 namespace phosphor
 {
@@ -36,8 +41,10 @@ constexpr auto signalDone = "done";
 constexpr auto activeState = "active";
 
 /* Map a transition to it's systemd target */
-const std::map<server::BMC::Transition, const char*> SYSTEMD_TABLE = {
-    {server::BMC::Transition::Reboot, "reboot.target"}};
+using BMCTarget = sm::Target<server::BMC::Transition>;
+constexpr std::array SYSTEMD_TABLE = {
+    BMCTarget{server::BMC::Transition::Reboot, "reboot.target"}};
+static_assert(sm::validTargets(SYSTEMD_TABLE));
 
 constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
 constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
@@ -107,6 +114,7 @@ void BMC::discoverInitialState()
     {
         info("Setting the BMCState field to BMC_READY");
         this->currentBMCState(BMCState::Ready);
+        publishBootTiming();
     }
     else
     {
@@ -119,12 +127,9 @@ void BMC::discoverInitialState()
 
 void BMC::subscribeToSystemdSignals()
 {
-    auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
-                                            SYSTEMD_INTERFACE, "Subscribe");
-
     try
     {
-        this->bus.call(method);
+        utils::subscribeToSystemdSignals(this->bus);
     }
     catch (const sdbusplus::exception::exception& e)
     {
@@ -155,12 +160,10 @@ void BMC::executeTransition(const Transition tranReq)
     else
     {
         // Check to make sure it can be found
-        auto iter = SYSTEMD_TABLE.find(tranReq);
-        if (iter == SYSTEMD_TABLE.end())
+        auto sysdUnit = std::string{sm::findTarget(SYSTEMD_TABLE, tranReq)};
+        if (sysdUnit.empty())
             return;
 
-        const auto& sysdUnit = iter->second;
-
         auto method = this->bus.new_method_call(
             SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE, "StartUnit");
         // The only valid transition is reboot and that
@@ -170,7 +173,12 @@ void BMC::executeTransition(const Transition tranReq)
 
         try
         {
-            this->bus.call(method);
+            auto start = probes::now();
+            auto reply = this->bus.call(method);
+            sdbusplus::message::object_path job;
+            reply.read(job);
+            STATE_PROBE(job_start, probes::BMC, instance, sysdUnit.c_str(),
+                        job.str.c_str(), probes::now() - start);
         }
         catch (const sdbusplus::exception::exception& e)
         {
@@ -190,49 +198,75 @@ int BMC::bmcStateChange(sdbusplus::message::message& msg)
 
     // Read the msg and populate each variable
     msg.read(newStateID, newStateObjPath, newStateUnit, newStateResult);
+    STATE_PROBE(job_removed, probes::BMC, instance, newStateUnit.c_str(),
+                newStateObjPath.str.c_str(), newStateResult.c_str());
+
+    using BMCRule = sm::Rule<BMC, BMCState>;
+    static constexpr auto machine = sm::makeEngine(
+        &BMC::currentBMCState, nullptr,
+        {BMCRule{.event = obmcQuiesceTarget,
+                 .result = signalDone,
+                 .state = BMCState::Quiesced,
+                 .action = &BMC::bmcQuiesced},
+         // Caught the signal that indicates the BMC is now BMC_READY
+         BMCRule{.event = obmcStandbyTarget,
+                 .result = signalDone,
+                 .state = BMCState::Ready,
+                 .action = &BMC::bmcReady}});
+    static_assert(machine.valid());
+
+    machine.dispatch(*this, newStateUnit, newStateResult);
 
-    if ((newStateUnit == obmcQuiesceTarget) && (newStateResult == signalDone))
-    {
-        error("BMC has entered BMC_QUIESCED state");
-        this->currentBMCState(BMCState::Quiesced);
+    return 0;
+}
 
-        // There is no getting out of Quiesced once entered (other then BMC
-        // reboot) so stop watching for signals
-        auto method =
-            this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
-                                      SYSTEMD_INTERFACE, "Unsubscribe");
+void BMC::bmcQuiesced()
+{
+    error("BMC has entered BMC_QUIESCED state");
 
-        try
-        {
-            this->bus.call(method);
-            this->stateSignal.release();
-        }
-        catch (const sdbusplus::exception::exception& e)
-        {
-            info("Error in Unsubscribe: {ERROR}", "ERROR", e);
-        }
+    // There is no getting out of Quiesced once entered (other then BMC
+    // reboot) so stop watching for signals. The subscription is shared
+    // with any other manager on this bus, who may still need it.
+    try
+    {
+        utils::unsubscribeFromSystemdSignals(this->bus);
+        this->stateSignal.release();
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        info("Error in Unsubscribe: {ERROR}", "ERROR", e);
+    }
 
-        // disable the system state change object as well
-        stateSignal.reset();
+    // disable the system state change object as well
+    stateSignal.reset();
+}
 
-        return 0;
-    }
+void BMC::bmcReady()
+{
+    info("BMC_READY");
+    publishBootTiming();
+}
 
-    // Caught the signal that indicates the BMC is now BMC_READY
-    if ((newStateUnit == obmcStandbyTarget) && (newStateResult == signalDone))
+void BMC::publishBootTiming()
+{
+    // Timestamps only change on a BMC reboot so only gather them once
+    if (bootTiming)
     {
-        info("BMC_READY");
-        this->currentBMCState(BMCState::Ready);
+        return;
     }
 
-    return 0;
+    bootTiming =
+        std::make_unique<BootTiming>(this->bus, objPath, obmcStandbyTarget);
 }
 
 BMC::Transition BMC::requestedBMCTransition(Transition value)
 {
+    eventloop::Scope scope{"bmc.RequestedBMCTransition"};
     info("Setting the RequestedBMCTransition field to "
          "{REQUESTED_BMC_TRANSITION}",
          "REQUESTED_BMC_TRANSITION", value);
+    STATE_PROBE(transition_request, probes::BMC, instance,
+                convertForMessage(value).c_str());
 
     executeTransition(value);
     return server::BMC::requestedBMCTransition(value);
@@ -244,7 +278,21 @@ BMC::BMCState BMC::currentBMCState(BMCState value)
     info("Setting the BMCState field to {CURRENT_BMC_STATE}",
          "CURRENT_BMC_STATE", value);
 
-    return server::BMC::currentBMCState(value);
+    auto start = probes::now();
+    auto previous = server::BMC::currentBMCState();
+    auto retVal = server::BMC::currentBMCState(value);
+    if (retVal != previous)
+    {
+        journalWriter.append(journal::Source::BMC,
+                             convertForMessage(previous),
+                             convertForMessage(retVal));
+    }
+    snapshotWriter.publish(&snapshot::Snapshot::bmc,
+                           {convertForMessage(retVal)});
+    STATE_PROBE(state_publish, probes::BMC, instance,
+                convertForMessage(previous).c_str(),
+                convertForMessage(retVal).c_str(), probes::now() - start);
+    return retVal;
 }
 
 BMC::RebootCause BMC::lastRebootCause(RebootCause value)
@@ -255,19 +303,83 @@ BMC::RebootCause BMC::lastRebootCause(RebootCause value)
     return server::BMC::lastRebootCause(value);
 }
 
-uint64_t BMC::lastRebootTime() const
+BMC::~BMC()
+{
+    timeChangeSource.reset();
+    if (timeFd != -1)
+    {
+        close(timeFd);
+    }
+}
+
+void BMC::updateLastRebootTime()
 {
     using namespace std::chrono;
-    struct sysinfo info;
+    timespec realTime{};
+    timespec bootTime{};
+
+    // Read the clocks back to back, boottime includes time spent suspended
+    // so the difference is the epoch time of the reboot
+    if ((clock_gettime(CLOCK_REALTIME, &realTime) != 0) ||
+        (clock_gettime(CLOCK_BOOTTIME, &bootTime) != 0))
+    {
+        auto eno = errno;
+        error("Failed to read clocks for LastRebootTime, errno: {ERRNO}",
+              "ERRNO", eno);
+        return;
+    }
+
+    auto toDuration = [](const timespec& ts) {
+        return seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec);
+    };
+    auto rebootTime = duration_cast<milliseconds>(toDuration(realTime) -
+                                                  toDuration(bootTime));
+
+    // The setter only emits PropertiesChanged if the value moved
+    server::BMC::lastRebootTime(rebootTime.count());
+}
+
+void BMC::monitorTimeChanges()
+{
+    // Choose the MAX time that is possible to avoid mis fires.
+    constexpr itimerspec maxTime = {
+        {0, 0},          // it_interval
+        {TIME_T_MAX, 0}, // it_value
+    };
+
+    timeFd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timeFd == -1)
+    {
+        auto eno = errno;
+        error("Failed to create timerfd, errno: {ERRNO}", "ERRNO", eno);
+        throw std::system_error(eno, std::system_category());
+    }
+
+    // The read of a TFD_TIMER_CANCEL_ON_SET timer fails with ECANCELED when
+    // the realtime clock undergoes a discontinuous change
+    auto r = timerfd_settime(
+        timeFd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &maxTime, nullptr);
+    if (r != 0)
+    {
+        auto eno = errno;
+        error("Failed to set timerfd, errno: {ERRNO}", "ERRNO", eno);
+        throw std::system_error(eno, std::system_category());
+    }
 
-    auto rc = sysinfo(&info);
-    assert(rc == 0);
+    timeChangeSource = std::make_unique<sdeventplus::source::IO>(
+        sdeventplus::Event::get_default(), timeFd, EPOLLIN,
+        eventloop::timed("bmc.TimeChange", [this](sdeventplus::source::IO&,
+                                                  int fd, uint32_t) {
+            std::array<char, 64> time{};
 
-    // Since uptime is in seconds, also get the current time in seconds.
-    auto now = time_point_cast<seconds>(system_clock::now());
-    auto rebootTime = now - seconds(info.uptime);
+            // We are not interested in the data here.
+            // So read until there is no new data here in the FD
+            while (read(fd, time.data(), time.max_size()) > 0)
+                ;
 
-    return duration_cast<milliseconds>(rebootTime.time_since_epoch()).count();
+            debug("BMC system time is changed");
+            updateLastRebootTime();
+        }));
 }
 
 void BMC::discoverLastRebootCause()
@@ -319,8 +431,8 @@ void BMC::discoverLastRebootCause()
 
         // Generate log telling user a pinhole reset has occurred
         const std::string errorMsg = "xyz.openbmc_project.State.PinholeReset";
-        phosphor::state::manager::utils::createError(
-            this->bus, errorMsg,
+        phosphor::state::manager::utils::queueError(
+            errorMsg,
             sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level::
                 Notice);
     }
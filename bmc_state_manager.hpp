@@ -1,12 +1,23 @@
 #pragma once
 
+#include "config.h"
+
+#include "bmc_boot_timing.hpp"
+#include "event_loop_stats.hpp"
+#include "state_journal.hpp"
+#include "state_probes.hpp"
+#include "state_snapshot.hpp"
 #include "xyz/openbmc_project/State/BMC/server.hpp"
 
 #include <linux/watchdog.h>
 
 #include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/io.hpp>
 
 #include <functional>
+#include <memory>
+#include <string>
 
 namespace phosphor
 {
@@ -40,9 +51,17 @@ class BMC : public BMCInherit
             sdbusRule::type::signal() + sdbusRule::member("JobRemoved") +
                 sdbusRule::path("/org/freedesktop/systemd1") +
                 sdbusRule::interface("org.freedesktop.systemd1.Manager"),
-            std::bind(std::mem_fn(&BMC::bmcStateChange), this,
-                      std::placeholders::_1)))
+            eventloop::timed(
+                "bmc.JobRemoved",
+                std::bind(std::mem_fn(&BMC::bmcStateChange), this,
+                          std::placeholders::_1)))),
+        objPath(objPath), snapshotWriter(STATE_SNAPSHOT_FILE),
+        journalWriter(sdeventplus::Event::get_default(), STATE_JOURNAL_FILE,
+                      STATE_JOURNAL_PERSIST_PATH, STATE_JOURNAL_ENTRIES),
+        instance(probes::instanceOf(objPath))
     {
+        monitorTimeChanges();
+        updateLastRebootTime();
         subscribeToSystemdSignals();
         discoverInitialState();
         discoverLastRebootCause();
@@ -55,15 +74,7 @@ class BMC : public BMCInherit
     /** @brief Set value of CurrentBMCState **/
     BMCState currentBMCState(BMCState value) override;
 
-    /** @brief Returns the last time the BMC was rebooted
-     *
-     *  @details Uses uptime information to determine when
-     *           the BMC was last rebooted.
-     *
-     *  @return uint64_t - Epoch time, in milliseconds, of the
-     *                     last reboot.
-     */
-    uint64_t lastRebootTime() const override;
+    ~BMC();
 
     /** @brief Set value of LastRebootCause **/
     RebootCause lastRebootCause(RebootCause value) override;
@@ -99,6 +110,12 @@ class BMC : public BMCInherit
      */
     int bmcStateChange(sdbusplus::message::message& msg);
 
+    /** @brief Stop watching systemd once the BMC is quiesced **/
+    void bmcQuiesced();
+
+    /** @brief Finish the BMC reaching Ready **/
+    void bmcReady();
+
     /** @brief Persistent sdbusplus DBus bus connection. **/
     sdbusplus::bus::bus& bus;
 
@@ -109,6 +126,49 @@ class BMC : public BMCInherit
      * @brief discover the last reboot cause of the bmc
      **/
     void discoverLastRebootCause();
+
+    /**
+     * @brief Set LastRebootTime from the realtime and boottime clocks
+     *
+     * The boot time doesn't change for a given boot, the epoch time of it
+     * only moves when the realtime clock is set. Computing it here rather
+     * than on every property read keeps the reads free of syscalls.
+     **/
+    void updateLastRebootTime();
+
+    /**
+     * @brief Watch for realtime clock changes to recompute LastRebootTime
+     **/
+    void monitorTimeChanges();
+
+    /** @brief The fd of the timer cancelled on realtime clock changes **/
+    int timeFd = -1;
+
+    /** @brief Event source for the realtime clock change timer **/
+    std::unique_ptr<sdeventplus::source::IO> timeChangeSource;
+
+    /**
+     * @brief gather and publish the boot timing once the BMC is Ready
+     *
+     * The calls to systemd are asynchronous, so this returns right away
+     * and the timing is put on D-Bus once they're answered.
+     **/
+    void publishBootTiming();
+
+    /** @brief The BMC Dbus object path **/
+    const std::string objPath;
+
+    /** @brief Time taken to reach Ready, published once it is reached **/
+    std::unique_ptr<BootTiming> bootTiming;
+
+    /** @brief Publishes the BMC state to the local state snapshot **/
+    snapshot::Writer snapshotWriter;
+
+    /** @brief Records BMC state changes **/
+    journal::Writer journalWriter;
+
+    /** @brief The BMC number, for probes **/
+    const uint32_t instance;
 };
 
 } // namespace manager
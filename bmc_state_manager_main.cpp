@@ -1,12 +1,21 @@
 #include "config.h"
 
 #include "bmc_state_manager.hpp"
+#include "event_loop_monitor.hpp"
+#include "startup_timing.hpp"
 
 #include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
 
 int main()
 {
+    namespace startup = phosphor::state::manager::startup;
+
+    startup::milestone("main");
+
+    auto event = sdeventplus::Event::get_default();
     auto bus = sdbusplus::bus::new_default();
+    startup::milestone("bus");
 
     // For now, we only have one instance of the BMC
     // 0 is for the current instance
@@ -16,14 +25,17 @@ int main()
     sdbusplus::server::manager::manager objManager(bus, objPathInst.c_str());
 
     phosphor::state::manager::BMC manager(bus, objPathInst.c_str());
+    phosphor::state::manager::eventloop::Monitor loopMonitor(bus, event,
+                                                             objPathInst);
+    startup::milestone("constructed");
 
     bus.request_name(BMC_BUSNAME);
+    startup::milestone(startup::READY);
 
-    while (true)
-    {
-        bus.process_discard();
-        bus.wait();
-    }
+    // Attach the bus to sd_event to service user requests and to get the
+    // realtime clock change notifications
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    event.loop();
 
-    exit(EXIT_SUCCESS);
+    return 0;
 }
@@ -1,5 +1,6 @@
 #include "config.h"
 
+#include "state_snapshot.hpp"
 #include "utils.hpp"
 
 #include <getopt.h>
@@ -12,6 +13,7 @@
 
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
 
 PHOSPHOR_LOG2_USING;
@@ -43,10 +45,23 @@ int main(int argc, char** argv)
 
     auto bus = sdbusplus::bus::new_default();
 
+    // Only the first chassis is in the state snapshot
+    namespace snapshot = phosphor::state::manager::snapshot;
+    std::optional<std::string> powerStatus;
+    if (chassisPath == std::string{CHASSIS_OBJPATH} + '0')
+    {
+        snapshot::Reader reader{STATE_SNAPSHOT_FILE};
+        powerStatus = reader.value(&snapshot::Snapshot::chassis,
+                                   snapshot::CurrentPowerStatus);
+    }
+
     // If the chassis power status is not good, log an error and exit with
     // a non-zero rc so the system does not power on
-    auto currentPowerStatus = phosphor::state::manager::utils::getProperty(
-        bus, chassisPath, CHASSIS_BUSNAME, "CurrentPowerStatus");
+    auto currentPowerStatus =
+        powerStatus ? *powerStatus
+                    : phosphor::state::manager::utils::getProperty(
+                          bus, chassisPath, CHASSIS_BUSNAME,
+                          "CurrentPowerStatus");
     if (currentPowerStatus !=
         "xyz.openbmc_project.State.Chassis.PowerStatus.Good")
     {
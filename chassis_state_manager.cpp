@@ -2,10 +2,14 @@
 
 #include "chassis_state_manager.hpp"
 
+#include "io_worker.hpp"
+#include "state_machine.hpp"
 #include "utils.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 #include "xyz/openbmc_project/State/Shutdown/Power/error.hpp"
 
+#include <time.h>
+
 #include <cereal/archives/json.hpp>
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
@@ -15,8 +19,12 @@
 #include <sdeventplus/exception.hpp>
 #include <xyz/openbmc_project/State/Decorator/PowerSystemInputs/server.hpp>
 
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
+#include <system_error>
 
 namespace phosphor
 {
@@ -34,6 +42,7 @@ namespace decoratorServer =
 
 using namespace phosphor::logging;
 using sdbusplus::xyz::openbmc_project::Common::Error::InternalFailure;
+using sdbusplus::xyz::openbmc_project::Common::Error::NotAllowed;
 using sdbusplus::xyz::openbmc_project::State::Shutdown::Power::Error::Blackout;
 using sdbusplus::xyz::openbmc_project::State::Shutdown::Power::Error::Regulator;
 constexpr auto CHASSIS_STATE_POWEROFF_TGT = "obmc-chassis-poweroff@0.target";
@@ -44,6 +53,31 @@ constexpr auto RESET_HOST_SENSORS_SVC =
     "phosphor-reset-sensor-states@0.service";
 
 constexpr auto ACTIVE_STATE = "active";
+constexpr uint64_t SECONDS_PER_HOUR = 3600;
+
+/* The persisted power on time, 'POH1' in host byte order */
+constexpr uint32_t POH_RECORD_MAGIC = 0x31484f50;
+constexpr uint16_t POH_RECORD_VERSION = 1;
+
+struct POHRecord
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t seconds;
+};
+static_assert(sizeof(POHRecord) == 16);
+
+/* CLOCK_BOOTTIME, which unlike CLOCK_MONOTONIC doesn't stop in suspend */
+static std::chrono::nanoseconds bootTime()
+{
+    struct timespec ts
+    {};
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return std::chrono::seconds{ts.tv_sec} +
+           std::chrono::nanoseconds{ts.tv_nsec};
+}
+
 constexpr auto ACTIVATING_STATE = "activating";
 
 // Details at https://upower.freedesktop.org/docs/Device.html
@@ -51,12 +85,15 @@ constexpr uint TYPE_UPS = 3;
 constexpr uint STATE_FULLY_CHARGED = 4;
 constexpr uint BATTERY_LVL_FULL = 8;
 
-/* Map a transition to it's systemd target */
-const std::map<server::Chassis::Transition, std::string> SYSTEMD_TARGET_TABLE =
-    {
-        // Use the hard off target to ensure we shutdown immediately
-        {server::Chassis::Transition::Off, CHASSIS_STATE_HARD_POWEROFF_TGT},
-        {server::Chassis::Transition::On, CHASSIS_STATE_POWERON_TGT}};
+/* Map a transition to it's systemd target, PowerCycle is chained from
+ * these two by the Chassis itself */
+using ChassisTarget = sm::Target<server::Chassis::Transition>;
+constexpr std::array SYSTEMD_TARGET_TABLE = {
+    // Use the hard off target to ensure we shutdown immediately
+    ChassisTarget{server::Chassis::Transition::Off,
+                  CHASSIS_STATE_HARD_POWEROFF_TGT},
+    ChassisTarget{server::Chassis::Transition::On, CHASSIS_STATE_POWERON_TGT}};
+static_assert(sm::validTargets(SYSTEMD_TARGET_TABLE));
 
 constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
 constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
@@ -77,9 +114,7 @@ void Chassis::subscribeToSystemdSignals()
 {
     try
     {
-        auto method = this->bus.new_method_call(
-            SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE, "Subscribe");
-        this->bus.call(method);
+        utils::subscribeToSystemdSignals(this->bus);
     }
     catch (const sdbusplus::exception::exception& e)
     {
@@ -101,7 +136,8 @@ void Chassis::determineInitialState()
         bus,
         sdbusplus::bus::match::rules::propertiesChangedNamespace(
             "/org/freedesktop/UPower", UPOWER_INTERFACE),
-        [this](auto& msg) { this->uPowerChangeEvent(msg); });
+        eventloop::timed("chassis.UPower",
+                         [this](auto& msg) { this->uPowerChangeEvent(msg); }));
 
     // Monitor for any properties changed signals on PowerSystemInputs
     powerSysInputsPropChangeSignal = std::make_unique<sdbusplus::bus::match_t>(
@@ -109,7 +145,9 @@ void Chassis::determineInitialState()
         sdbusplus::bus::match::rules::propertiesChangedNamespace(
             "/xyz/openbmc_project/power/power_supplies/chassis0/psus",
             POWERSYSINPUTS_INTERFACE),
-        [this](auto& msg) { this->powerSysInputsChangeEvent(msg); });
+        eventloop::timed("chassis.PowerSystemInputs", [this](auto& msg) {
+            this->powerSysInputsChangeEvent(msg);
+        }));
 
     determineStatusOfPower();
 
@@ -121,8 +159,16 @@ void Chassis::determineInitialState()
     method.append("org.openbmc.control.Power", "pgood");
     try
     {
-        auto reply = this->bus.call(method);
-        reply.read(pgood);
+        // The GPIO is the source of truth when it's being watched
+        if (powerGoodMonitor && (powerGoodMonitor->value() >= 0))
+        {
+            pgood = powerGoodMonitor->value();
+        }
+        else
+        {
+            auto reply = this->bus.call(method);
+            reply.read(pgood);
+        }
 
         if (std::get<int>(pgood) == 1)
         {
@@ -136,14 +182,11 @@ void Chassis::determineInitialState()
             // The system is off.  If we think it should be on then
             // we probably lost AC while up, so set a new state
             // change time.
-            uint64_t lastTime;
-            PowerState lastState;
-
-            if (deserializeStateChangeTime(lastTime, lastState))
+            if (persistedState)
             {
                 // If power was on before the BMC reboot and the reboot reason
                 // was not a pinhole reset, log an error
-                if (lastState == PowerState::On)
+                if (*persistedState == PowerState::On)
                 {
                     info(
                         "Chassis power was on before the BMC reboot and it is off now");
@@ -206,18 +249,110 @@ fail:
     return;
 }
 
+void Chassis::monitorPowerGpios()
+{
+    auto event = sdeventplus::Event::get_default();
+
+    try
+    {
+        powerGoodMonitor = std::make_unique<GpioEventMonitor>(
+            event, "power-good",
+            eventloop::timed("chassis.PowerGood",
+                             [this](bool value, uint64_t timeMs) {
+                                 this->powerGoodChange(value, timeMs);
+                             }));
+    }
+    catch (const std::runtime_error& e)
+    {
+        info("Not monitoring power-good GPIO: {ERROR}", "ERROR", e);
+    }
+
+    try
+    {
+        standbyFaultMonitor = std::make_unique<GpioEventMonitor>(
+            event, "regulator-standby-faulted",
+            eventloop::timed("chassis.StandbyFault",
+                             [this](bool value, uint64_t timeMs) {
+                                 this->standbyFaultChange(value, timeMs);
+                             }));
+    }
+    catch (const std::runtime_error& e)
+    {
+        info("Not monitoring regulator-standby-faulted GPIO: {ERROR}", "ERROR",
+             e);
+    }
+}
+
+void Chassis::powerGoodChange(bool value, uint64_t timeMs)
+{
+    info("Power-good GPIO changed to {VALUE} at {TIME_MS}", "VALUE", value,
+         "TIME_MS", timeMs);
+
+    if (value)
+    {
+        this->currentPowerState(server::Chassis::PowerState::On);
+        this->setStateChangeTime(timeMs);
+        return;
+    }
+
+    this->currentPowerState(server::Chassis::PowerState::Off);
+    this->setStateChangeTime(timeMs);
+
+    // Losing power-good outside of a power off means the power went away
+    // underneath us. Whoever asked for the power off, systemd has a job
+    // queued or running for one of the poweroff targets.
+    auto poweringOff =
+        !powerOffJobs.empty() || (powerCycleStage != PowerCycleStage::Idle) ||
+        pendingTransition.matches(convertForMessage(Transition::Off));
+    if (!poweringOff)
+    {
+        error("Chassis lost power-good while powered on");
+        if (standbyVoltageRegulatorFault())
+        {
+            report<Regulator>();
+        }
+        else
+        {
+            report<Blackout>(Entry::Level::Critical);
+        }
+    }
+}
+
+void Chassis::standbyFaultChange(bool value, uint64_t timeMs)
+{
+    if (value)
+    {
+        error("Standby voltage regulator fault at {TIME_MS}", "TIME_MS",
+              timeMs);
+        report<Regulator>();
+    }
+    else
+    {
+        info("Standby voltage regulator fault cleared at {TIME_MS}", "TIME_MS",
+             timeMs);
+    }
+}
+
 void Chassis::determineStatusOfPower()
 {
     // Default PowerStatus to good
     server::Chassis::currentPowerStatus(PowerStatus::Good);
 
     determineStatusOfUPSPower();
-    if (server::Chassis::currentPowerStatus() != PowerStatus::Good)
+    if (server::Chassis::currentPowerStatus() == PowerStatus::Good)
     {
-        return;
+        determineStatusOfPSUPower();
     }
 
-    determineStatusOfPSUPower();
+    publishSnapshot();
+}
+
+void Chassis::publishSnapshot()
+{
+    snapshotWriter.publish(
+        &snapshot::Snapshot::chassis,
+        {convertForMessage(server::Chassis::currentPowerState()),
+         convertForMessage(server::Chassis::currentPowerStatus())});
 }
 
 void Chassis::determineStatusOfUPSPower()
@@ -233,6 +368,7 @@ void Chassis::determineStatusOfUPSPower()
 
     try
     {
+        probes::MapperCall probe{"GetSubTree", UPOWER_INTERFACE};
         auto mapperResponseMsg = bus.call(mapper);
         mapperResponseMsg.read(mapperResponse);
     }
@@ -339,6 +475,7 @@ void Chassis::determineStatusOfPSUPower()
 
     try
     {
+        probes::MapperCall probe{"GetSubTree", POWERSYSINPUTS_INTERFACE};
         auto mapperResponseMsg = bus.call(mapper);
         mapperResponseMsg.read(mapperResponse);
     }
@@ -454,7 +591,7 @@ void Chassis::powerSysInputsChangeEvent(sdbusplus::message::message& msg)
     return;
 }
 
-void Chassis::startUnit(const std::string& sysdUnit)
+sdbusplus::message::object_path Chassis::startUnit(const std::string& sysdUnit)
 {
     auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
                                             SYSTEMD_INTERFACE, "StartUnit");
@@ -462,9 +599,45 @@ void Chassis::startUnit(const std::string& sysdUnit)
     method.append(sysdUnit);
     method.append("replace");
 
-    this->bus.call_noreply(method);
+    auto start = probes::now();
+    auto reply = this->bus.call(method);
+    sdbusplus::message::object_path job;
+    reply.read(job);
+    STATE_PROBE(job_start, probes::Chassis, instance, sysdUnit.c_str(),
+                job.str.c_str(), probes::now() - start);
 
-    return;
+    return job;
+}
+
+bool Chassis::admitTransition(Transition value)
+{
+    if (!pendingTransition.active())
+    {
+        return true;
+    }
+
+    auto request = convertForMessage(value);
+    if (pendingTransition.matches(request))
+    {
+        info("Chassis transition {REQ_POWER_TRAN} already in progress, "
+             "coalescing",
+             "REQ_POWER_TRAN", value);
+        return false;
+    }
+
+#ifdef ENABLE_TRANSITION_REJECT
+    if (value != Transition::Off)
+    {
+        error("Rejecting chassis transition {REQ_POWER_TRAN}, another is in "
+              "progress",
+              "REQ_POWER_TRAN", value);
+        throw NotAllowed();
+    }
+#endif
+
+    info("Chassis transition {REQ_POWER_TRAN} replaces the one in progress",
+         "REQ_POWER_TRAN", value);
+    return true;
 }
 
 bool Chassis::stateActive(const std::string& target)
@@ -511,6 +684,30 @@ bool Chassis::stateActive(const std::string& target)
            currentStateStr == ACTIVATING_STATE;
 }
 
+void Chassis::sysStateChangeJobNew(sdbusplus::message::message& msg)
+{
+    uint32_t newJobID{};
+    sdbusplus::message::object_path newJobObjPath;
+    std::string newJobUnit{};
+
+    try
+    {
+        msg.read(newJobID, newJobObjPath, newJobUnit);
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        error("Error in JobNew signal - bad encoding: {ERROR} {REPLY_SIG}",
+              "ERROR", e, "REPLY_SIG", msg.get_signature());
+        return;
+    }
+
+    if ((newJobUnit == CHASSIS_STATE_POWEROFF_TGT) ||
+        (newJobUnit == CHASSIS_STATE_HARD_POWEROFF_TGT))
+    {
+        powerOffJobs.insert(newJobObjPath.str);
+    }
+}
+
 int Chassis::sysStateChange(sdbusplus::message::message& msg)
 {
     sdbusplus::message::object_path newStateObjPath;
@@ -531,46 +728,107 @@ int Chassis::sysStateChange(sdbusplus::message::message& msg)
               "ERROR", e, "REPLY_SIG", msg.get_signature());
         return 0;
     }
+    STATE_PROBE(job_removed, probes::Chassis, instance, newStateUnit.c_str(),
+                newStateObjPath.str.c_str(), newStateResult.c_str());
 
-    if ((newStateUnit == CHASSIS_STATE_POWEROFF_TGT) &&
-        (newStateResult == "done") && (!stateActive(CHASSIS_STATE_POWERON_TGT)))
+    powerOffJobs.erase(newStateObjPath.str);
+
+    // A power cycle stays pending across its off and on jobs
+    if (powerCycleStage == PowerCycleStage::Idle)
+    {
+        pendingTransition.jobRemoved(newStateObjPath);
+    }
+
+    if ((newStateUnit == CHASSIS_STATE_HARD_POWEROFF_TGT) &&
+        (powerCycleStage == PowerCycleStage::PoweringOff))
     {
-        info("Received signal that power OFF is complete");
-        this->currentPowerState(server::Chassis::PowerState::Off);
-        this->setStateChangeTime();
+        powerCycleOffDone(newStateResult);
     }
     else if ((newStateUnit == CHASSIS_STATE_POWERON_TGT) &&
-             (newStateResult == "done") &&
-             (stateActive(CHASSIS_STATE_POWERON_TGT)))
+             (newStateResult != "done") &&
+             (powerCycleStage == PowerCycleStage::PoweringOn))
     {
-        info("Received signal that power ON is complete");
-        this->currentPowerState(server::Chassis::PowerState::On);
-        this->setStateChangeTime();
-
-        // Remove temporary file which is utilized for scenarios where the
-        // BMC is rebooted while the chassis power is still on.
-        // This file is used to indicate to chassis related systemd services
-        // that the chassis is already on and they should skip running.
-        // Once the chassis state is back to on we can clear this file.
-        auto size = std::snprintf(nullptr, 0, CHASSIS_ON_FILE, 0);
-        size++; // null
-        std::unique_ptr<char[]> chassisFile(new char[size]);
-        std::snprintf(chassisFile.get(), size, CHASSIS_ON_FILE, 0);
-        if (std::filesystem::exists(chassisFile.get()))
-        {
-            std::filesystem::remove(chassisFile.get());
-        }
+        error("Power cycle power on job failed: {RESULT}", "RESULT",
+              newStateResult);
+        cancelPowerCycle("the power on job did not complete");
     }
 
+    using ChassisRule = sm::Rule<Chassis, PowerState>;
+    static constexpr auto machine = sm::makeEngine(
+        &Chassis::currentPowerState, &Chassis::stateActive,
+        {ChassisRule{.event = CHASSIS_STATE_POWEROFF_TGT,
+                     .result = "done",
+                     .guard = {CHASSIS_STATE_POWERON_TGT,
+                               sm::Require::Inactive},
+                     .state = PowerState::Off,
+                     .action = &Chassis::chassisOff},
+         ChassisRule{.event = CHASSIS_STATE_POWERON_TGT,
+                     .result = "done",
+                     .guard = {CHASSIS_STATE_POWERON_TGT, sm::Require::Active},
+                     .state = PowerState::On,
+                     .action = &Chassis::chassisOn}});
+    static_assert(machine.valid());
+
+    machine.dispatch(*this, newStateUnit, newStateResult);
+
     return 0;
 }
 
+void Chassis::chassisOff()
+{
+    info("Received signal that power OFF is complete");
+    this->setStateChangeTime();
+}
+
+void Chassis::chassisOn()
+{
+    info("Received signal that power ON is complete");
+    this->setStateChangeTime();
+
+    // Remove temporary file which is utilized for scenarios where the
+    // BMC is rebooted while the chassis power is still on.
+    // This file is used to indicate to chassis related systemd services
+    // that the chassis is already on and they should skip running.
+    // Once the chassis state is back to on we can clear this file.
+    auto size = std::snprintf(nullptr, 0, CHASSIS_ON_FILE, 0);
+    size++; // null
+    std::unique_ptr<char[]> chassisFile(new char[size]);
+    std::snprintf(chassisFile.get(), size, CHASSIS_ON_FILE, 0);
+    if (std::filesystem::exists(chassisFile.get()))
+    {
+        std::filesystem::remove(chassisFile.get());
+    }
+}
+
 Chassis::Transition Chassis::requestedPowerTransition(Transition value)
 {
+    eventloop::Scope scope{"chassis.RequestedPowerTransition"};
 
     info("Change to Chassis Requested Power State: {REQ_POWER_TRAN}",
          "REQ_POWER_TRAN", value);
-    startUnit(SYSTEMD_TARGET_TABLE.find(value)->second);
+    STATE_PROBE(transition_request, probes::Chassis, instance,
+                convertForMessage(value).c_str());
+
+    if (!admitTransition(value))
+    {
+        return server::Chassis::requestedPowerTransition();
+    }
+
+    if (powerCycleStage != PowerCycleStage::Idle)
+    {
+        cancelPowerCycle("superseded by a new transition request");
+    }
+
+    if (value == Transition::PowerCycle)
+    {
+        startPowerCycle();
+    }
+    else
+    {
+        auto job = startUnit(
+            std::string{sm::findTarget(SYSTEMD_TARGET_TABLE, value)});
+        pendingTransition.start(convertForMessage(value), job);
+    }
     return server::Chassis::requestedPowerTransition(value);
 }
 
@@ -580,15 +838,162 @@ Chassis::PowerState Chassis::currentPowerState(PowerState value)
     info("Change to Chassis Power State: {CUR_POWER_STATE}", "CUR_POWER_STATE",
          value);
 
+    auto start = probes::now();
+
+    // Account for the time up to the change before the state changes
+    auto lastPowerState = server::Chassis::currentPowerState();
+    updatePOH();
+
     chassisPowerState = server::Chassis::currentPowerState(value);
     pohTimer.setEnabled(chassisPowerState == PowerState::On);
+    publishSnapshot();
+
+    if (chassisPowerState == PowerState::On)
+    {
+        if (!pohLastUpdate)
+        {
+            pohLastUpdate = bootTime();
+        }
+    }
+    else
+    {
+        pohLastUpdate.reset();
+    }
+
+    if (chassisPowerState != lastPowerState)
+    {
+        serializePOH();
+        journalWriter.append(journal::Source::Chassis,
+                             convertForMessage(lastPowerState),
+                             convertForMessage(chassisPowerState));
+    }
+    STATE_PROBE(state_publish, probes::Chassis, instance,
+                convertForMessage(lastPowerState).c_str(),
+                convertForMessage(chassisPowerState).c_str(),
+                probes::now() - start);
+
+    // Time the power cycle's off time from the power state itself, which
+    // comes from the power-good edge when that's being watched
+    if ((chassisPowerState == PowerState::Off) &&
+        (powerCycleStage == PowerCycleStage::PoweringOff) &&
+        !powerCycleOffTime)
+    {
+        powerCycleOffTime = std::chrono::steady_clock::now();
+    }
+    else if ((chassisPowerState == PowerState::On) &&
+             (powerCycleStage == PowerCycleStage::PoweringOn))
+    {
+        powerCycleComplete();
+    }
+
     return chassisPowerState;
 }
 
+void Chassis::startPowerCycle()
+{
+    powerCycleStage = PowerCycleStage::PoweringOff;
+    powerCycleOffTime.reset();
+
+    // Already off, so the off time starts now
+    if (server::Chassis::currentPowerState() == PowerState::Off)
+    {
+        powerCycleOffTime = std::chrono::steady_clock::now();
+    }
+
+    auto job = startUnit(CHASSIS_STATE_HARD_POWEROFF_TGT);
+    pendingTransition.start(convertForMessage(Transition::PowerCycle), job);
+}
+
+void Chassis::powerCycleOffDone(const std::string& result)
+{
+    using namespace std::chrono;
+
+    if (result != "done")
+    {
+        error("Power cycle power off job failed: {RESULT}", "RESULT", result);
+        cancelPowerCycle("the power off job did not complete");
+        return;
+    }
+
+    // The power state may not have been seen to change if nothing
+    // reported it, the job completing is the best there is then
+    auto now = steady_clock::now();
+    if (!powerCycleOffTime)
+    {
+        powerCycleOffTime = now;
+    }
+
+    auto minOff = milliseconds{CHASSIS_POWER_CYCLE_MIN_OFF};
+    auto elapsed = duration_cast<milliseconds>(now - *powerCycleOffTime);
+    auto remaining = (elapsed < minOff) ? (minOff - elapsed) : milliseconds{0};
+
+    info("Power cycle power off complete, powering on in {REMAINING_MS} ms",
+         "REMAINING_MS", remaining.count());
+
+    powerCycleStage = PowerCycleStage::OffDwell;
+    powerCycleTimer.restartOnce(remaining);
+}
+
+void Chassis::powerCycleOn()
+{
+    if (powerCycleStage != PowerCycleStage::OffDwell)
+    {
+        return;
+    }
+
+    powerCycleStage = PowerCycleStage::PoweringOn;
+    auto job = startUnit(CHASSIS_STATE_POWERON_TGT);
+    pendingTransition.start(convertForMessage(Transition::PowerCycle), job);
+}
+
+void Chassis::powerCycleComplete()
+{
+    using namespace std::chrono;
+
+    if (powerCycleOffTime)
+    {
+        lastPowerCycleOffTimeMs = duration_cast<milliseconds>(
+                                      steady_clock::now() - *powerCycleOffTime)
+                                      .count();
+        info("Power cycle complete, power was off for {OFF_TIME_MS} ms",
+             "OFF_TIME_MS", lastPowerCycleOffTimeMs);
+        powerCycleIntf.propertyChanged("LastOffTimeMs");
+    }
+
+    // The chassis has ended up on, as if On had been requested
+    server::Chassis::requestedPowerTransition(Transition::On);
+
+    powerCycleStage = PowerCycleStage::Idle;
+    powerCycleOffTime.reset();
+    pendingTransition.clear();
+}
+
+void Chassis::cancelPowerCycle(const std::string& reason)
+{
+    info("Power cycle cancelled, {REASON}", "REASON", reason);
+
+    powerCycleTimer.setEnabled(false);
+    powerCycleStage = PowerCycleStage::Idle;
+    powerCycleOffTime.reset();
+    pendingTransition.clear();
+}
+
+void Chassis::initializePowerCycleInterface()
+{
+    powerCycleIntf.addProperty<uint64_t>(
+        "MinOffTimeMs", []() { return uint64_t{CHASSIS_POWER_CYCLE_MIN_OFF}; });
+    powerCycleIntf.addProperty<uint64_t>(
+        "LastOffTimeMs", [this]() { return lastPowerCycleOffTimeMs; });
+    powerCycleIntf.emitAdded();
+}
+
 uint32_t Chassis::pohCounter(uint32_t value)
 {
     if (value != pohCounter())
     {
+        // Setting the counter restarts the count at the top of that hour
+        updatePOH();
+        pohSeconds = static_cast<uint64_t>(value) * SECONDS_PER_HOUR;
         ChassisInherit::pohCounter(value);
         serializePOH();
     }
@@ -599,41 +1004,108 @@ void Chassis::pohCallback()
 {
     if (ChassisInherit::currentPowerState() == PowerState::On)
     {
-        pohCounter(pohCounter() + 1);
+        updatePOH();
+        serializePOH();
+    }
+}
+
+void Chassis::updatePOH()
+{
+    using namespace std::chrono;
+
+    if (pohLastUpdate)
+    {
+        // Only whole seconds are moved into the total, the rest is
+        // carried over to the next update
+        auto now = bootTime();
+        auto counted = duration_cast<seconds>(now - *pohLastUpdate);
+        pohSeconds += counted.count();
+        *pohLastUpdate += counted;
+    }
+
+    auto hours = static_cast<uint32_t>(pohSeconds / SECONDS_PER_HOUR);
+    if (hours != ChassisInherit::pohCounter())
+    {
+        ChassisInherit::pohCounter(hours);
     }
 }
 
 void Chassis::restorePOHCounter()
 {
-    uint32_t counter;
-    if (!deserializePOH(POH_COUNTER_PERSIST_PATH, counter))
+    uint64_t seconds;
+    if (!deserializePOH(POH_COUNTER_PERSIST_PATH, seconds))
     {
         // set to default value
-        pohCounter(0);
+        seconds = 0;
     }
-    else
+
+    pohSeconds = seconds;
+    ChassisInherit::pohCounter(
+        static_cast<uint32_t>(pohSeconds / SECONDS_PER_HOUR));
+
+    if (ChassisInherit::currentPowerState() == PowerState::On)
     {
-        pohCounter(counter);
+        pohLastUpdate = bootTime();
     }
 }
 
 fs::path Chassis::serializePOH(const fs::path& path)
 {
-    std::ofstream os(path.c_str(), std::ios::binary);
-    cereal::JSONOutputArchive oarchive(os);
-    oarchive(pohCounter());
+    POHRecord record{POH_RECORD_MAGIC, POH_RECORD_VERSION, 0, pohSeconds};
+
+    io::worker().queue([path, record, instance = instance]() {
+        probes::PersistWrite probe{probes::Chassis, instance, path.c_str()};
+
+        auto tmpPath = path;
+        tmpPath += ".tmp";
+
+        {
+            std::ofstream os(tmpPath.c_str(),
+                             std::ios::binary | std::ios::trunc);
+            os.write(reinterpret_cast<const char*>(&record), sizeof(record));
+            if (!os)
+            {
+                error("Failed writing the power on time to {PATH}", "PATH",
+                      tmpPath.string());
+                return;
+            }
+        }
+
+        std::error_code ec;
+        fs::rename(tmpPath, path, ec);
+        if (ec)
+        {
+            error("Failed renaming {PATH}: {ERROR}", "PATH", tmpPath.string(),
+                  "ERROR", ec.message());
+        }
+    });
     return path;
 }
 
-bool Chassis::deserializePOH(const fs::path& path, uint32_t& pohCounter)
+bool Chassis::deserializePOH(const fs::path& path, uint64_t& retSeconds)
 {
     try
     {
         if (fs::exists(path))
         {
+            POHRecord record{};
             std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+            is.read(reinterpret_cast<char*>(&record), sizeof(record));
+            if ((is.gcount() == sizeof(record)) &&
+                (record.magic == POH_RECORD_MAGIC) &&
+                (record.version == POH_RECORD_VERSION))
+            {
+                retSeconds = record.seconds;
+                return true;
+            }
+
+            // Not a record, so it's an older JSON POH counter in hours
+            is.clear();
+            is.seekg(0);
+            uint32_t counter;
             cereal::JSONInputArchive iarchive(is);
-            iarchive(pohCounter);
+            iarchive(counter);
+            retSeconds = static_cast<uint64_t>(counter) * SECONDS_PER_HOUR;
             return true;
         }
         return false;
@@ -673,12 +1145,15 @@ void Chassis::startPOHCounter()
 
 void Chassis::serializeStateChangeTime()
 {
-    fs::path path{CHASSIS_STATE_CHANGE_PERSIST_PATH};
-    std::ofstream os(path.c_str(), std::ios::binary);
-    cereal::JSONOutputArchive oarchive(os);
-
-    oarchive(ChassisInherit::lastStateChangeTime(),
-             ChassisInherit::currentPowerState());
+    std::ostringstream os;
+    {
+        cereal::JSONOutputArchive oarchive(os);
+        oarchive(ChassisInherit::lastStateChangeTime(),
+                 ChassisInherit::currentPowerState());
+    }
+    persistedState = ChassisInherit::currentPowerState();
+    io::queueWrite(CHASSIS_STATE_CHANGE_PERSIST_PATH, os.str(),
+                   probes::Chassis, instance);
 }
 
 bool Chassis::deserializeStateChangeTime(uint64_t& time, PowerState& state)
@@ -709,6 +1184,8 @@ void Chassis::restoreChassisStateChangeTime()
     uint64_t time;
     PowerState state;
 
+    // Anything this thread saved has to be on file before it's read back
+    io::worker().drain();
     if (!deserializeStateChangeTime(time, state))
     {
         ChassisInherit::lastStateChangeTime(0);
@@ -716,29 +1193,26 @@ void Chassis::restoreChassisStateChangeTime()
     else
     {
         ChassisInherit::lastStateChangeTime(time);
+        persistedState = state;
     }
 }
 
-void Chassis::setStateChangeTime()
+void Chassis::setStateChangeTime(std::optional<uint64_t> timeMs)
 {
     using namespace std::chrono;
-    uint64_t lastTime;
-    PowerState lastState;
 
-    auto now =
+    auto now = timeMs.value_or(
         duration_cast<milliseconds>(system_clock::now().time_since_epoch())
-            .count();
+            .count());
 
     // If power is on when the BMC is rebooted, this function will get called
     // because sysStateChange() runs.  Since the power state didn't change
     // in this case, neither should the state change time, so check that
-    // the power state actually did change here.
-    if (deserializeStateChangeTime(lastTime, lastState))
+    // the power state actually did change here. The file isn't read back
+    // for this, a write of it may still be queued.
+    if (persistedState == ChassisInherit::currentPowerState())
     {
-        if (lastState == ChassisInherit::currentPowerState())
-        {
-            return;
-        }
+        return;
     }
 
     ChassisInherit::lastStateChangeTime(now);
@@ -749,9 +1223,11 @@ bool Chassis::standbyVoltageRegulatorFault()
 {
     bool regulatorFault = false;
 
-    // find standby voltage regulator fault via gpiog
-
-    auto gpioval = utils::getGpioValue("regulator-standby-faulted");
+    // find standby voltage regulator fault via gpiog, the line can't be
+    // requested again while it's being monitored
+    auto gpioval = standbyFaultMonitor
+                       ? standbyFaultMonitor->value()
+                       : utils::getGpioValue("regulator-standby-faulted");
 
     if (-1 == gpioval)
     {
@@ -2,6 +2,13 @@
 
 #include "config.h"
 
+#include "event_loop_stats.hpp"
+#include "gpio_event_monitor.hpp"
+#include "pending_transition.hpp"
+#include "property_interface.hpp"
+#include "state_journal.hpp"
+#include "state_probes.hpp"
+#include "state_snapshot.hpp"
 #include "xyz/openbmc_project/State/Chassis/server.hpp"
 #include "xyz/openbmc_project/State/PowerOnHours/server.hpp"
 
@@ -14,6 +21,9 @@
 #include <chrono>
 #include <experimental/filesystem>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <set>
 
 namespace phosphor
 {
@@ -52,22 +62,53 @@ class Chassis : public ChassisInherit
             sdbusRule::type::signal() + sdbusRule::member("JobRemoved") +
                 sdbusRule::path("/org/freedesktop/systemd1") +
                 sdbusRule::interface("org.freedesktop.systemd1.Manager"),
-            std::bind(std::mem_fn(&Chassis::sysStateChange), this,
-                      std::placeholders::_1)),
+            eventloop::timed(
+                "chassis.JobRemoved",
+                std::bind(std::mem_fn(&Chassis::sysStateChange), this,
+                          std::placeholders::_1))),
+        systemdSignalJobNew(
+            bus,
+            sdbusRule::type::signal() + sdbusRule::member("JobNew") +
+                sdbusRule::path("/org/freedesktop/systemd1") +
+                sdbusRule::interface("org.freedesktop.systemd1.Manager"),
+            eventloop::timed(
+                "chassis.JobNew",
+                std::bind(std::mem_fn(&Chassis::sysStateChangeJobNew), this,
+                          std::placeholders::_1))),
         pohTimer(sdeventplus::Event::get_default(),
-                 std::bind(&Chassis::pohCallback, this), std::chrono::hours{1},
-                 std::chrono::minutes{1})
+                 eventloop::timed("chassis.PowerOnHours",
+                                  std::bind(&Chassis::pohCallback, this)),
+                 std::chrono::minutes{POH_CHECKPOINT_INTERVAL},
+                 std::chrono::seconds{10}),
+        powerCycleTimer(sdeventplus::Event::get_default(),
+                        eventloop::timed(
+                            "chassis.PowerCycle",
+                            std::bind(&Chassis::powerCycleOn, this))),
+        powerCycleIntf(bus, objPath, POWER_CYCLE_INTERFACE),
+        pendingTransition(bus, objPath, PENDING_INTERFACE),
+        snapshotWriter(STATE_SNAPSHOT_FILE),
+        journalWriter(sdeventplus::Event::get_default(), STATE_JOURNAL_FILE,
+                      STATE_JOURNAL_PERSIST_PATH, STATE_JOURNAL_ENTRIES),
+        instance(probes::instanceOf(objPath))
     {
         subscribeToSystemdSignals();
 
         restoreChassisStateChangeTime();
 
+#ifdef ENABLE_CHASSIS_GPIO_EVENTS
+        monitorPowerGpios();
+#endif
+
         determineInitialState();
+        publishSnapshot();
 
         restorePOHCounter(); // restore POHCounter from persisted file
 
         // We deferred this until we could get our property correct
         this->emit_object_added();
+
+        initializePowerCycleInterface();
+        pendingTransition.emitAdded();
     }
 
     /** @brief Set value of RequestedPowerTransition */
@@ -83,9 +124,47 @@ class Chassis : public ChassisInherit
     void startPOHCounter();
 
   private:
+    /** @brief The power cycle D-Bus interface name */
+    static constexpr auto POWER_CYCLE_INTERFACE =
+        "xyz.openbmc_project.State.Chassis.PowerCycle";
+
+    /** @brief The pending transition D-Bus interface name */
+    static constexpr auto PENDING_INTERFACE =
+        "xyz.openbmc_project.State.Chassis.Pending";
+
+    /** @brief Where a PowerCycle transition is at */
+    enum class PowerCycleStage
+    {
+        Idle,
+        PoweringOff,
+        OffDwell,
+        PoweringOn
+    };
+
     /** @brief Determine initial chassis state and set internally */
     void determineInitialState();
 
+    /** @brief Watch the power-good and standby fault GPIOs for edges
+     *
+     *  Lines that aren't present are left unmonitored and the state comes
+     *  from the systemd targets and pgood as usual.
+     */
+    void monitorPowerGpios();
+
+    /** @brief Handle a power-good GPIO edge
+     *
+     *  @param[in] value  - The new line value
+     *  @param[in] timeMs - When the kernel saw the edge, ms since the epoch
+     */
+    void powerGoodChange(bool value, uint64_t timeMs);
+
+    /** @brief Handle a standby voltage regulator fault GPIO edge
+     *
+     *  @param[in] value  - The new line value
+     *  @param[in] timeMs - When the kernel saw the edge, ms since the epoch
+     */
+    void standbyFaultChange(bool value, uint64_t timeMs);
+
     /** @brief Determine status of power into system by examining all the
      *        power-related interfaces of interest
      */
@@ -101,6 +180,9 @@ class Chassis : public ChassisInherit
      */
     void determineStatusOfPSUPower();
 
+    /** @brief Publish the power state and status to the state snapshot */
+    void publishSnapshot();
+
     /**
      * @brief subscribe to the systemd signals
      *
@@ -115,8 +197,23 @@ class Chassis : public ChassisInherit
      * This function calls `StartUnit` on the systemd unit given.
      *
      * @param[in] sysdUnit    - Systemd unit
+     *
+     * @return The queued systemd job
      */
-    void startUnit(const std::string& sysdUnit);
+    sdbusplus::message::object_path startUnit(const std::string& sysdUnit);
+
+    /** @brief Decide what to do with a request while a job is in flight
+     *
+     * A request for the pending transition is coalesced into its job.
+     * A conflicting request replaces the pending job, unless conflicting
+     * requests are configured to be rejected. Off always replaces it.
+     *
+     * @param[in] value - Transition requested
+     *
+     * @return true if a new job is needed, false if coalesced. Throws
+     *         NotAllowed if the request is rejected.
+     */
+    bool admitTransition(Transition value);
 
     /**
      * @brief Determine if target is active
@@ -140,12 +237,61 @@ class Chassis : public ChassisInherit
      */
     int sysStateChange(sdbusplus::message::message& msg);
 
+    /** @brief Note a queued job of the poweroff targets
+     *
+     * @param[in]  msg       - Data associated with subscribed signal
+     */
+    void sysStateChangeJobNew(sdbusplus::message::message& msg);
+
+    /** @brief Finish chassis power off */
+    void chassisOff();
+
+    /** @brief Finish chassis power on */
+    void chassisOn();
+
+    /** @brief Start the power off half of a PowerCycle transition */
+    void startPowerCycle();
+
+    /** @brief Handle the JobRemoved of the power cycle's off job
+     *
+     *  Arms the timer to power back on once power has been off for at
+     *  least the minimum off time.
+     *
+     *  @param[in] result - The job result
+     */
+    void powerCycleOffDone(const std::string& result);
+
+    /** @brief Used by the power cycle timer to power back on */
+    void powerCycleOn();
+
+    /** @brief Record the achieved off time once power is back on */
+    void powerCycleComplete();
+
+    /** @brief Abandon an in progress PowerCycle transition
+     *
+     *  @param[in] reason - Why, for the log
+     */
+    void cancelPowerCycle(const std::string& reason);
+
+    /** @brief Put the power cycle D-Bus interface on the bus */
+    void initializePowerCycleInterface();
+
     /** @brief Persistent sdbusplus DBus connection. */
     sdbusplus::bus::bus& bus;
 
     /** @brief Used to subscribe to dbus systemd signals **/
     sdbusplus::bus::match_t systemdSignals;
 
+    /** @brief Used to subscribe to dbus systemd JobNew signal **/
+    sdbusplus::bus::match_t systemdSignalJobNew;
+
+    /** @brief Jobs of the poweroff targets queued or running
+     *
+     *  A queued target still reports inactive, so this is what tells a
+     *  power off from power-good going away underneath us.
+     */
+    std::set<std::string> powerOffJobs;
+
     /** @brief Watch for any changes to UPS properties **/
     std::unique_ptr<sdbusplus::bus::match_t> uPowerPropChangeSignal;
 
@@ -155,40 +301,57 @@ class Chassis : public ChassisInherit
     /** @brief Used to Set value of POHCounter */
     uint32_t pohCounter(uint32_t value) override;
 
-    /** @brief Used by the timer to update the POHCounter */
+    /** @brief Used by the timer to checkpoint the power on time */
     void pohCallback();
 
+    /** @brief Add the time power has been on since the last update
+     *
+     *  Updates POHCounter when another full hour has been reached.
+     */
+    void updatePOH();
+
     /** @brief Used to restore POHCounter value from persisted file */
     void restorePOHCounter();
 
-    /** @brief Serialize and persist requested POH counter.
+    /** @brief Persist the power on time as a binary record.
      *
-     *  @param[in] dir - pathname of file where the serialized POH counter will
+     *  The record is written to a temporary file which is then renamed
+     *  over the old one, so a BMC reset can't leave it half written. Both
+     *  happen later on the I/O worker.
+     *
+     *  @param[in] dir - pathname of file where the power on time will
      *                   be placed.
      *
-     *  @return fs::path - pathname of persisted requested POH counter.
+     *  @return fs::path - pathname of persisted power on time.
      */
     fs::path
         serializePOH(const fs::path& dir = fs::path(POH_COUNTER_PERSIST_PATH));
 
-    /** @brief Deserialize a persisted requested POH counter.
+    /** @brief Deserialize the persisted power on time.
+     *
+     *  A POH counter in the older cereal JSON format is read as whole hours.
      *
-     *  @param[in] path - pathname of persisted POH counter file
-     *  @param[in] retCounter - deserialized POH counter value
+     *  @param[in] path - pathname of persisted power on time file
+     *  @param[out] retSeconds - deserialized power on time in seconds
      *
      *  @return bool - true if the deserialization was successful, false
      *                 otherwise.
      */
-    bool deserializePOH(const fs::path& path, uint32_t& retCounter);
+    bool deserializePOH(const fs::path& path, uint64_t& retSeconds);
 
-    /** @brief Sets the LastStateChangeTime property and persists it. */
-    void setStateChangeTime();
+    /** @brief Sets the LastStateChangeTime property and persists it.
+     *
+     *  @param[in] timeMs - When the state changed, ms since the epoch,
+     *                      now if not given
+     */
+    void setStateChangeTime(std::optional<uint64_t> timeMs = std::nullopt);
 
     /** @brief Serialize the last power state change time.
      *
-     *  Save the time the state changed and the state itself.
-     *  The state needs to be saved as well so that during rediscovery
-     *  on reboots there's a way to know not to update the time again.
+     *  Save the time the state changed and the state itself, on the I/O
+     *  worker. The state needs to be saved as well so that during
+     *  rediscovery on reboots there's a way to know not to update the time
+     *  again.
      */
     void serializeStateChangeTime();
 
@@ -203,15 +366,65 @@ class Chassis : public ChassisInherit
 
     /** @brief Restores the power state change time.
      *
-     *  The time is loaded into the LastStateChangeTime D-Bus property.
+     *  The time is loaded into the LastStateChangeTime D-Bus property and
+     *  the state it was persisted with into persistedState.
      *  On the very first start after this code has been applied but
      *  before the state has changed, the LastStateChangeTime value
      *  will be zero.
      */
     void restoreChassisStateChangeTime();
 
-    /** @brief Timer used for tracking power on hours */
-    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> pohTimer;
+    /** @brief Timer used for checkpointing the power on time */
+    sdeventplus::utility::Timer<sdeventplus::ClockId::BootTime> pohTimer;
+
+    /** @brief Total power on time, in seconds */
+    uint64_t pohSeconds = 0;
+
+    /** @brief CLOCK_BOOTTIME of the last power on time update, empty
+     *  while the chassis is off
+     */
+    std::optional<std::chrono::nanoseconds> pohLastUpdate;
+
+    /** @brief Where an in progress PowerCycle transition is at */
+    PowerCycleStage powerCycleStage = PowerCycleStage::Idle;
+
+    /** @brief When power went off during the in progress PowerCycle */
+    std::optional<std::chrono::steady_clock::time_point> powerCycleOffTime;
+
+    /** @brief How long power was off for in the last PowerCycle, in ms */
+    uint64_t lastPowerCycleOffTimeMs = 0;
+
+    /** @brief Timer holding power off for the minimum off time */
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>
+        powerCycleTimer;
+
+    /** @brief The power cycle D-Bus interface */
+    PropertyInterface powerCycleIntf;
+
+    /** @brief The transition whose job is in flight */
+    PendingTransition pendingTransition;
+
+    /** @brief Publishes the power state to the local state snapshot */
+    snapshot::Writer snapshotWriter;
+
+    /** @brief Records power state changes */
+    journal::Writer journalWriter;
+
+    /** @brief Watches the power-good GPIO, if present */
+    std::unique_ptr<GpioEventMonitor> powerGoodMonitor;
+
+    /** @brief Watches the standby voltage regulator fault GPIO, if present */
+    std::unique_ptr<GpioEventMonitor> standbyFaultMonitor;
+
+    /** @brief The chassis number, for probes */
+    const uint32_t instance;
+
+    /** @brief The power state last persisted with the state change time
+     *
+     *  Kept here as the file may still be waiting on the I/O worker when
+     *  the next change comes in.
+     */
+    std::optional<PowerState> persistedState;
 
     /** @brief Function to check for a standby voltage regulator fault
      *
@@ -1,8 +1,11 @@
 #include "config.h"
 
 #include "chassis_state_manager.hpp"
+#include "event_loop_monitor.hpp"
+#include "startup_timing.hpp"
 
 #include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
 
 #include <cstdlib>
 #include <exception>
@@ -10,7 +13,13 @@
 
 int main()
 {
+    namespace startup = phosphor::state::manager::startup;
+
+    startup::milestone("main");
+
+    auto event = sdeventplus::Event::get_default();
     auto bus = sdbusplus::bus::new_default();
+    startup::milestone("bus");
 
     // For now, we only have one instance of the chassis
     auto objPathInst = std::string{CHASSIS_OBJPATH} + '0';
@@ -19,8 +28,12 @@ int main()
     sdbusplus::server::manager::manager objManager(bus, objPathInst.c_str());
 
     phosphor::state::manager::Chassis manager(bus, objPathInst.c_str());
+    phosphor::state::manager::eventloop::Monitor loopMonitor(bus, event,
+                                                             objPathInst);
+    startup::milestone("constructed");
 
     bus.request_name(CHASSIS_BUSNAME);
+    startup::milestone(startup::READY);
     manager.startPOHCounter();
 
     return 0;
@@ -1,23 +1,35 @@
 #include "config.h"
 
 #include "host_state_manager.hpp"
+#include "power_restore_policy.hpp"
 #include "settings.hpp"
+#include "state_snapshot.hpp"
 #include "utils.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
-#include "xyz/openbmc_project/Control/Power/RestorePolicy/server.hpp"
 
 #include <getopt.h>
 #include <systemd/sd-bus.h>
+#include <systemd/sd-daemon.h>
+#include <systemd/sd-id128.h>
 
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/bus/match.hpp>
 #include <sdbusplus/exception.hpp>
 #include <sdbusplus/server.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
 
+#include <chrono>
+#include <cstring>
+#include <exception>
 #include <filesystem>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <string>
+#include <variant>
 
 namespace phosphor
 {
@@ -30,33 +42,125 @@ PHOSPHOR_LOG2_USING;
 
 using namespace phosphor::logging;
 using namespace sdbusplus::xyz::openbmc_project::Common::Error;
-using namespace sdbusplus::xyz::openbmc_project::Control::Power::server;
+
+// Mixed with the machine id so the stagger slot doesn't reveal it
+constexpr sd_id128_t STAGGER_APP_ID = SD_ID128_MAKE(
+    5a, 0e, 3c, 91, 7d, 24, 4b, 6f, 8e, 13, c7, 52, a9, 06, d8, 3b);
+
+/** @brief Return how long to hold off a power restore
+ *
+ *  @param[in] delay   - Fixed delay
+ *  @param[in] stagger - Window to spread BMCs over, 0 to not stagger
+ *
+ *  @return The fixed delay plus this BMC's slot in the window, which is
+ *          derived from the machine id so it is the same on every boot
+ */
+std::chrono::milliseconds getRestoreDelay(std::chrono::seconds delay,
+                                          std::chrono::seconds stagger)
+{
+    using namespace std::chrono;
+
+    auto total = duration_cast<milliseconds>(delay);
+    auto window = duration_cast<milliseconds>(stagger).count();
+    if (window <= 0)
+    {
+        return total;
+    }
+
+    sd_id128_t id;
+    auto r = sd_id128_get_machine_app_specific(STAGGER_APP_ID, &id);
+    if (r < 0)
+    {
+        error("Failed to get machine id, not staggering power restore: "
+              "{ERRNO}",
+              "ERRNO", -r);
+        return total;
+    }
+
+    uint64_t slot;
+    std::memcpy(&slot, id.bytes, sizeof(slot));
+    return total + milliseconds(slot % window);
+}
+
+/** @brief Return the host's last requested transition
+ *
+ *  @param[in] bus      - The Dbus bus object
+ *  @param[in] hostPath - The host's object path
+ *
+ *  @return The transition, from the state snapshot if it covers this host
+ *          and from D-Bus otherwise
+ */
+std::string getRequestedHostTransition(sdbusplus::bus::bus& bus,
+                                       const std::string& hostPath)
+{
+    if (hostPath == std::string{HOST_OBJPATH} + '0')
+    {
+        snapshot::Reader reader{STATE_SNAPSHOT_FILE};
+        auto transition = reader.value(&snapshot::Snapshot::host,
+                                       snapshot::RequestedHostTransition);
+        if (transition)
+        {
+            return *transition;
+        }
+    }
+
+    return utils::getProperty(bus, hostPath, HOST_BUSNAME,
+                              "RequestedHostTransition");
+}
 
 } // namespace manager
 } // namespace state
 } // namespace phosphor
 
+static void usage(const char* name)
+{
+    std::cerr << "Usage: " << name << " [options]\n"
+              << "  -h, --host NUMBER     the host to restore power to\n"
+              << "  -d, --delay SECONDS   hold off the power on this long\n"
+              << "  -s, --stagger SECONDS spread the power on over this "
+                 "window\n";
+}
+
 int main(int argc, char** argv)
 {
     using namespace phosphor::logging;
 
     std::string hostPath = "/xyz/openbmc_project/state/host0";
+    std::chrono::seconds restoreDelay{POWER_RESTORE_DELAY};
+    std::chrono::seconds restoreStagger{POWER_RESTORE_STAGGER};
     int arg;
     int optIndex = 0;
 
     static struct option longOpts[] = {{"host", required_argument, 0, 'h'},
+                                       {"delay", required_argument, 0, 'd'},
+                                       {"stagger", required_argument, 0, 's'},
                                        {0, 0, 0, 0}};
 
-    while ((arg = getopt_long(argc, argv, "h:", longOpts, &optIndex)) != -1)
+    while ((arg = getopt_long(argc, argv, "h:d:s:", longOpts, &optIndex)) !=
+           -1)
     {
-        switch (arg)
+        try
         {
-            case 'h':
-                hostPath =
-                    std::string("/xyz/openbmc_project/state/host") + optarg;
-                break;
-            default:
-                break;
+            switch (arg)
+            {
+                case 'h':
+                    hostPath = std::string("/xyz/openbmc_project/state/host") +
+                               optarg;
+                    break;
+                case 'd':
+                    restoreDelay = std::chrono::seconds(std::stoul(optarg));
+                    break;
+                case 's':
+                    restoreStagger = std::chrono::seconds(std::stoul(optarg));
+                    break;
+                default:
+                    break;
+            }
+        }
+        catch (const std::exception&)
+        {
+            usage(argv[0]);
+            return 2;
         }
     }
 
@@ -70,128 +174,36 @@ int main(int argc, char** argv)
 
     // This application is only run if chassis power is off
 
-    // If the BMC was rebooted due to a user initiated pinhole reset, do not
-    // implement any power restore policies
-    auto bmcRebootCause = phosphor::state::manager::utils::getProperty(
-        bus, "/xyz/openbmc_project/state/bmc0", BMC_BUSNAME, "LastRebootCause");
-    if (bmcRebootCause ==
-        "xyz.openbmc_project.State.BMC.RebootCause.PinholeReset")
-    {
-        info(
-            "BMC was reset due to pinhole reset, no power restore policy will be run");
-        return 0;
-    }
-    else if (bmcRebootCause ==
-             "xyz.openbmc_project.State.BMC.RebootCause.Watchdog")
-    {
-        info(
-            "BMC was reset due to cold reset, no power restore policy will be run");
-        return 0;
-    }
+    // Set when the policy powers the host on, run once any delay is over
+    std::function<void()> powerOn;
+    auto lastRequested = server::Host::Transition::Off;
 
-    /* The logic here is to first check the one-time PowerRestorePolicy setting.
-     * If this property is not the default then look at the persistent
-     * user setting in the non one-time object, otherwise honor the one-time
-     * setting.
-     */
-    auto methodOneTime = bus.new_method_call(
-        settings.service(settings.powerRestorePolicy, powerRestoreIntf).c_str(),
-        settings.powerRestorePolicyOneTime.c_str(),
-        "org.freedesktop.DBus.Properties", "Get");
-    methodOneTime.append(powerRestoreIntf, "PowerRestorePolicy");
-
-    auto methodUserSetting = bus.new_method_call(
-        settings.service(settings.powerRestorePolicy, powerRestoreIntf).c_str(),
-        settings.powerRestorePolicy.c_str(), "org.freedesktop.DBus.Properties",
-        "Get");
-    methodUserSetting.append(powerRestoreIntf, "PowerRestorePolicy");
-
-    std::variant<std::string> result;
     try
     {
-        auto reply = bus.call(methodOneTime);
-        reply.read(result);
-        auto powerPolicy = std::get<std::string>(result);
+        lastRequested = server::Host::convertTransitionFromString(
+            getRequestedHostTransition(bus, hostPath));
 
-        if (RestorePolicy::Policy::None ==
-            RestorePolicy::convertPolicyFromString(powerPolicy))
-        {
-            // one_time is set to None so use the customer setting
-            info("One time not set, check user setting of power policy");
-
-            // Only use customer setting if chassis power was on prior to
-            // the BMC reboot
-            auto size = std::snprintf(nullptr, 0, CHASSIS_LOST_POWER_FILE, 0);
-            size++; // null
-            std::unique_ptr<char[]> buf(new char[size]);
-            std::snprintf(buf.get(), size, CHASSIS_LOST_POWER_FILE, 0);
-            if (!fs::exists(buf.get()))
-            {
-                info(
-                    "Chassis power was not on prior to BMC reboot so do not run any power policy");
-                return 0;
-            }
-
-            auto reply = bus.call(methodUserSetting);
-            reply.read(result);
-            powerPolicy = std::get<std::string>(result);
-        }
-        else
+        auto action = getPowerRestoreAction(bus, settings, lastRequested);
+        if (action)
         {
-            // one_time setting was set so we're going to use it. Reset it
-            // to default for next time.
-            info("One time set, use it and reset to default");
-            phosphor::state::manager::utils::setProperty(
-                bus, settings.powerRestorePolicyOneTime.c_str(),
-                powerRestoreIntf, "PowerRestorePolicy",
-                convertForMessage(RestorePolicy::Policy::None));
-        }
-
-        info("Host power is off, processing power policy {POWER_POLICY}",
-             "POWER_POLICY", powerPolicy);
-
-        if (RestorePolicy::Policy::AlwaysOn ==
-            RestorePolicy::convertPolicyFromString(powerPolicy))
-        {
-            info("power_policy=ALWAYS_POWER_ON, powering host on");
-            phosphor::state::manager::utils::setProperty(
-                bus, hostPath, HOST_BUSNAME, "RestartCause",
-                convertForMessage(
-                    server::Host::RestartCause::PowerPolicyAlwaysOn));
-            phosphor::state::manager::utils::setProperty(
-                bus, hostPath, HOST_BUSNAME, "RequestedHostTransition",
-                convertForMessage(server::Host::Transition::On));
-        }
-        else if (RestorePolicy::Policy::AlwaysOff ==
-                 RestorePolicy::convertPolicyFromString(powerPolicy))
-        {
-            info("power_policy=ALWAYS_POWER_OFF, set requested state to off");
-            // Read last requested state and re-request it to execute it
-            auto hostReqState = phosphor::state::manager::utils::getProperty(
-                bus, hostPath, HOST_BUSNAME, "RequestedHostTransition");
-            if (hostReqState == convertForMessage(server::Host::Transition::On))
-            {
+            powerOn = [&bus, &hostPath, restore = *action]() {
+                logPowerRestoreTiming(restore);
+                if (restore.restartCause)
+                {
+                    phosphor::state::manager::utils::setProperty(
+                        bus, hostPath, HOST_BUSNAME, "RestartCause",
+                        convertForMessage(*restore.restartCause));
+                }
                 phosphor::state::manager::utils::setProperty(
                     bus, hostPath, HOST_BUSNAME, "RequestedHostTransition",
-                    convertForMessage(server::Host::Transition::Off));
-            }
-        }
-        else if (RestorePolicy::Policy::Restore ==
-                 RestorePolicy::convertPolicyFromString(powerPolicy))
-        {
-            info("power_policy=RESTORE, restoring last state");
-            // Read last requested state and re-request it to execute it
-            auto hostReqState = phosphor::state::manager::utils::getProperty(
-                bus, hostPath, HOST_BUSNAME, "RequestedHostTransition");
-            if (hostReqState == convertForMessage(server::Host::Transition::On))
+                    convertForMessage(restore.transition));
+            };
+
+            // Only a power on is worth staggering
+            if (action->transition != server::Host::Transition::On)
             {
-                phosphor::state::manager::utils::setProperty(
-                    bus, hostPath, HOST_BUSNAME, "RestartCause",
-                    convertForMessage(
-                        server::Host::RestartCause::PowerPolicyPreviousState));
-                phosphor::state::manager::utils::setProperty(
-                    bus, hostPath, HOST_BUSNAME, "RequestedHostTransition",
-                    hostReqState);
+                powerOn();
+                powerOn = nullptr;
             }
         }
     }
@@ -201,5 +213,90 @@ int main(int argc, char** argv)
         elog<InternalFailure>();
     }
 
-    return 0;
+    auto delay = powerOn ? getRestoreDelay(restoreDelay, restoreStagger)
+                         : std::chrono::milliseconds{0};
+    if (delay.count() == 0)
+    {
+        if (powerOn)
+        {
+            powerOn();
+        }
+        sd_notify(0, "READY=1");
+        return 0;
+    }
+
+    // The unit is a notify one, so telling systemd it's up here keeps the
+    // wait from holding up multi-user.target, and BMC Ready with it
+    sd_notify(0, "READY=1");
+
+    // Hold off the power on so a whole rack coming back from an AC loss
+    // doesn't power on at once. Waiting on the event loop rather than
+    // sleeping lets a transition requested, or the host starting some other
+    // way, meanwhile cancel it.
+    info("Delaying power restore by {DELAY_MS}ms", "DELAY_MS", delay.count());
+
+    auto event = sdeventplus::Event::get_default();
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+
+    sdbusplus::bus::match_t userRequest(
+        bus,
+        sdbusplus::bus::match::rules::propertiesChanged(
+            hostPath, "xyz.openbmc_project.State.Host"),
+        [&event](sdbusplus::message::message& msg) {
+            std::string interface;
+            std::map<std::string, std::variant<std::string>> msgData;
+            msg.read(interface, msgData);
+
+            if (msgData.contains("RequestedHostTransition"))
+            {
+                info("Host transition requested, cancelling power restore");
+                event.exit(0);
+                return;
+            }
+
+            auto state = msgData.find("CurrentHostState");
+            if ((state != msgData.end()) &&
+                (server::Host::convertHostStateFromString(std::get<std::string>(
+                     state->second)) != server::Host::HostState::Off))
+            {
+                info("Host left Off, cancelling power restore");
+                event.exit(0);
+            }
+        });
+
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> timer(
+        event, [&event, &powerOn, &bus, &hostPath, lastRequested](auto&) {
+            try
+            {
+                // Anything that happened before the match was in place
+                // wasn't seen, so look again before acting on the policy
+                auto requested = server::Host::convertTransitionFromString(
+                    utils::getProperty(bus, hostPath, HOST_BUSNAME,
+                                       "RequestedHostTransition"));
+                auto state = server::Host::convertHostStateFromString(
+                    utils::getProperty(bus, hostPath, HOST_BUSNAME,
+                                       "CurrentHostState"));
+                if ((requested != lastRequested) ||
+                    (state != server::Host::HostState::Off))
+                {
+                    info("Host changed during the power restore delay, "
+                         "not powering on");
+                    event.exit(0);
+                    return;
+                }
+
+                info("Power restore delay over, powering host on");
+                powerOn();
+            }
+            catch (const std::exception& e)
+            {
+                error("Error restoring host power: {ERROR}", "ERROR", e);
+                event.exit(1);
+                return;
+            }
+            event.exit(0);
+        });
+    timer.restartOnce(delay);
+
+    return event.loop();
 }
@@ -0,0 +1,104 @@
+#include "event_loop_monitor.hpp"
+
+#include "io_worker.hpp"
+
+#include <signal.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace eventloop
+{
+
+PHOSPHOR_LOG2_USING;
+
+/** @brief Block a signal so it's delivered to the event loop */
+static int blockSignal(int signal)
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, signal);
+    sigprocmask(SIG_BLOCK, &set, nullptr);
+    return signal;
+}
+
+Monitor::Monitor(sdbusplus::bus::bus& bus, const sdeventplus::Event& event,
+                 const std::string& objPath) :
+    due(Clock::now() + LAG_INTERVAL),
+    lagTimer(event, [this](auto&) { checkLag(); }),
+    dumpSignal(event, blockSignal(SIGUSR1),
+               [this](auto&, const auto*) { dump(); }),
+    exitSignal(event, blockSignal(SIGTERM),
+               [](auto& source, const auto*) {
+                   info("Exiting on SIGTERM");
+                   source.get_event().exit(0);
+               }),
+    intf(bus, objPath, INTERFACE)
+{
+    lagTimer.restartOnce(LAG_INTERVAL);
+
+    intf.addProperty<uint64_t>(
+        "LagMaxUs", []() { return stats().lagMax(Clock::now()); });
+    intf.addProperty<std::vector<Bucket>>(
+        "LagHistogram", []() { return stats().lagHistogram(Clock::now()); });
+    intf.addProperty<std::vector<Bucket>>("HandlerHistogram", []() {
+        return stats().handlerHistogram(Clock::now());
+    });
+    intf.addProperty<std::vector<HandlerSummary>>(
+        "SlowestHandlers", []() { return stats().slowest(); });
+    intf.addProperty<uint64_t>("IoQueueDepth",
+                               []() { return io::worker().depth(); });
+    intf.addProperty<uint64_t>("IoLatencyMaxUs",
+                               []() { return io::worker().maxLatencyUs(); });
+
+    intf.addMethod("Dump", "", "s",
+                   [](sdbusplus::message::message&,
+                      sdbusplus::message::message& reply) {
+                       reply.append(report());
+                   });
+    intf.addMethod(
+        "Reset", "", "",
+        [](sdbusplus::message::message&, sdbusplus::message::message&) {
+            stats().reset();
+            io::worker().reset();
+        });
+    intf.emitAdded();
+}
+
+void Monitor::checkLag()
+{
+    auto now = Clock::now();
+    auto lag = std::max(now - due, Clock::duration::zero());
+    stats().lagged(
+        std::chrono::duration_cast<std::chrono::microseconds>(lag).count(),
+        now);
+
+    due = now + LAG_INTERVAL;
+    lagTimer.restartOnce(LAG_INTERVAL);
+}
+
+std::string Monitor::report()
+{
+    return stats().report(Clock::now()) + "I/O worker: " +
+           std::to_string(io::worker().depth()) + " queued, max " +
+           std::to_string(io::worker().maxLatencyUs()) +
+           "us queued to done\n";
+}
+
+void Monitor::dump()
+{
+    info("Event loop statistics:\n{REPORT}", "REPORT", report());
+}
+
+} // namespace eventloop
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "event_loop_stats.hpp"
+#include "property_interface.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/signal.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <chrono>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace eventloop
+{
+
+/** @brief How often the lag is sampled */
+constexpr auto LAG_INTERVAL = std::chrono::seconds{1};
+
+/** @class Monitor
+ *  @brief Samples the event loop's lag and publishes the process's event
+ *  loop statistics
+ *  @details The lag is how late a timer armed for every LAG_INTERVAL is
+ *  dispatched, which is how long the loop was held by whatever ran between
+ *  the timer expiring and its callback, within the timer's 1ms accuracy.
+ *  The statistics, with the depth and worst queued-to-done time of the
+ *  loop's I/O worker, are published on D-Bus on the given object and logged
+ *  on SIGUSR1. SIGTERM ends the loop, so main returns and the managers'
+ *  destructors get to write out what they hold.
+ */
+class Monitor
+{
+  public:
+    Monitor() = delete;
+    Monitor(const Monitor&) = delete;
+    Monitor& operator=(const Monitor&) = delete;
+    Monitor(Monitor&&) = delete;
+    Monitor& operator=(Monitor&&) = delete;
+    ~Monitor() = default;
+
+    /** @brief Starts sampling and puts the statistics on D-Bus
+     *
+     * @note Blocks SIGUSR1 and SIGTERM, which must be done before any
+     *       threads are started
+     *
+     * @param[in] bus     - The Dbus bus object
+     * @param[in] event   - The event loop to sample
+     * @param[in] objPath - The Dbus object path, which must be under an
+     *                      ObjectManager
+     */
+    Monitor(sdbusplus::bus::bus& bus, const sdeventplus::Event& event,
+            const std::string& objPath);
+
+  private:
+    /** @brief The event loop D-Bus interface name */
+    static constexpr auto INTERFACE = "xyz.openbmc_project.State.EventLoop";
+
+    /** @brief Record how late the lag timer is and rearm it */
+    void checkLag();
+
+    /** @brief Return the statistics and the I/O worker's as text */
+    static std::string report();
+
+    /** @brief Log the statistics */
+    void dump();
+
+    /** @brief When the lag timer is due */
+    Clock::time_point due;
+
+    /** @brief Timer the lag is sampled with */
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> lagTimer;
+
+    /** @brief SIGUSR1 handler */
+    sdeventplus::source::Signal dumpSignal;
+
+    /** @brief SIGTERM handler */
+    sdeventplus::source::Signal exitSignal;
+
+    /** @brief The event loop D-Bus interface */
+    PropertyInterface intf;
+};
+
+} // namespace eventloop
+} // namespace manager
+} // namespace state
+} // namespace phosphor
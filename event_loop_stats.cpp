@@ -0,0 +1,293 @@
+#include "event_loop_stats.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace eventloop
+{
+
+PHOSPHOR_LOG2_USING;
+
+/** @brief Return the bucket a sample falls in */
+static std::size_t bucketOf(uint64_t us)
+{
+    if (us <= FIRST_BUCKET_US)
+    {
+        return 0;
+    }
+    auto bucket = std::bit_width((us - 1) / FIRST_BUCKET_US);
+    return std::min(static_cast<std::size_t>(bucket), BUCKETS - 1);
+}
+
+/** @brief Return a bucket's upper bound in us, 0 for the overflow */
+static uint64_t boundOf(std::size_t bucket)
+{
+    return (bucket == BUCKETS - 1) ? 0 : FIRST_BUCKET_US << bucket;
+}
+
+/** @brief Return a bucket's upper bound as text, such as <=8us */
+static std::string boundText(uint64_t bound)
+{
+    if (bound == 0)
+    {
+        return ">" + std::to_string(boundOf(BUCKETS - 2)) + "us";
+    }
+    return "<=" + std::to_string(bound) + "us";
+}
+
+int64_t Histogram::periodOf(Clock::time_point now)
+{
+    return now.time_since_epoch() / (WINDOW / WINDOW_SLOTS);
+}
+
+bool Histogram::current(const Slot& slot, int64_t period)
+{
+    return (slot.period >= 0) &&
+           (slot.period > period - static_cast<int64_t>(WINDOW_SLOTS));
+}
+
+void Histogram::add(Clock::time_point now, uint64_t us)
+{
+    auto period = periodOf(now);
+    auto& slot = slots[period % WINDOW_SLOTS];
+    if (slot.period != period)
+    {
+        slot = Slot{};
+        slot.period = period;
+    }
+    slot.counts[bucketOf(us)]++;
+    slot.max = std::max(slot.max, us);
+}
+
+std::vector<Bucket> Histogram::buckets(Clock::time_point now) const
+{
+    auto period = periodOf(now);
+    std::vector<Bucket> result;
+    for (std::size_t bucket = 0; bucket < BUCKETS; bucket++)
+    {
+        uint64_t count = 0;
+        for (const auto& slot : slots)
+        {
+            if (current(slot, period))
+            {
+                count += slot.counts[bucket];
+            }
+        }
+        result.emplace_back(boundOf(bucket), count);
+    }
+    return result;
+}
+
+uint64_t Histogram::count(Clock::time_point now) const
+{
+    uint64_t count = 0;
+    for (const auto& [bound, bucketCount] : buckets(now))
+    {
+        count += bucketCount;
+    }
+    return count;
+}
+
+uint64_t Histogram::max(Clock::time_point now) const
+{
+    auto period = periodOf(now);
+    uint64_t max = 0;
+    for (const auto& slot : slots)
+    {
+        if (current(slot, period))
+        {
+            max = std::max(max, slot.max);
+        }
+    }
+    return max;
+}
+
+uint64_t Histogram::percentile(Clock::time_point now, unsigned percent) const
+{
+    auto counts = buckets(now);
+    uint64_t total = 0;
+    for (const auto& [bound, count] : counts)
+    {
+        total += count;
+    }
+
+    // The smallest bucket with at least percent of the samples at or
+    // below it
+    uint64_t seen = 0;
+    for (const auto& [bound, count] : counts)
+    {
+        seen += count;
+        if ((total != 0) && ((seen * 100) >= (total * percent)))
+        {
+            return bound;
+        }
+    }
+    return 0;
+}
+
+void Histogram::clear()
+{
+    slots = {};
+}
+
+void Stats::handled(const std::string& name, uint64_t us,
+                    Clock::time_point now)
+{
+    std::lock_guard lock{mutex};
+
+    handlerTimes.add(now, us);
+
+    auto& handler = handlers[name];
+    handler.count++;
+    handler.totalUs += us;
+    handler.maxUs = std::max(handler.maxUs, us);
+}
+
+void Stats::lagged(uint64_t us, Clock::time_point now)
+{
+    std::lock_guard lock{mutex};
+    lagTimes.add(now, us);
+}
+
+std::vector<HandlerSummary> Stats::slowest() const
+{
+    std::lock_guard lock{mutex};
+
+    std::vector<HandlerSummary> result;
+    for (const auto& [name, handler] : handlers)
+    {
+        result.emplace_back(name, handler.maxUs, handler.count,
+                            handler.totalUs / handler.count);
+    }
+
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return std::get<1>(a) > std::get<1>(b);
+    });
+    if (result.size() > REPORT_HANDLERS)
+    {
+        result.resize(REPORT_HANDLERS);
+    }
+    return result;
+}
+
+std::vector<Bucket> Stats::handlerHistogram(Clock::time_point now) const
+{
+    std::lock_guard lock{mutex};
+    return handlerTimes.buckets(now);
+}
+
+std::vector<Bucket> Stats::lagHistogram(Clock::time_point now) const
+{
+    std::lock_guard lock{mutex};
+    return lagTimes.buckets(now);
+}
+
+uint64_t Stats::lagMax(Clock::time_point now) const
+{
+    std::lock_guard lock{mutex};
+    return lagTimes.max(now);
+}
+
+std::string Stats::report(Clock::time_point now) const
+{
+    std::string text;
+    char line[160];
+
+    auto histogram = [&text, &line, now](const char* name,
+                                         const Histogram& times) {
+        auto count = times.count(now);
+        std::snprintf(line, sizeof(line),
+                      "%s, last %llds: %llu samples, max %lluus", name,
+                      static_cast<long long>(WINDOW.count()),
+                      static_cast<unsigned long long>(count),
+                      static_cast<unsigned long long>(times.max(now)));
+        text += line;
+        if (count != 0)
+        {
+            text += ", p99 " + boundText(times.percentile(now, 99));
+        }
+        text += '\n';
+
+        for (const auto& [bound, bucketCount] : times.buckets(now))
+        {
+            if (bucketCount != 0)
+            {
+                text += "  " + boundText(bound) + ' ' +
+                        std::to_string(bucketCount) + '\n';
+            }
+        }
+    };
+
+    {
+        std::lock_guard lock{mutex};
+        histogram("Timer lag", lagTimes);
+        histogram("Handler runs", handlerTimes);
+    }
+
+    text += "Slowest handlers:\n";
+    for (const auto& [name, maxUs, count, meanUs] : slowest())
+    {
+        std::snprintf(line, sizeof(line),
+                      "  %s max %lluus mean %lluus runs %llu\n", name.c_str(),
+                      static_cast<unsigned long long>(maxUs),
+                      static_cast<unsigned long long>(meanUs),
+                      static_cast<unsigned long long>(count));
+        text += line;
+    }
+    return text;
+}
+
+void Stats::reset()
+{
+    std::lock_guard lock{mutex};
+    handlerTimes.clear();
+    lagTimes.clear();
+    handlers.clear();
+}
+
+Stats& stats()
+{
+    static Stats processStats;
+    return processStats;
+}
+
+// Handlers running on this thread
+static thread_local unsigned depth = 0;
+
+Scope::Scope(const char* name) :
+    name(name), start(Clock::now()), outermost(depth++ == 0)
+{}
+
+Scope::~Scope()
+{
+    depth--;
+    if (!outermost)
+    {
+        return;
+    }
+
+    auto now = Clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(now - start)
+                  .count();
+    stats().handled(name, us, now);
+
+    if ((now - start) >= SLOW_HANDLER)
+    {
+        warning("{HANDLER} held the event loop for {DURATION_US}us",
+                "HANDLER", name, "DURATION_US", us);
+    }
+}
+
+} // namespace eventloop
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace eventloop
+{
+
+using Clock = std::chrono::steady_clock;
+
+/** @brief Upper bound of the first histogram bucket in us, each following
+ *  bucket doubles it and the last holds everything above
+ */
+constexpr uint64_t FIRST_BUCKET_US = 8;
+
+/** @brief Buckets in a histogram, 8us to 2.1s and the overflow */
+constexpr std::size_t BUCKETS = 20;
+
+/** @brief How far back the rolling histograms go */
+constexpr auto WINDOW = std::chrono::seconds{60};
+
+/** @brief Slots a window is kept in, the oldest is dropped as a whole */
+constexpr std::size_t WINDOW_SLOTS = 6;
+
+/** @brief Handlers at least this slow are logged as they finish */
+constexpr auto SLOW_HANDLER = std::chrono::milliseconds{500};
+
+/** @brief Handlers listed by the slowest handler report */
+constexpr std::size_t REPORT_HANDLERS = 10;
+
+/** @brief A bucket's upper bound in us, 0 for the overflow, and count */
+using Bucket = std::tuple<uint64_t, uint64_t>;
+
+/** @brief A handler's name, longest run in us, runs and mean run in us */
+using HandlerSummary = std::tuple<std::string, uint64_t, uint64_t, uint64_t>;
+
+/** @class Histogram
+ *  @brief Log2 histogram of the samples of the last WINDOW
+ */
+class Histogram
+{
+  public:
+    /** @brief Add a sample
+     *
+     * @param[in] now - When the sample was taken
+     * @param[in] us  - The sample
+     */
+    void add(Clock::time_point now, uint64_t us);
+
+    /** @brief Return the buckets over the window, the empty ones too */
+    std::vector<Bucket> buckets(Clock::time_point now) const;
+
+    /** @brief Return the samples in the window */
+    uint64_t count(Clock::time_point now) const;
+
+    /** @brief Return the largest sample in the window */
+    uint64_t max(Clock::time_point now) const;
+
+    /** @brief Return the upper bound of the bucket holding the given
+     *  percentile of the window, 0 if it's the overflow or there are no
+     *  samples
+     */
+    uint64_t percentile(Clock::time_point now, unsigned percent) const;
+
+    /** @brief Drop all samples */
+    void clear();
+
+  private:
+    struct Slot
+    {
+        /** @brief Which WINDOW / WINDOW_SLOTS period this holds */
+        int64_t period = -1;
+        std::array<uint64_t, BUCKETS> counts{};
+        uint64_t max = 0;
+    };
+
+    /** @brief Return the period a time falls in */
+    static int64_t periodOf(Clock::time_point now);
+
+    /** @brief Return whether a slot is in the window ending in a period */
+    static bool current(const Slot& slot, int64_t period);
+
+    std::array<Slot, WINDOW_SLOTS> slots;
+};
+
+/** @class Stats
+ *  @brief How long event loop handlers run for and how late the loop gets
+ *  to its timers, the wake-to-dispatch lag
+ *  @details Thread safe, as managers sharing a process may each have their
+ *  own loop.
+ */
+class Stats
+{
+  public:
+    /** @brief Record a run of a handler
+     *
+     * @param[in] name - The handler
+     * @param[in] us   - How long it ran for
+     * @param[in] now  - When it finished
+     */
+    void handled(const std::string& name, uint64_t us, Clock::time_point now);
+
+    /** @brief Record how late the loop dispatched a timer
+     *
+     * @param[in] us  - The lag
+     * @param[in] now - When it was dispatched
+     */
+    void lagged(uint64_t us, Clock::time_point now);
+
+    /** @brief Return the handlers with the longest runs since the start or
+     *  the last reset, longest first, at most REPORT_HANDLERS of them
+     */
+    std::vector<HandlerSummary> slowest() const;
+
+    /** @brief Return the histogram of handler run times */
+    std::vector<Bucket> handlerHistogram(Clock::time_point now) const;
+
+    /** @brief Return the histogram of the lag */
+    std::vector<Bucket> lagHistogram(Clock::time_point now) const;
+
+    /** @brief Return the largest lag in the window */
+    uint64_t lagMax(Clock::time_point now) const;
+
+    /** @brief Return the histograms and slowest handlers as text */
+    std::string report(Clock::time_point now) const;
+
+    /** @brief Drop everything recorded */
+    void reset();
+
+  private:
+    struct Handler
+    {
+        uint64_t count = 0;
+        uint64_t totalUs = 0;
+        uint64_t maxUs = 0;
+    };
+
+    mutable std::mutex mutex;
+
+    Histogram handlerTimes;
+
+    Histogram lagTimes;
+
+    std::map<std::string, Handler> handlers;
+};
+
+/** @brief Return the statistics of this process's handlers */
+Stats& stats();
+
+/** @class Scope
+ *  @brief Times a handler from construction until it goes out of scope
+ *  @details A handler called from within another is part of the outer
+ *  one's run, so only the outermost scope is recorded.
+ */
+class Scope
+{
+  public:
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope(Scope&&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+    /** @brief Start timing a handler
+     *
+     * @param[in] name - The handler, which must outlive the scope
+     */
+    explicit Scope(const char* name);
+
+    ~Scope();
+
+  private:
+    const char* name;
+    Clock::time_point start;
+    bool outermost;
+};
+
+/** @brief Wrap a match, timer or IO callback so its runs are recorded
+ *
+ * @param[in] name    - The handler, a string literal such as host.JobRemoved
+ * @param[in] handler - The callback
+ */
+template <typename Handler>
+auto timed(const char* name, Handler handler)
+{
+    return [name, handler = std::move(handler)](auto&&... args) mutable {
+        Scope scope{name};
+        return handler(std::forward<decltype(args)>(args)...);
+    };
+}
+
+} // namespace eventloop
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,126 @@
+#include "gpio_event_monitor.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+namespace
+{
+
+int64_t toNs(const timespec& ts)
+{
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/** @brief Convert an event timestamp to milliseconds since the epoch
+ *
+ *  Depending on the kernel, line events are stamped with either
+ *  CLOCK_REALTIME or CLOCK_MONOTONIC, so use whichever clock it is closer
+ *  to.
+ */
+uint64_t toEpochMs(const timespec& eventTs)
+{
+    timespec realNow{};
+    timespec monoNow{};
+    clock_gettime(CLOCK_REALTIME, &realNow);
+    clock_gettime(CLOCK_MONOTONIC, &monoNow);
+
+    auto event = toNs(eventTs);
+    auto realAge = toNs(realNow) - event;
+    auto monoAge = toNs(monoNow) - event;
+
+    auto epochNs = (std::abs(monoAge) < std::abs(realAge))
+                       ? toNs(realNow) - monoAge
+                       : event;
+    return static_cast<uint64_t>(epochNs / 1000000);
+}
+
+} // namespace
+
+GpioEventMonitor::GpioEventMonitor(const sdeventplus::Event& event,
+                                   const std::string& name,
+                                   Callback callback) :
+    name(name),
+    callback(std::move(callback))
+{
+    line = gpiod_line_find(name.c_str());
+    if (line == nullptr)
+    {
+        throw std::runtime_error("GPIO line " + name + " not found");
+    }
+
+    if (gpiod_line_request_both_edges_events(line, "state-manager") != 0)
+    {
+        gpiod_line_close_chip(line);
+        line = nullptr;
+        throw std::runtime_error("Failed to request events on GPIO line " +
+                                 name);
+    }
+
+    ioSource = std::make_unique<sdeventplus::source::IO>(
+        event, gpiod_line_event_get_fd(line), EPOLLIN,
+        [this](sdeventplus::source::IO&, int, uint32_t) { processEvents(); });
+
+    info("Monitoring GPIO {GPIO_NAME} for edges", "GPIO_NAME", name);
+}
+
+GpioEventMonitor::~GpioEventMonitor()
+{
+    ioSource.reset();
+    if (line != nullptr)
+    {
+        gpiod_line_close_chip(line);
+    }
+}
+
+int GpioEventMonitor::value() const
+{
+    return gpiod_line_get_value(line);
+}
+
+void GpioEventMonitor::processEvents()
+{
+    gpiod_line_event lineEvent{};
+
+    // Drain everything that's queued so a bounce doesn't leave a stale
+    // value behind, each edge is still reported in order
+    while (true)
+    {
+        timespec noWait{0, 0};
+        auto r = gpiod_line_event_wait(line, &noWait);
+        if (r <= 0)
+        {
+            if (r < 0)
+            {
+                error("Failed waiting on GPIO {GPIO_NAME} events: {ERRNO}",
+                      "GPIO_NAME", name, "ERRNO", errno);
+            }
+            return;
+        }
+
+        if (gpiod_line_event_read(line, &lineEvent) != 0)
+        {
+            error("Failed reading GPIO {GPIO_NAME} event: {ERRNO}",
+                  "GPIO_NAME", name, "ERRNO", errno);
+            return;
+        }
+
+        callback(lineEvent.event_type == GPIOD_LINE_EVENT_RISING_EDGE,
+                 toEpochMs(lineEvent.ts));
+    }
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <gpiod.h>
+
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/io.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class GpioEventMonitor
+ *  @brief Watch a named GPIO line for edges from an sd_event loop
+ *  @details The line is requested for both edge events and the callback is
+ *  run for each one with the new value and the time the kernel stamped on
+ *  the event, so the reported time doesn't include any scheduling delay.
+ */
+class GpioEventMonitor
+{
+  public:
+    /** @brief Called with the new line value and the event time, in
+     *  milliseconds since the epoch
+     */
+    using Callback = std::function<void(bool value, uint64_t timeMs)>;
+
+    GpioEventMonitor() = delete;
+    GpioEventMonitor(const GpioEventMonitor&) = delete;
+    GpioEventMonitor& operator=(const GpioEventMonitor&) = delete;
+    GpioEventMonitor(GpioEventMonitor&&) = delete;
+    GpioEventMonitor& operator=(GpioEventMonitor&&) = delete;
+    ~GpioEventMonitor();
+
+    /** @brief Request the line and start watching it
+     *
+     * @param[in] event    - The sd_event loop to watch from
+     * @param[in] name     - The GPIO line name
+     * @param[in] callback - Function run on each edge
+     *
+     * Throws std::runtime_error if the line can't be found or requested.
+     */
+    GpioEventMonitor(const sdeventplus::Event& event, const std::string& name,
+                     Callback callback);
+
+    /** @brief Return the current line value, -1 on error */
+    int value() const;
+
+  private:
+    /** @brief Read and dispatch the pending line events */
+    void processEvents();
+
+    /** @brief The GPIO line name */
+    const std::string name;
+
+    /** @brief Function run on each edge */
+    Callback callback;
+
+    /** @brief The requested line */
+    gpiod_line* line = nullptr;
+
+    /** @brief The event source watching the line's fd */
+    std::unique_ptr<sdeventplus::source::IO> ioSource;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -2,6 +2,9 @@
 
 #include "host_check.hpp"
 
+#include "state_probes.hpp"
+#include "state_snapshot.hpp"
+
 #include <unistd.h>
 
 #include <boost/range/adaptor/reversed.hpp>
@@ -58,6 +61,7 @@ bool checkFirmwareConditionRunning(sdbusplus::bus::bus& bus)
 
     try
     {
+        probes::MapperCall probe{"GetSubTree", CONDITION_HOST_INTERFACE};
         auto mapperResponseMsg = bus.call(mapper);
         mapperResponseMsg.read(mapperResponse);
     }
@@ -126,6 +130,14 @@ bool checkFirmwareConditionRunning(sdbusplus::bus::bus& bus)
 // Helper function to check if chassis power is on
 bool isChassiPowerOn(sdbusplus::bus::bus& bus)
 {
+    snapshot::Reader reader{STATE_SNAPSHOT_FILE};
+    auto powerState = reader.value(&snapshot::Snapshot::chassis,
+                                   snapshot::CurrentPowerState);
+    if (powerState)
+    {
+        return *powerState == "xyz.openbmc_project.State.Chassis.PowerState.On";
+    }
+
     try
     {
         auto method = bus.new_method_call(CHASSIS_STATE_SVC, CHASSIS_STATE_PATH,
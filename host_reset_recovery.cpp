@@ -1,5 +1,9 @@
 #include "config.h"
 
+#include "state_snapshot.hpp"
+
+#include <poll.h>
+#include <sys/inotify.h>
 #include <unistd.h>
 
 #include <phosphor-logging/elog.hpp>
@@ -9,9 +13,13 @@
 #include <xyz/openbmc_project/Logging/Create/server.hpp>
 #include <xyz/openbmc_project/Logging/Entry/server.hpp>
 
+#include <array>
+#include <chrono>
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <string>
+#include <thread>
 
 namespace phosphor
 {
@@ -38,8 +46,16 @@ constexpr auto SYSTEMD_INTERFACE = "org.freedesktop.systemd1.Manager";
 constexpr auto HOST_STATE_QUIESCE_TGT = "obmc-host-quiesce@0.target";
 constexpr auto FSI_SCAN_SVC = "fsi-scan@0.service";
 
-bool wasHostBooting(sdbusplus::bus::bus& bus)
+std::string getBootProgress(sdbusplus::bus::bus& bus)
 {
+    snapshot::Reader reader{STATE_SNAPSHOT_FILE};
+    auto bootProgress = reader.value(&snapshot::Snapshot::host,
+                                     snapshot::BootProgress);
+    if (bootProgress)
+    {
+        return *bootProgress;
+    }
+
     try
     {
         auto method = bus.new_method_call(HOST_STATE_SVC, HOST_STATE_PATH,
@@ -48,19 +64,9 @@ bool wasHostBooting(sdbusplus::bus::bus& bus)
 
         auto response = bus.call(method);
 
-        std::variant<std::string> bootProgress;
-        response.read(bootProgress);
-
-        if (std::get<std::string>(bootProgress) ==
-            "xyz.openbmc_project.State.Boot.Progress.ProgressStages."
-            "Unspecified")
-        {
-            info("Host was not booting before BMC reboot");
-            return false;
-        }
-
-        info("Host was booting before BMC reboot: {BOOTPROGRESS}",
-             "BOOTPROGRESS", std::get<std::string>(bootProgress));
+        std::variant<std::string> property;
+        response.read(property);
+        return std::get<std::string>(property);
     }
     catch (const sdbusplus::exception::exception& e)
     {
@@ -70,7 +76,20 @@ bool wasHostBooting(sdbusplus::bus::bus& bus)
 
         throw;
     }
+}
+
+bool wasHostBooting(sdbusplus::bus::bus& bus)
+{
+    auto bootProgress = getBootProgress(bus);
+    if (bootProgress ==
+        "xyz.openbmc_project.State.Boot.Progress.ProgressStages.Unspecified")
+    {
+        info("Host was not booting before BMC reboot");
+        return false;
+    }
 
+    info("Host was booting before BMC reboot: {BOOTPROGRESS}", "BOOTPROGRESS",
+         bootProgress);
     return true;
 }
 
@@ -111,19 +130,116 @@ void createErrorLog(sdbusplus::bus::bus& bus)
     }
 }
 
+namespace fs = std::filesystem;
+
 // Once CHASSIS_ON_FILE is removed, the obmc-chassis-poweron@.target has
 // completed and the phosphor-chassis-state-manager code has processed it.
-bool isChassisTargetComplete()
+fs::path getChassisOnFile()
 {
     auto size = std::snprintf(nullptr, 0, CHASSIS_ON_FILE, 0);
     size++; // null
     std::unique_ptr<char[]> buf(new char[size]);
     std::snprintf(buf.get(), size, CHASSIS_ON_FILE, 0);
 
-    std::ifstream f(buf.get());
+    return fs::path(buf.get());
+}
+
+bool isChassisTargetComplete(const fs::path& chassisOnFile)
+{
+    std::ifstream f(chassisOnFile);
     return !f.good();
 }
 
+/** @brief Wait until the chassis on file is removed
+ *
+ * Watches the file's directory with inotify so the wait ends as soon as the
+ * file is gone, falling back to polling every second if inotify can't be
+ * used.
+ *
+ * @param[in] timeout - How long to wait, 0 to wait forever
+ *
+ * @return true if the file was removed, false on timeout
+ */
+bool waitForChassisTarget(std::chrono::seconds timeout)
+{
+    using namespace std::chrono;
+
+    auto chassisOnFile = getChassisOnFile();
+    auto deadline = steady_clock::now() + timeout;
+    auto timedOut = [&]() {
+        return (timeout.count() != 0) && (steady_clock::now() >= deadline);
+    };
+
+    int fd = inotify_init1(IN_CLOEXEC);
+    int watchErrno = errno;
+    if (fd >= 0)
+    {
+        if (inotify_add_watch(fd, chassisOnFile.parent_path().c_str(),
+                              IN_DELETE | IN_MOVED_FROM) < 0)
+        {
+            // close() may overwrite errno
+            watchErrno = errno;
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if (fd < 0)
+    {
+        error("Failed to watch {PATH}, polling instead: {ERRNO}", "PATH",
+              chassisOnFile.string(), "ERRNO", watchErrno);
+
+        while (!isChassisTargetComplete(chassisOnFile))
+        {
+            if (timedOut())
+            {
+                return false;
+            }
+            debug("Waiting for chassis on target to complete");
+            std::this_thread::sleep_for(seconds(1));
+        }
+        return true;
+    }
+
+    // Checked after the watch is in place so a removal in between isn't
+    // missed
+    while (!isChassisTargetComplete(chassisOnFile))
+    {
+        int pollTimeout = -1;
+        if (timeout.count() != 0)
+        {
+            auto remaining =
+                duration_cast<milliseconds>(deadline - steady_clock::now());
+            if (remaining.count() <= 0)
+            {
+                close(fd);
+                return false;
+            }
+            pollTimeout = static_cast<int>(remaining.count());
+        }
+
+        debug("Waiting for chassis on target to complete");
+        pollfd pfd{fd, POLLIN, 0};
+        auto r = poll(&pfd, 1, pollTimeout);
+        if ((r < 0) && (errno != EINTR))
+        {
+            error("Failed to poll inotify fd: {ERRNO}", "ERRNO", errno);
+            close(fd);
+            return false;
+        }
+
+        // Only the file's existence matters, the events just wake us up
+        std::array<char, 4096> events;
+        while ((r > 0) && (read(fd, events.data(), events.size()) > 0))
+        {
+            r = poll(&pfd, 1, 0);
+        }
+    }
+
+    close(fd);
+    return true;
+}
+
 void moveToHostQuiesce(sdbusplus::bus::bus& bus)
 {
     try
@@ -180,14 +296,14 @@ int main()
 
     // Chassis power is on if this service starts but need to wait for the
     // obmc-chassis-poweron@.target to complete before potentially initiating
-    // another systemd target transition (i.e. Quiesce->Reboot)
-    while (!isChassisTargetComplete())
+    // another systemd target transition (i.e. Quiesce->Reboot). Unless a
+    // timeout is configured, wait until it happens or until system is
+    // powered off and this service is stopped.
+    if (!waitForChassisTarget(
+            std::chrono::seconds(HOST_RESET_RECOVERY_TIMEOUT)))
     {
-        debug("Waiting for chassis on target to complete");
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-
-        // There is no timeout here, wait until it happens or until system
-        // is powered off and this service is stopped
+        error("Timed out waiting for chassis on target to complete");
+        return 1;
     }
 
     info("Chassis power on has completed, checking if host is "
@@ -3,6 +3,9 @@
 #include "host_state_manager.hpp"
 
 #include "host_check.hpp"
+#include "io_worker.hpp"
+#include "power_restore_policy.hpp"
+#include "state_machine.hpp"
 #include "utils.hpp"
 
 #include <stdio.h>
@@ -20,10 +23,12 @@
 #include <xyz/openbmc_project/Common/error.hpp>
 #include <xyz/openbmc_project/Control/Power/RestorePolicy/server.hpp>
 
+#include <array>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <sstream>
 #include <string>
 
 // Register class version with Cereal
@@ -47,6 +52,7 @@ namespace osstatus =
 using namespace phosphor::logging;
 namespace fs = std::experimental::filesystem;
 using sdbusplus::xyz::openbmc_project::Common::Error::InternalFailure;
+using sdbusplus::xyz::openbmc_project::Common::Error::NotAllowed;
 
 // host-shutdown notifies host of shutdown and that leads to host-stop being
 // called so initiate a host shutdown with the -shutdown target and consider the
@@ -68,19 +74,25 @@ constexpr auto ACTIVE_STATE = "active";
 constexpr auto ACTIVATING_STATE = "activating";
 
 /* Map a transition to it's systemd target */
-const std::map<server::Host::Transition, std::string> SYSTEMD_TARGET_TABLE = {
-    {server::Host::Transition::Off, HOST_STATE_SOFT_POWEROFF_TGT},
-    {server::Host::Transition::On, HOST_STATE_POWERON_TGT},
-    {server::Host::Transition::Reboot, HOST_STATE_REBOOT_TGT},
+using HostTarget = sm::Target<server::Host::Transition>;
+constexpr std::array SYSTEMD_TARGET_TABLE = {
+    HostTarget{server::Host::Transition::Off, HOST_STATE_SOFT_POWEROFF_TGT},
+    HostTarget{server::Host::Transition::On, HOST_STATE_POWERON_TGT},
+    HostTarget{server::Host::Transition::Reboot, HOST_STATE_REBOOT_TGT},
 // Some systems do not support a warm reboot so just map the reboot
 // requests to our normal cold reboot in that case
 #if ENABLE_WARM_REBOOT
-    {server::Host::Transition::GracefulWarmReboot, HOST_STATE_WARM_REBOOT},
-    {server::Host::Transition::ForceWarmReboot, HOST_STATE_FORCE_WARM_REBOOT}};
+    HostTarget{server::Host::Transition::GracefulWarmReboot,
+               HOST_STATE_WARM_REBOOT},
+    HostTarget{server::Host::Transition::ForceWarmReboot,
+               HOST_STATE_FORCE_WARM_REBOOT}};
 #else
-    {server::Host::Transition::GracefulWarmReboot, HOST_STATE_REBOOT_TGT},
-    {server::Host::Transition::ForceWarmReboot, HOST_STATE_REBOOT_TGT}};
+    HostTarget{server::Host::Transition::GracefulWarmReboot,
+               HOST_STATE_REBOOT_TGT},
+    HostTarget{server::Host::Transition::ForceWarmReboot,
+               HOST_STATE_REBOOT_TGT}};
 #endif
+static_assert(sm::validTargets(SYSTEMD_TARGET_TABLE));
 
 constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
 constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
@@ -91,11 +103,9 @@ constexpr auto SYSTEMD_INTERFACE_UNIT = "org.freedesktop.systemd1.Unit";
 
 void Host::subscribeToSystemdSignals()
 {
-    auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
-                                            SYSTEMD_INTERFACE, "Subscribe");
     try
     {
-        this->bus.call_noreply(method);
+        utils::subscribeToSystemdSignals(this->systemdBus);
     }
     catch (const sdbusplus::exception::exception& e)
     {
@@ -130,19 +140,106 @@ void Host::determineInitialState()
     return;
 }
 
+void Host::runPowerRestorePolicy(std::optional<std::string> bmcRebootCause)
+{
+    // Only once per BMC boot, not again if this process is restarted
+    auto size = std::snprintf(nullptr, 0, HOST_POWER_RESTORE_DONE_FILE, 0);
+    size++; // null
+    std::unique_ptr<char[]> doneFile(new char[size]);
+    std::snprintf(doneFile.get(), size, HOST_POWER_RESTORE_DONE_FILE, 0);
+    if (fs::exists(doneFile.get()))
+    {
+        return;
+    }
+
+    // Marked once the policy has run or been skipped on purpose, so a
+    // failure is retried if the process is restarted
+    auto markDone = [&doneFile]() {
+        fs::create_directories(fs::path(doneFile.get()).parent_path());
+        std::ofstream{doneFile.get()};
+    };
+
+    // Same condition the discover unit has, it isn't run if chassis
+    // power is on
+    size = std::snprintf(nullptr, 0, CHASSIS_ON_FILE, 0);
+    size++; // null
+    std::unique_ptr<char[]> buf(new char[size]);
+    std::snprintf(buf.get(), size, CHASSIS_ON_FILE, 0);
+    if (fs::exists(buf.get()))
+    {
+        markDone();
+        return;
+    }
+
+    try
+    {
+        auto action = getPowerRestoreAction(
+            bus, settings, server::Host::requestedHostTransition(),
+            bmcRebootCause);
+        if (action)
+        {
+            logPowerRestoreTiming(*action);
+            if (action->restartCause)
+            {
+                server::Host::restartCause(*action->restartCause);
+            }
+            requestedHostTransition(action->transition);
+        }
+        markDone();
+    }
+    catch (const std::exception& e)
+    {
+        error("Error running power restore policy: {ERROR}", "ERROR", e);
+    }
+}
+
 void Host::executeTransition(Transition tranReq)
 {
-    auto sysdUnit = SYSTEMD_TARGET_TABLE.find(tranReq)->second;
+    auto sysdUnit = std::string{sm::findTarget(SYSTEMD_TARGET_TABLE, tranReq)};
 
-    auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
-                                            SYSTEMD_INTERFACE, "StartUnit");
+    auto method = this->systemdBus.new_method_call(
+        SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE, "StartUnit");
 
     method.append(sysdUnit);
     method.append("replace");
 
-    this->bus.call_noreply(method);
+    auto start = probes::now();
+    auto reply = this->systemdBus.call(method);
+    sdbusplus::message::object_path job;
+    reply.read(job);
+    STATE_PROBE(job_start, probes::Host, instance, sysdUnit.c_str(),
+                job.str.c_str(), probes::now() - start);
 
-    return;
+    pendingTransition.start(convertForMessage(tranReq), job);
+}
+
+bool Host::admitTransition(Transition tranReq)
+{
+    if (!pendingTransition.active())
+    {
+        return true;
+    }
+
+    auto request = convertForMessage(tranReq);
+    if (pendingTransition.matches(request))
+    {
+        info("Host transition {REQ} already in progress, coalescing",
+             "REQ", tranReq);
+        return false;
+    }
+
+#ifdef ENABLE_TRANSITION_REJECT
+    if (tranReq != server::Host::Transition::Off)
+    {
+        error("Rejecting host transition {REQ}, another is in progress",
+              "REQ", tranReq);
+        throw NotAllowed();
+    }
+#endif
+
+    info("Host transition {REQ} replaces the one in progress", "REQ",
+         tranReq);
+    return true;
 }
 
 bool Host::stateActive(const std::string& target)
@@ -150,14 +247,14 @@ bool Host::stateActive(const std::string& target)
     std::variant<std::string> currentState;
     sdbusplus::message::object_path unitTargetPath;
 
-    auto method = this->bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
-                                            SYSTEMD_INTERFACE, "GetUnit");
+    auto method = this->systemdBus.new_method_call(
+        SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE, "GetUnit");
 
     method.append(target);
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = this->systemdBus.call(method);
         result.read(unitTargetPath);
     }
     catch (const sdbusplus::exception::exception& e)
@@ -166,7 +263,7 @@ bool Host::stateActive(const std::string& target)
         return false;
     }
 
-    method = this->bus.new_method_call(
+    method = this->systemdBus.new_method_call(
         SYSTEMD_SERVICE,
         static_cast<const std::string&>(unitTargetPath).c_str(),
         SYSTEMD_PROPERTY_IFACE, "Get");
@@ -175,7 +272,7 @@ bool Host::stateActive(const std::string& target)
 
     try
     {
-        auto result = this->bus.call(method);
+        auto result = this->systemdBus.call(method);
         result.read(currentState);
     }
     catch (const sdbusplus::exception::exception& e)
@@ -249,9 +346,9 @@ bool Host::isAutoReboot()
                 // Generate log since we will now be sitting in Quiesce
                 const std::string errorMsg =
                     "xyz.openbmc_project.State.Error.HostQuiesce";
-                utils::createError(this->bus, errorMsg,
-                                   sdbusplus::xyz::openbmc_project::Logging::
-                                       server::Entry::Level::Critical);
+                utils::queueError(errorMsg,
+                                  sdbusplus::xyz::openbmc_project::Logging::
+                                      server::Entry::Level::Critical);
                 return false;
             }
         }
@@ -277,52 +374,31 @@ void Host::sysStateChangeJobRemoved(sdbusplus::message::message& msg)
 
     // Read the msg and populate each variable
     msg.read(newStateID, newStateObjPath, newStateUnit, newStateResult);
-
-    if ((newStateUnit == HOST_STATE_POWEROFF_TGT) &&
-        (newStateResult == "done") &&
-        (!stateActive(HOST_STATE_POWERON_MIN_TGT)))
-    {
-        info("Received signal that host is off");
-        this->currentHostState(server::Host::HostState::Off);
-        this->bootProgress(bootprogress::Progress::ProgressStages::Unspecified);
-        this->operatingSystemState(osstatus::Status::OSStatus::Inactive);
-    }
-    else if ((newStateUnit == HOST_STATE_POWERON_MIN_TGT) &&
-             (newStateResult == "done") &&
-             (stateActive(HOST_STATE_POWERON_MIN_TGT)))
-    {
-        info("Received signal that host is running");
-        this->currentHostState(server::Host::HostState::Running);
-
-        // Remove temporary file which is utilized for scenarios where the
-        // BMC is rebooted while the host is still up.
-        // This file is used to indicate to host related systemd services
-        // that the host is already running and they should skip running.
-        // Once the host state is back to running we can clear this file.
-        auto size = std::snprintf(nullptr, 0, HOST_RUNNING_FILE, 0);
-        size++; // null
-        std::unique_ptr<char[]> hostFile(new char[size]);
-        std::snprintf(hostFile.get(), size, HOST_RUNNING_FILE, 0);
-        if (std::filesystem::exists(hostFile.get()))
-        {
-            std::filesystem::remove(hostFile.get());
-        }
-    }
-    else if ((newStateUnit == HOST_STATE_QUIESCE_TGT) &&
-             (newStateResult == "done") &&
-             (stateActive(HOST_STATE_QUIESCE_TGT)))
-    {
-        if (Host::isAutoReboot())
-        {
-            info("Beginning reboot...");
-            Host::requestedHostTransition(server::Host::Transition::Reboot);
-        }
-        else
-        {
-            info("Maintaining quiesce");
-            this->currentHostState(server::Host::HostState::Quiesced);
-        }
-    }
+    STATE_PROBE(job_removed, probes::Host, instance, newStateUnit.c_str(),
+                newStateObjPath.str.c_str(), newStateResult.c_str());
+
+    pendingTransition.jobRemoved(newStateObjPath);
+
+    using HostRule = sm::Rule<Host, HostState>;
+    static constexpr auto machine = sm::makeEngine(
+        &Host::currentHostState, &Host::stateActive,
+        {HostRule{.event = HOST_STATE_POWEROFF_TGT,
+                  .result = "done",
+                  .guard = {HOST_STATE_POWERON_MIN_TGT, sm::Require::Inactive},
+                  .state = HostState::Off,
+                  .action = &Host::hostOff},
+         HostRule{.event = HOST_STATE_POWERON_MIN_TGT,
+                  .result = "done",
+                  .guard = {HOST_STATE_POWERON_MIN_TGT, sm::Require::Active},
+                  .state = HostState::Running,
+                  .action = &Host::hostRunning},
+         HostRule{.event = HOST_STATE_QUIESCE_TGT,
+                  .result = "done",
+                  .guard = {HOST_STATE_QUIESCE_TGT, sm::Require::Active},
+                  .action = &Host::hostQuiesced}});
+    static_assert(machine.valid());
+
+    machine.dispatch(*this, newStateUnit, newStateResult);
 }
 
 void Host::sysStateChangeJobNew(sdbusplus::message::message& msg)
@@ -334,10 +410,55 @@ void Host::sysStateChangeJobNew(sdbusplus::message::message& msg)
     // Read the msg and populate each variable
     msg.read(newStateID, newStateObjPath, newStateUnit);
 
-    if (newStateUnit == HOST_STATE_DIAGNOSTIC_MODE)
+    using HostRule = sm::Rule<Host, HostState>;
+    static constexpr auto machine = sm::makeEngine(
+        &Host::currentHostState, nullptr,
+        {HostRule{.event = HOST_STATE_DIAGNOSTIC_MODE,
+                  .state = HostState::DiagnosticMode}});
+    static_assert(machine.valid());
+
+    machine.dispatch(*this, newStateUnit);
+}
+
+void Host::hostOff()
+{
+    info("Received signal that host is off");
+    this->bootProgress(bootprogress::Progress::ProgressStages::Unspecified);
+    this->operatingSystemState(osstatus::Status::OSStatus::Inactive);
+}
+
+void Host::hostRunning()
+{
+    info("Received signal that host is running");
+
+    // Remove temporary file which is utilized for scenarios where the
+    // BMC is rebooted while the host is still up.
+    // This file is used to indicate to host related systemd services
+    // that the host is already running and they should skip running.
+    // Once the host state is back to running we can clear this file.
+    auto size = std::snprintf(nullptr, 0, HOST_RUNNING_FILE, 0);
+    size++; // null
+    std::unique_ptr<char[]> hostFile(new char[size]);
+    std::snprintf(hostFile.get(), size, HOST_RUNNING_FILE, 0);
+    if (std::filesystem::exists(hostFile.get()))
     {
-        info("Received signal that host is in diagnostice mode");
-        this->currentHostState(server::Host::HostState::DiagnosticMode);
+        std::filesystem::remove(hostFile.get());
+    }
+}
+
+void Host::hostQuiesced()
+{
+    if (Host::isAutoReboot())
+    {
+        // Whatever was in flight has been overtaken by the quiesce
+        pendingTransition.clear();
+        info("Beginning reboot...");
+        Host::requestedHostTransition(server::Host::Transition::Reboot);
+    }
+    else
+    {
+        info("Maintaining quiesce");
+        this->currentHostState(server::Host::HostState::Quiesced);
     }
 }
 
@@ -353,9 +474,12 @@ uint32_t Host::decrementRebootCount()
 
 fs::path Host::serialize(const fs::path& dir)
 {
-    std::ofstream os(dir.c_str(), std::ios::binary);
-    cereal::JSONOutputArchive oarchive(os);
-    oarchive(*this);
+    std::ostringstream os;
+    {
+        cereal::JSONOutputArchive oarchive(os);
+        oarchive(*this);
+    }
+    io::queueWrite(dir.string(), os.str(), probes::Host, instance);
     return dir;
 }
 
@@ -382,7 +506,16 @@ bool Host::deserialize(const fs::path& path)
 
 Host::Transition Host::requestedHostTransition(Transition value)
 {
+    eventloop::Scope scope{"host.RequestedHostTransition"};
     info("Host state transition request of {REQ}", "REQ", value);
+    STATE_PROBE(transition_request, probes::Host, instance,
+                convertForMessage(value).c_str());
+
+    if (!admitTransition(value))
+    {
+        return server::Host::requestedHostTransition();
+    }
+
     // If this is not a power off request then we need to
     // decrement the reboot counter.  This code should
     // never prevent a power on, it should just decrement
@@ -397,6 +530,7 @@ Host::Transition Host::requestedHostTransition(Transition value)
 
     auto retVal = server::Host::requestedHostTransition(value);
     serialize();
+    publishSnapshot();
     return retVal;
 }
 
@@ -404,6 +538,7 @@ Host::ProgressStages Host::bootProgress(ProgressStages value)
 {
     auto retVal = bootprogress::Progress::bootProgress(value);
     serialize();
+    publishSnapshot();
     return retVal;
 }
 
@@ -411,13 +546,37 @@ Host::OSStatus Host::operatingSystemState(OSStatus value)
 {
     auto retVal = osstatus::Status::operatingSystemState(value);
     serialize();
+    publishSnapshot();
     return retVal;
 }
 
 Host::HostState Host::currentHostState(HostState value)
 {
     info("Change to Host State: {STATE}", "STATE", value);
-    return server::Host::currentHostState(value);
+    auto start = probes::now();
+    auto previous = server::Host::currentHostState();
+    auto retVal = server::Host::currentHostState(value);
+    if (retVal != previous)
+    {
+        journalWriter.append(journal::Source::Host,
+                             convertForMessage(previous),
+                             convertForMessage(retVal));
+    }
+    publishSnapshot();
+    STATE_PROBE(state_publish, probes::Host, instance,
+                convertForMessage(previous).c_str(),
+                convertForMessage(retVal).c_str(), probes::now() - start);
+    return retVal;
+}
+
+void Host::publishSnapshot()
+{
+    snapshotWriter.publish(
+        &snapshot::Snapshot::host,
+        {convertForMessage(server::Host::currentHostState()),
+         convertForMessage(server::Host::requestedHostTransition()),
+         convertForMessage(bootprogress::Progress::bootProgress()),
+         convertForMessage(osstatus::Status::operatingSystemState())});
 }
 
 } // namespace manager
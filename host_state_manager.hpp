@@ -2,19 +2,26 @@
 
 #include "config.h"
 
+#include "event_loop_stats.hpp"
+#include "pending_transition.hpp"
 #include "settings.hpp"
+#include "state_journal.hpp"
+#include "state_probes.hpp"
+#include "state_snapshot.hpp"
 #include "xyz/openbmc_project/State/Host/server.hpp"
 
 #include <cereal/access.hpp>
 #include <cereal/cereal.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
 #include <xyz/openbmc_project/Control/Boot/RebootAttempts/server.hpp>
 #include <xyz/openbmc_project/State/Boot/Progress/server.hpp>
 #include <xyz/openbmc_project/State/OperatingSystem/Status/server.hpp>
 
 #include <experimental/filesystem>
 #include <functional>
+#include <optional>
 #include <string>
 
 namespace phosphor
@@ -32,6 +39,11 @@ using HostInherit = sdbusplus::server::object::object<
 
 PHOSPHOR_LOG2_USING;
 
+/** @brief Priority of the connection systemd is talked to on, ahead of the
+ *  SD_EVENT_PRIORITY_NORMAL one the host's properties are served on
+ */
+constexpr auto SYSTEMD_EVENT_PRIORITY = SD_EVENT_PRIORITY_IMPORTANT;
+
 namespace sdbusRule = sdbusplus::bus::match::rules;
 namespace fs = std::experimental::filesystem;
 
@@ -53,35 +65,74 @@ class Host : public HostInherit
      * @param[in] objPath   - The Dbus object path
      */
     Host(sdbusplus::bus::bus& bus, const char* objPath) :
-        HostInherit(bus, objPath, true), bus(bus),
+        Host(bus, bus, objPath)
+    {}
+
+    /** @brief Constructs Host State Manager talking to systemd on its own
+     *  connection
+     *
+     * @details The JobRemoved signals and unit calls go on systemdBus, so
+     *          attaching it at SYSTEMD_EVENT_PRIORITY has a finished power
+     *          target handled ahead of any property traffic queued on bus.
+     *
+     * @param[in] bus        - The Dbus bus object
+     * @param[in] systemdBus - The Dbus bus object for systemd
+     * @param[in] objPath    - The Dbus object path
+     */
+    Host(sdbusplus::bus::bus& bus, sdbusplus::bus::bus& systemdBus,
+         const char* objPath) :
+        HostInherit(bus, objPath, true), bus(bus), systemdBus(systemdBus),
         systemdSignalJobRemoved(
-            bus,
+            systemdBus,
             sdbusRule::type::signal() + sdbusRule::member("JobRemoved") +
                 sdbusRule::path("/org/freedesktop/systemd1") +
                 sdbusRule::interface("org.freedesktop.systemd1.Manager"),
-            std::bind(std::mem_fn(&Host::sysStateChangeJobRemoved), this,
-                      std::placeholders::_1)),
+            eventloop::timed(
+                "host.JobRemoved",
+                std::bind(std::mem_fn(&Host::sysStateChangeJobRemoved), this,
+                          std::placeholders::_1))),
         systemdSignalJobNew(
-            bus,
+            systemdBus,
             sdbusRule::type::signal() + sdbusRule::member("JobNew") +
                 sdbusRule::path("/org/freedesktop/systemd1") +
                 sdbusRule::interface("org.freedesktop.systemd1.Manager"),
-            std::bind(std::mem_fn(&Host::sysStateChangeJobNew), this,
-                      std::placeholders::_1)),
-        settings(bus)
+            eventloop::timed(
+                "host.JobNew",
+                std::bind(std::mem_fn(&Host::sysStateChangeJobNew), this,
+                          std::placeholders::_1))),
+        settings(bus), pendingTransition(bus, objPath, PENDING_INTERFACE),
+        snapshotWriter(STATE_SNAPSHOT_FILE),
+        journalWriter(sdeventplus::Event::get_default(), STATE_JOURNAL_FILE,
+                      STATE_JOURNAL_PERSIST_PATH, STATE_JOURNAL_ENTRIES),
+        instance(probes::instanceOf(objPath))
     {
         // Enable systemd signals
         subscribeToSystemdSignals();
 
         // Will throw exception on fail
         determineInitialState();
+        publishSnapshot();
 
         attemptsLeft(BOOT_COUNT_MAX_ALLOWED);
 
         // We deferred this until we could get our property correct
         this->emit_object_added();
+
+        pendingTransition.emitAdded();
     }
 
+    /**
+     * @brief Run the power restore policy if chassis power is off
+     *
+     * Does what phosphor-discover-system-state would, but with the
+     * settings and host state this process already has.
+     *
+     * @param[in] bmcRebootCause - The BMC's LastRebootCause, read from its
+     *                             object if not given
+     **/
+    void runPowerRestorePolicy(
+        std::optional<std::string> bmcRebootCause = std::nullopt);
+
     /** @brief Set value of HostTransition */
     Transition requestedHostTransition(Transition value) override;
 
@@ -119,6 +170,10 @@ class Host : public HostInherit
     }
 
   private:
+    /** @brief The pending transition D-Bus interface name */
+    static constexpr auto PENDING_INTERFACE =
+        "xyz.openbmc_project.State.Host.Pending";
+
     /**
      * @brief subscribe to the systemd signals
      *
@@ -135,15 +190,34 @@ class Host : public HostInherit
      **/
     void determineInitialState();
 
+    /** @brief Publish the host state, requested transition, boot progress
+     *  and OS status to the state snapshot
+     */
+    void publishSnapshot();
+
     /** @brief Execute the transition request
      *
      * This function assumes the state has been validated and the host
      * is in an appropriate state for the transition to be started.
+     * The queued job is recorded as the pending transition.
      *
      * @param[in] tranReq    - Transition requested
      */
     void executeTransition(Transition tranReq);
 
+    /** @brief Decide what to do with a request while a job is in flight
+     *
+     * A request for the pending transition is coalesced into its job.
+     * A conflicting request replaces the pending job, unless conflicting
+     * requests are configured to be rejected. Off always replaces it.
+     *
+     * @param[in] tranReq    - Transition requested
+     *
+     * @return true if a new job is needed, false if coalesced. Throws
+     *         NotAllowed if the request is rejected.
+     */
+    bool admitTransition(Transition tranReq);
+
     /**
      * @brief Determine if target is active
      *
@@ -186,6 +260,17 @@ class Host : public HostInherit
      */
     void sysStateChangeJobNew(sdbusplus::message::message& msg);
 
+    /** @brief Finish the host being powered off */
+    void hostOff();
+
+    /** @brief Finish the host starting */
+    void hostRunning();
+
+    /** @brief Reboot the quiesced host if auto reboot is enabled, otherwise
+     *  leave it quiesced
+     */
+    void hostQuiesced();
+
     /** @brief Decrement reboot count
      *
      * This is used internally to this application to decrement the boot
@@ -249,7 +334,8 @@ class Host : public HostInherit
                 Host::convertOSStatusFromString(osState));
     }
 
-    /** @brief Serialize and persist requested host state
+    /** @brief Serialize requested host state and queue persisting it on
+     *  the I/O worker
      *
      *  @param[in] dir - pathname of file where the serialized host state will
      *                   be placed.
@@ -270,6 +356,11 @@ class Host : public HostInherit
     /** @brief Persistent sdbusplus DBus bus connection. */
     sdbusplus::bus::bus& bus;
 
+    /** @brief Connection systemd's signals and unit calls go on, which may
+     *  be bus
+     */
+    sdbusplus::bus::bus& systemdBus;
+
     /** @brief Used to subscribe to dbus systemd JobRemoved signal **/
     sdbusplus::bus::match_t systemdSignalJobRemoved;
 
@@ -278,6 +369,18 @@ class Host : public HostInherit
 
     // Settings objects of interest
     settings::Objects settings;
+
+    /** @brief The transition whose job is in flight */
+    PendingTransition pendingTransition;
+
+    /** @brief Publishes the host state to the local state snapshot */
+    snapshot::Writer snapshotWriter;
+
+    /** @brief Records host state changes */
+    journal::Writer journalWriter;
+
+    /** @brief The host number, for probes */
+    const uint32_t instance;
 };
 
 } // namespace manager
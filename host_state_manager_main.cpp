@@ -1,19 +1,35 @@
 #include "config.h"
 
+#include "event_loop_monitor.hpp"
 #include "host_state_manager.hpp"
+#include "startup_timing.hpp"
 
+#include <systemd/sd-bus.h>
+
+#include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
 
 #include <cstdlib>
 #include <exception>
 #include <experimental/filesystem>
 #include <iostream>
+#include <utility>
 
 int main()
 {
     namespace fs = std::experimental::filesystem;
+    namespace startup = phosphor::state::manager::startup;
+
+    startup::milestone("main");
 
+    auto event = sdeventplus::Event::get_default();
     auto bus = sdbusplus::bus::new_default();
+    // systemd gets a connection of its own so a finished power target isn't
+    // queued behind property traffic. new_default() would hand back the
+    // same connection again.
+    auto systemdBus = sdbusplus::bus::new_system();
+    startup::milestone("bus");
 
     // For now, we only have one instance of the host
     auto objPathInst = std::string{HOST_OBJPATH} + '0';
@@ -21,17 +37,38 @@ int main()
     // Add sdbusplus ObjectManager.
     sdbusplus::server::manager::manager objManager(bus, objPathInst.c_str());
 
-    phosphor::state::manager::Host manager(bus, objPathInst.c_str());
+    phosphor::state::manager::Host manager(bus, systemdBus,
+                                           objPathInst.c_str());
+    phosphor::state::manager::eventloop::Monitor loopMonitor(bus, event,
+                                                             objPathInst);
+#ifdef ENABLE_HOST_POWER_RESTORE
+    manager.runPowerRestorePolicy();
+#endif
+    startup::milestone("constructed");
 
     auto dir = fs::path(HOST_STATE_PERSIST_PATH).parent_path();
     fs::create_directories(dir);
 
     bus.request_name(HOST_BUSNAME);
+    startup::milestone(startup::READY);
 
-    while (true)
+    // Attach the buses to sd_event so the timers run alongside them, with
+    // anything pending from systemd dispatched first. attach_event() drops
+    // the result, and a bus that isn't attached is never read.
+    for (auto [connection, priority] :
+         {std::pair{bus.get(), SD_EVENT_PRIORITY_NORMAL},
+          std::pair{systemdBus.get(),
+                    phosphor::state::manager::SYSTEMD_EVENT_PRIORITY}})
     {
-        bus.process_discard();
-        bus.wait();
+        auto r = sd_bus_attach_event(connection, event.get(), priority);
+        if (r < 0)
+        {
+            lg2::error("Failed to attach the bus to the event loop: {ERRNO}",
+                       "ERRNO", -r);
+            return EXIT_FAILURE;
+        }
     }
+    event.loop();
+
     return 0;
 }
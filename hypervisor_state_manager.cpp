@@ -2,6 +2,8 @@
 
 #include "hypervisor_state_manager.hpp"
 
+#include "state_machine.hpp"
+
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/exception.hpp>
@@ -29,6 +31,8 @@ server::Host::Transition Hypervisor::requestedHostTransition(Transition value)
 {
     info("Hypervisor state transition request of {TRAN_REQUEST}",
          "TRAN_REQUEST", value);
+    STATE_PROBE(transition_request, probes::Hypervisor, instance,
+                convertForMessage(value).c_str());
 
     // Only support the transition to On
     if (value != server::Host::Transition::On)
@@ -47,7 +51,13 @@ server::Host::Transition Hypervisor::requestedHostTransition(Transition value)
 server::Host::HostState Hypervisor::currentHostState(HostState value)
 {
     info("Change to Hypervisor State: {HYP_STATE}", "HYP_STATE", value);
-    return server::Host::currentHostState(value);
+    auto start = probes::now();
+    auto previous = server::Host::currentHostState();
+    auto retVal = server::Host::currentHostState(value);
+    STATE_PROBE(state_publish, probes::Hypervisor, instance,
+                convertForMessage(previous).c_str(),
+                convertForMessage(retVal).c_str(), probes::now() - start);
+    return retVal;
 }
 
 server::Host::HostState Hypervisor::currentHostState()
@@ -59,31 +69,29 @@ void Hypervisor::updateCurrentHostState(std::string& bootProgress)
 {
     debug("New BootProgress: {BOOTPROGRESS}", "BOOTPROGRESS", bootProgress);
 
-    if (bootProgress == "xyz.openbmc_project.State.Boot.Progress."
-                        "ProgressStages.SystemInitComplete")
-    {
-        currentHostState(server::Host::HostState::Standby);
-    }
-    else if (bootProgress == "xyz.openbmc_project.State.Boot.Progress."
-                             "ProgressStages.OSStart")
-    {
-        currentHostState(server::Host::HostState::TransitioningToRunning);
-    }
-    else if (bootProgress == "xyz.openbmc_project.State.Boot.Progress."
-                             "ProgressStages.OSRunning")
-    {
-        currentHostState(server::Host::HostState::Running);
-    }
-    else if (bootProgress == "xyz.openbmc_project.State.Boot.Progress."
-                             "ProgressStages.Unspecified")
-    {
-        // Unspecified is set when the system is powered off so
-        // set the state to off and reset the requested host state
-        // back to its default
-        currentHostState(server::Host::HostState::Off);
-        server::Host::requestedHostTransition(server::Host::Transition::Off);
-    }
-    else
+    using HypervisorRule = sm::Rule<Hypervisor, server::Host::HostState>;
+    static constexpr auto machine = sm::makeEngine(
+        &Hypervisor::currentHostState, nullptr,
+        {HypervisorRule{.event = "xyz.openbmc_project.State.Boot.Progress."
+                                 "ProgressStages.SystemInitComplete",
+                        .state = server::Host::HostState::Standby},
+         HypervisorRule{.event = "xyz.openbmc_project.State.Boot.Progress."
+                                 "ProgressStages.OSStart",
+                        .state =
+                            server::Host::HostState::TransitioningToRunning},
+         HypervisorRule{.event = "xyz.openbmc_project.State.Boot.Progress."
+                                 "ProgressStages.OSRunning",
+                        .state = server::Host::HostState::Running},
+         // Unspecified is set when the system is powered off so
+         // set the state to off and reset the requested host state
+         // back to its default
+         HypervisorRule{.event = "xyz.openbmc_project.State.Boot.Progress."
+                                 "ProgressStages.Unspecified",
+                        .state = server::Host::HostState::Off,
+                        .action = &Hypervisor::resetRequestedTransition}});
+    static_assert(machine.valid());
+
+    if (!machine.dispatch(*this, bootProgress))
     {
         // BootProgress changed and it is not one of the above so
         // set hypervisor state to off
@@ -91,6 +99,11 @@ void Hypervisor::updateCurrentHostState(std::string& bootProgress)
     }
 }
 
+void Hypervisor::resetRequestedTransition()
+{
+    server::Host::requestedHostTransition(server::Host::Transition::Off);
+}
+
 void Hypervisor::bootProgressChangeEvent(sdbusplus::message::message& msg)
 {
     std::string statusInterface;
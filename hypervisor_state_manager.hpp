@@ -2,7 +2,9 @@
 
 #include "config.h"
 
+#include "event_loop_stats.hpp"
 #include "settings.hpp"
+#include "state_probes.hpp"
 #include "xyz/openbmc_project/State/Host/server.hpp"
 
 #include <sdbusplus/bus.hpp>
@@ -47,8 +49,11 @@ class Hypervisor : public HypervisorInherit
             sdbusRule::propertiesChanged(
                 "/xyz/openbmc_project/state/host0",
                 "xyz.openbmc_project.State.Boot.Progress"),
-            std::bind(std::mem_fn(&Hypervisor::bootProgressChangeEvent), this,
-                      std::placeholders::_1))
+            eventloop::timed(
+                "hypervisor.BootProgress",
+                std::bind(std::mem_fn(&Hypervisor::bootProgressChangeEvent),
+                          this, std::placeholders::_1))),
+        instance(probes::instanceOf(objPath))
     {}
 
     /** @brief Set value of HostTransition */
@@ -80,11 +85,17 @@ class Hypervisor : public HypervisorInherit
      */
     void bootProgressChangeEvent(sdbusplus::message::message& msg);
 
+    /** @brief Set the requested transition back to its default of Off */
+    void resetRequestedTransition();
+
     /** @brief Persistent sdbusplus DBus bus connection. */
     sdbusplus::bus::bus& bus;
 
     /** @brief Watch BootProgress changes to know hypervisor state **/
     sdbusplus::bus::match_t bootProgressChangeSignal;
+
+    /** @brief The hypervisor number, for probes */
+    const uint32_t instance;
 };
 
 } // namespace manager
@@ -1,14 +1,23 @@
 #include "config.h"
 
+#include "event_loop_monitor.hpp"
 #include "hypervisor_state_manager.hpp"
+#include "startup_timing.hpp"
 
 #include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
 
 #include <cstdlib>
 
 int main()
 {
+    namespace startup = phosphor::state::manager::startup;
+
+    startup::milestone("main");
+
+    auto event = sdeventplus::Event::get_default();
     auto bus = sdbusplus::bus::new_default();
+    startup::milestone("bus");
 
     // For now, we only have one instance of the hypervisor
     auto objPathInst = std::string{HYPERVISOR_OBJPATH} + '0';
@@ -17,13 +26,16 @@ int main()
     sdbusplus::server::manager::manager objManager(bus, objPathInst.c_str());
 
     phosphor::state::manager::Hypervisor manager(bus, objPathInst.c_str());
+    phosphor::state::manager::eventloop::Monitor loopMonitor(bus, event,
+                                                             objPathInst);
+    startup::milestone("constructed");
 
     bus.request_name(HYPERVISOR_BUSNAME);
+    startup::milestone(startup::READY);
+
+    // Attach the bus to sd_event so the timers run alongside it
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    event.loop();
 
-    while (true)
-    {
-        bus.process_discard();
-        bus.wait();
-    }
     return 0;
 }
@@ -0,0 +1,155 @@
+#include "io_worker.hpp"
+
+#include <signal.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <exception>
+#include <fstream>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace io
+{
+
+PHOSPHOR_LOG2_USING;
+
+Worker::Worker()
+{
+    // The thread takes the mask it's started with, and the signals are
+    // the event loop's to handle
+    sigset_t all;
+    sigset_t previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    thread = std::thread{&Worker::run, this};
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+Worker::~Worker()
+{
+    stopping.store(true, std::memory_order_release);
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+    thread.join();
+}
+
+void Worker::queue(std::function<void()> job)
+{
+    Job entry{std::move(job), Clock::now()};
+    while (true)
+    {
+        auto done = finished.load(std::memory_order_acquire);
+        if (jobs.push(entry))
+        {
+            break;
+        }
+        finished.wait(done, std::memory_order_acquire);
+    }
+
+    queued.fetch_add(1, std::memory_order_release);
+    wakeups.fetch_add(1, std::memory_order_release);
+    wakeups.notify_one();
+}
+
+void Worker::drain()
+{
+    auto target = queued.load(std::memory_order_relaxed);
+    auto done = finished.load(std::memory_order_acquire);
+    while (done < target)
+    {
+        finished.wait(done, std::memory_order_acquire);
+        done = finished.load(std::memory_order_acquire);
+    }
+}
+
+uint64_t Worker::depth() const
+{
+    // Finished first, as queued can't fall behind it
+    auto done = finished.load(std::memory_order_acquire);
+    return queued.load(std::memory_order_acquire) - done;
+}
+
+uint64_t Worker::maxLatencyUs() const
+{
+    return maxUs.load(std::memory_order_relaxed);
+}
+
+void Worker::reset()
+{
+    maxUs.store(0, std::memory_order_relaxed);
+}
+
+void Worker::run()
+{
+    while (true)
+    {
+        auto seen = wakeups.load(std::memory_order_acquire);
+        runQueued();
+        if (stopping.load(std::memory_order_acquire))
+        {
+            // Everything queued before the stop is visible now
+            runQueued();
+            return;
+        }
+        wakeups.wait(seen, std::memory_order_acquire);
+    }
+}
+
+void Worker::runQueued()
+{
+    while (auto job = jobs.pop())
+    {
+        try
+        {
+            job->work();
+        }
+        catch (const std::exception& e)
+        {
+            error("I/O worker job failed: {ERROR}", "ERROR", e);
+        }
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      Clock::now() - job->queued)
+                      .count();
+        auto longest = maxUs.load(std::memory_order_relaxed);
+        while ((static_cast<uint64_t>(us) > longest) &&
+               !maxUs.compare_exchange_weak(longest, us,
+                                            std::memory_order_relaxed))
+        {}
+
+        finished.fetch_add(1, std::memory_order_release);
+        finished.notify_all();
+    }
+}
+
+Worker& worker()
+{
+    // One per event loop thread, so each worker has a single producer
+    static thread_local Worker threadWorker;
+    return threadWorker;
+}
+
+void queueWrite(std::string path, std::string contents,
+                probes::Manager manager, uint32_t instance)
+{
+    worker().queue([path = std::move(path), contents = std::move(contents),
+                    manager, instance]() {
+        probes::PersistWrite probe{manager, instance, path.c_str()};
+        std::ofstream os(path, std::ios::binary);
+        os << contents;
+        if (!os)
+        {
+            error("Failed writing {PATH}", "PATH", path);
+        }
+    });
+}
+
+} // namespace io
+} // namespace manager
+} // namespace state
+} // namespace phosphor
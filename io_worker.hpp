@@ -0,0 +1,181 @@
+#pragma once
+
+#include "state_probes.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace io
+{
+
+using Clock = std::chrono::steady_clock;
+
+/** @brief Jobs a worker holds, queueing more waits for one to finish */
+constexpr std::size_t QUEUE_SIZE = 64;
+
+/** @class SpscQueue
+ *  @brief Bounded lock-free FIFO for one producer and one consumer thread
+ *  @details push() may only be called from the producer and pop() from the
+ *  consumer. size() may be called from anywhere.
+ */
+template <typename T, std::size_t N>
+class SpscQueue
+{
+    static_assert(std::has_single_bit(N), "N must be a power of two");
+
+  public:
+    /** @brief Add an item, moving from it only if there's room
+     *
+     * @return false if the queue is full
+     */
+    bool push(T& item)
+    {
+        auto back = tail.load(std::memory_order_relaxed);
+        if (back - head.load(std::memory_order_acquire) == N)
+        {
+            return false;
+        }
+        slots[back % N] = std::move(item);
+        tail.store(back + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Remove the oldest item, nullopt if the queue is empty */
+    std::optional<T> pop()
+    {
+        auto front = head.load(std::memory_order_relaxed);
+        if (front == tail.load(std::memory_order_acquire))
+        {
+            return std::nullopt;
+        }
+        auto item = std::exchange(slots[front % N], T{});
+        head.store(front + 1, std::memory_order_release);
+        return item;
+    }
+
+    /** @brief Return the items queued, which may be stale by the time it's
+     *  used unless called from the producer or consumer
+     */
+    std::size_t size() const
+    {
+        // The head first, as the tail can't fall behind it
+        auto front = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - front;
+    }
+
+  private:
+    std::array<T, N> slots{};
+
+    /** @brief Items popped, only written by the consumer */
+    alignas(64) std::atomic<uint64_t> head{0};
+
+    /** @brief Items pushed, only written by the producer */
+    alignas(64) std::atomic<uint64_t> tail{0};
+};
+
+/** @class Worker
+ *  @brief Thread the file writes and error logs of an event loop run on, so
+ *  a slow flash or logging daemon doesn't hold the loop up
+ *  @details Jobs run one at a time in the order they were queued. Only the
+ *  thread that created the worker may queue to it, which worker() takes
+ *  care of. Whatever a job needs must be copied into it, as it runs
+ *  alongside the loop. Jobs still queued when the worker is destroyed are
+ *  run first, but are lost if the process is killed.
+ */
+class Worker
+{
+  public:
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+    Worker(Worker&&) = delete;
+    Worker& operator=(Worker&&) = delete;
+
+    /** @brief Start the thread, with every signal blocked in it */
+    Worker();
+
+    /** @brief Run what's left and stop the thread */
+    ~Worker();
+
+    /** @brief Queue a job, waiting for room if the queue is full
+     *
+     * @param[in] job - The job, exceptions it throws are logged
+     */
+    void queue(std::function<void()> job);
+
+    /** @brief Wait for every job queued so far to finish */
+    void drain();
+
+    /** @brief Return the jobs queued or running */
+    uint64_t depth() const;
+
+    /** @brief Return the longest a job took from being queued to finishing,
+     *  since the start or the last reset
+     */
+    uint64_t maxLatencyUs() const;
+
+    /** @brief Start the longest time over */
+    void reset();
+
+  private:
+    struct Job
+    {
+        std::function<void()> work;
+        Clock::time_point queued;
+    };
+
+    /** @brief The thread's loop */
+    void run();
+
+    /** @brief Run the jobs queued until the queue is empty */
+    void runQueued();
+
+    SpscQueue<Job, QUEUE_SIZE> jobs;
+
+    /** @brief Jobs queued, only written by the producer */
+    std::atomic<uint64_t> queued{0};
+
+    /** @brief Bumped to wake the thread */
+    std::atomic<uint64_t> wakeups{0};
+
+    /** @brief Jobs finished, the producer waits on it for room */
+    std::atomic<uint64_t> finished{0};
+
+    std::atomic<uint64_t> maxUs{0};
+
+    std::atomic<bool> stopping{false};
+
+    std::thread thread;
+};
+
+/** @brief Return the calling thread's worker, started on first use */
+Worker& worker();
+
+/** @brief Queue replacing a file's contents on the calling thread's worker
+ *
+ * @param[in] path     - The file
+ * @param[in] contents - What to write to it
+ * @param[in] manager  - The manager writing it, for probes
+ * @param[in] instance - The manager's instance, for probes
+ */
+void queueWrite(std::string path, std::string contents,
+                probes::Manager manager, uint32_t instance);
+
+} // namespace io
+} // namespace manager
+} // namespace state
+} // namespace phosphor
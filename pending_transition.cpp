@@ -0,0 +1,70 @@
+#include "pending_transition.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+PendingTransition::PendingTransition(sdbusplus::bus::bus& bus,
+                                     const std::string& objPath,
+                                     const std::string& interface) :
+    intf(bus, objPath, interface)
+{
+    intf.addProperty<std::string>("Transition",
+                                  [this]() { return transition; });
+    intf.addProperty<sdbusplus::message::object_path>("Job",
+                                                      [this]() { return job; });
+}
+
+void PendingTransition::emitAdded()
+{
+    intf.emitAdded();
+}
+
+void PendingTransition::start(const std::string& value,
+                              const sdbusplus::message::object_path& newJob)
+{
+    transition = value;
+    job = newJob;
+
+    intf.propertyChanged("Transition");
+    intf.propertyChanged("Job");
+}
+
+bool PendingTransition::jobRemoved(
+    const sdbusplus::message::object_path& removed)
+{
+    if (!active() || (removed.str != job.str))
+    {
+        return false;
+    }
+
+    debug("Pending transition {TRANSITION} job {JOB} removed", "TRANSITION",
+          transition, "JOB", job.str);
+    clear();
+    return true;
+}
+
+void PendingTransition::clear()
+{
+    if (!active())
+    {
+        return;
+    }
+
+    transition.clear();
+    job = sdbusplus::message::object_path{"/"};
+
+    intf.propertyChanged("Transition");
+    intf.propertyChanged("Job");
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "property_interface.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/message/types.hpp>
+
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class PendingTransition
+ *  @brief Tracks the transition whose systemd job is in flight
+ *  @details The transition is published with the job path so clients can
+ *  wait for the Transition property to go empty instead of re-issuing the
+ *  request. Transitions are held as their D-Bus string so the same class
+ *  serves the host and chassis enums.
+ */
+class PendingTransition
+{
+  public:
+    PendingTransition() = delete;
+    PendingTransition(const PendingTransition&) = delete;
+    PendingTransition& operator=(const PendingTransition&) = delete;
+    PendingTransition(PendingTransition&&) = delete;
+    PendingTransition& operator=(PendingTransition&&) = delete;
+    ~PendingTransition() = default;
+
+    /** @brief Constructs the tracker, nothing is put on D-Bus yet
+     *
+     * @param[in] bus       - The Dbus bus object
+     * @param[in] objPath   - The Dbus object path
+     * @param[in] interface - The Dbus interface name
+     */
+    PendingTransition(sdbusplus::bus::bus& bus, const std::string& objPath,
+                      const std::string& interface);
+
+    /** @brief Register the interface and emit InterfacesAdded */
+    void emitAdded();
+
+    /** @brief Return true if a transition is in flight */
+    bool active() const
+    {
+        return !transition.empty();
+    }
+
+    /** @brief Return true if the given transition is the one in flight
+     *
+     * @param[in] value - The transition, as its D-Bus string
+     */
+    bool matches(const std::string& value) const
+    {
+        return active() && (transition == value);
+    }
+
+    /** @brief Record a transition whose job has been queued
+     *
+     * @param[in] value - The transition, as its D-Bus string
+     * @param[in] job   - The systemd job path
+     */
+    void start(const std::string& value,
+               const sdbusplus::message::object_path& job);
+
+    /** @brief Clear the transition if a removed job is the one in flight
+     *
+     * @param[in] job - The systemd job path from JobRemoved
+     *
+     * @return true if the pending transition was cleared
+     */
+    bool jobRemoved(const sdbusplus::message::object_path& job);
+
+    /** @brief Clear the transition regardless of its job */
+    void clear();
+
+  private:
+    /** @brief The transition in flight, empty if none */
+    std::string transition;
+
+    /** @brief The systemd job of the transition in flight */
+    sdbusplus::message::object_path job{"/"};
+
+    /** @brief The D-Bus interface */
+    PropertyInterface intf;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
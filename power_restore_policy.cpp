@@ -0,0 +1,170 @@
+#include "config.h"
+
+#include "power_restore_policy.hpp"
+
+#include "utils.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <xyz/openbmc_project/Control/Power/RestorePolicy/server.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <variant>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+namespace fs = std::filesystem;
+namespace server = sdbusplus::xyz::openbmc_project::State::server;
+using sdbusplus::xyz::openbmc_project::Control::Power::server::RestorePolicy;
+
+namespace
+{
+
+RestorePolicy::Policy getPolicy(sdbusplus::bus::bus& bus,
+                                const settings::Objects& settings,
+                                const std::string& path)
+{
+    auto service = settings.service(settings.powerRestorePolicy,
+                                    settings::powerRestoreIntf);
+    auto method = bus.new_method_call(service.c_str(), path.c_str(),
+                                      "org.freedesktop.DBus.Properties", "Get");
+    method.append(settings::powerRestoreIntf, "PowerRestorePolicy");
+
+    std::variant<std::string> result;
+    auto reply = bus.call(method);
+    reply.read(result);
+
+    return RestorePolicy::convertPolicyFromString(
+        std::get<std::string>(result));
+}
+
+} // namespace
+
+std::optional<PowerRestoreAction> getPowerRestoreAction(
+    sdbusplus::bus::bus& bus, const settings::Objects& settings,
+    server::Host::Transition lastRequested,
+    std::optional<std::string> bmcRebootCause)
+{
+    // If the BMC was rebooted due to a user initiated pinhole reset, do not
+    // implement any power restore policies
+    if (!bmcRebootCause)
+    {
+        bmcRebootCause =
+            utils::getProperty(bus, "/xyz/openbmc_project/state/bmc0",
+                               BMC_BUSNAME, "LastRebootCause");
+    }
+    if (bmcRebootCause ==
+        "xyz.openbmc_project.State.BMC.RebootCause.PinholeReset")
+    {
+        info(
+            "BMC was reset due to pinhole reset, no power restore policy will be run");
+        return std::nullopt;
+    }
+    else if (bmcRebootCause ==
+             "xyz.openbmc_project.State.BMC.RebootCause.Watchdog")
+    {
+        info(
+            "BMC was reset due to cold reset, no power restore policy will be run");
+        return std::nullopt;
+    }
+
+    /* The logic here is to first check the one-time PowerRestorePolicy setting.
+     * If this property is not the default then look at the persistent
+     * user setting in the non one-time object, otherwise honor the one-time
+     * setting.
+     */
+    auto powerPolicy =
+        getPolicy(bus, settings, settings.powerRestorePolicyOneTime);
+
+    if (RestorePolicy::Policy::None == powerPolicy)
+    {
+        // one_time is set to None so use the customer setting
+        info("One time not set, check user setting of power policy");
+
+        // Only use customer setting if chassis power was on prior to
+        // the BMC reboot
+        auto size = std::snprintf(nullptr, 0, CHASSIS_LOST_POWER_FILE, 0);
+        size++; // null
+        std::unique_ptr<char[]> buf(new char[size]);
+        std::snprintf(buf.get(), size, CHASSIS_LOST_POWER_FILE, 0);
+        if (!fs::exists(buf.get()))
+        {
+            info(
+                "Chassis power was not on prior to BMC reboot so do not run any power policy");
+            return std::nullopt;
+        }
+
+        powerPolicy = getPolicy(bus, settings, settings.powerRestorePolicy);
+    }
+    else
+    {
+        // one_time setting was set so we're going to use it. Reset it
+        // to default for next time.
+        info("One time set, use it and reset to default");
+        utils::setProperty(bus, settings.powerRestorePolicyOneTime.c_str(),
+                           settings::powerRestoreIntf, "PowerRestorePolicy",
+                           convertForMessage(RestorePolicy::Policy::None));
+    }
+
+    info("Host power is off, processing power policy {POWER_POLICY}",
+         "POWER_POLICY", convertForMessage(powerPolicy));
+
+    if (RestorePolicy::Policy::AlwaysOn == powerPolicy)
+    {
+        info("power_policy=ALWAYS_POWER_ON, powering host on");
+        return PowerRestoreAction{
+            server::Host::Transition::On,
+            server::Host::RestartCause::PowerPolicyAlwaysOn};
+    }
+    else if (RestorePolicy::Policy::AlwaysOff == powerPolicy)
+    {
+        info("power_policy=ALWAYS_POWER_OFF, set requested state to off");
+        // Re-request the last requested state to execute it
+        if (lastRequested == server::Host::Transition::On)
+        {
+            return PowerRestoreAction{server::Host::Transition::Off,
+                                      std::nullopt};
+        }
+    }
+    else if (RestorePolicy::Policy::Restore == powerPolicy)
+    {
+        info("power_policy=RESTORE, restoring last state");
+        // Re-request the last requested state to execute it
+        if (lastRequested == server::Host::Transition::On)
+        {
+            return PowerRestoreAction{
+                server::Host::Transition::On,
+                server::Host::RestartCause::PowerPolicyPreviousState};
+        }
+    }
+
+    return std::nullopt;
+}
+
+void logPowerRestoreTiming(const PowerRestoreAction& action)
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    auto sinceBoot = std::chrono::seconds(ts.tv_sec) +
+                     std::chrono::nanoseconds(ts.tv_nsec);
+
+    info("Power restore policy requested {TRANSITION} {BOOT_MS}ms after boot",
+         "TRANSITION", convertForMessage(action.transition), "BOOT_MS",
+         std::chrono::duration_cast<std::chrono::milliseconds>(sinceBoot)
+             .count());
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "settings.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <xyz/openbmc_project/State/Host/server.hpp>
+
+#include <optional>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @brief What the power restore policy asks of the host */
+struct PowerRestoreAction
+{
+    sdbusplus::xyz::openbmc_project::State::server::Host::Transition
+        transition;
+    std::optional<
+        sdbusplus::xyz::openbmc_project::State::server::Host::RestartCause>
+        restartCause;
+};
+
+/** @brief Decide what to do with the host after the BMC came up with
+ *         chassis power off
+ *
+ * Checks the BMC reboot cause, then the one-time power restore policy,
+ * falling back to the user setting if chassis power was on before the BMC
+ * rebooted. A one-time policy is reset to None once read.
+ *
+ * @param[in] bus            - The Dbus bus object
+ * @param[in] settings       - The settings objects
+ * @param[in] lastRequested  - The last requested host transition
+ * @param[in] bmcRebootCause - The BMC's LastRebootCause, read from its
+ *                             object if not given
+ *
+ * @return The transition to request, if any. Throws sdbusplus exceptions
+ *         on D-Bus failures.
+ */
+std::optional<PowerRestoreAction> getPowerRestoreAction(
+    sdbusplus::bus::bus& bus, const settings::Objects& settings,
+    sdbusplus::xyz::openbmc_project::State::server::Host::Transition
+        lastRequested,
+    std::optional<std::string> bmcRebootCause = std::nullopt);
+
+/** @brief Log how long after the kernel started the policy requested
+ *         power on, to compare startup paths
+ *
+ * @param[in] action - The action requested
+ */
+void logPowerRestoreTiming(const PowerRestoreAction& action);
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
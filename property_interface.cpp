@@ -0,0 +1,119 @@
+#include "property_interface.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/exception.hpp>
+
+#include <algorithm>
+#include <exception>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+void PropertyInterface::emitAdded()
+{
+    if (intf)
+    {
+        return;
+    }
+
+    vtable.clear();
+    vtable.push_back(sdbusplus::vtable::start());
+    for (const auto& property : properties)
+    {
+        vtable.push_back(sdbusplus::vtable::property(
+            property.name.c_str(), property.signature.c_str(),
+            PropertyInterface::getProperty,
+            sdbusplus::vtable::property_::emits_change));
+    }
+    for (const auto& method : methods)
+    {
+        vtable.push_back(sdbusplus::vtable::method(
+            method.name.c_str(), method.signature.c_str(),
+            method.result.c_str(), PropertyInterface::callMethod));
+    }
+    vtable.push_back(sdbusplus::vtable::end());
+
+    intf = std::make_unique<sdbusplus::server::interface::interface>(
+        bus, objPath.c_str(), interface.c_str(), vtable.data(), this);
+    intf->emit_added();
+}
+
+void PropertyInterface::propertyChanged(const std::string& name)
+{
+    if (intf)
+    {
+        intf->property_changed(name.c_str());
+    }
+}
+
+int PropertyInterface::getProperty(sd_bus* /*bus*/, const char* /*path*/,
+                                   const char* /*interface*/,
+                                   const char* property, sd_bus_message* reply,
+                                   void* context, sd_bus_error* /*error*/)
+{
+    auto self = static_cast<PropertyInterface*>(context);
+
+    auto it = std::find_if(
+        self->properties.begin(), self->properties.end(),
+        [property](const auto& entry) { return entry.name == property; });
+    if (it == self->properties.end())
+    {
+        error("Unknown property {PROPERTY} on {PATH}", "PROPERTY", property,
+              "PATH", self->objPath);
+        return -EINVAL;
+    }
+
+    auto m = sdbusplus::message::message(reply);
+    it->append(m);
+    return 1;
+}
+
+int PropertyInterface::callMethod(sd_bus_message* msg, void* context,
+                                  sd_bus_error* retError)
+{
+    auto self = static_cast<PropertyInterface*>(context);
+    auto call = sdbusplus::message::message(msg);
+    std::string member = call.get_member();
+
+    auto it = std::find_if(
+        self->methods.begin(), self->methods.end(),
+        [&member](const auto& entry) { return entry.name == member; });
+    if (it == self->methods.end())
+    {
+        error("Unknown method {METHOD} on {PATH}", "METHOD", member, "PATH",
+              self->objPath);
+        return -EINVAL;
+    }
+
+    try
+    {
+        auto reply = call.new_method_return();
+        it->handler(call, reply);
+        reply.method_return();
+    }
+    catch (const sdbusplus::exception::exception& e)
+    {
+        return sd_bus_error_set(retError, e.name(), e.description());
+    }
+    catch (const std::exception& e)
+    {
+        // Anything else must not unwind into sd-bus, fail just this call
+        error("Method {METHOD} on {PATH} failed: {ERROR}", "METHOD", member,
+              "PATH", self->objPath, "ERROR", e);
+        return sd_bus_error_set(
+            retError, "xyz.openbmc_project.Common.Error.InternalFailure",
+            e.what());
+    }
+
+    return 1;
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/message.hpp>
+#include <sdbusplus/message/types.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/utility/tuple_to_array.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class PropertyInterface
+ *  @brief D-Bus interface backed by getter and handler functions
+ *  @details Used to publish data which has no definition in
+ *  phosphor-dbus-interfaces. Read-only properties are added with
+ *  addProperty(), methods with addMethod(), and the interface is put on
+ *  D-Bus with emitAdded(). The getters are called each time a property is
+ *  read so the published values are never stale.
+ */
+class PropertyInterface
+{
+  public:
+    PropertyInterface() = delete;
+    PropertyInterface(const PropertyInterface&) = delete;
+    PropertyInterface& operator=(const PropertyInterface&) = delete;
+    PropertyInterface(PropertyInterface&&) = delete;
+    PropertyInterface& operator=(PropertyInterface&&) = delete;
+    ~PropertyInterface() = default;
+
+    /** @brief Constructs the interface, nothing is put on D-Bus yet
+     *
+     * @param[in] bus       - The Dbus bus object
+     * @param[in] objPath   - The Dbus object path
+     * @param[in] interface - The Dbus interface name
+     */
+    PropertyInterface(sdbusplus::bus::bus& bus, const std::string& objPath,
+                      const std::string& interface) :
+        bus(bus),
+        objPath(objPath), interface(interface)
+    {}
+
+    /** @brief Add a property to the interface
+     *
+     * @note Must be called before emitAdded()
+     *
+     * @tparam T            - The type of the property
+     * @param[in] name      - The property name
+     * @param[in] getter    - Function returning the current value
+     */
+    template <typename T>
+    void addProperty(const std::string& name, std::function<T()> getter)
+    {
+        auto signature = sdbusplus::utility::tuple_to_array(
+            sdbusplus::message::types::type_id<T>());
+
+        properties.push_back(
+            {name, std::string(signature.data()),
+             [getter = std::move(getter)](sdbusplus::message::message& m) {
+                 m.append(getter());
+             }});
+    }
+
+    /** @brief Add a method to the interface
+     *
+     * The handler reads the arguments from the call and appends any return
+     * values to the reply. An sdbusplus exception thrown by the handler is
+     * returned to the caller as a D-Bus error.
+     *
+     * @note Must be called before emitAdded()
+     *
+     * @param[in] name      - The method name
+     * @param[in] signature - The signature of the arguments
+     * @param[in] result    - The signature of the return values
+     * @param[in] handler   - Function handling the call
+     */
+    void addMethod(const std::string& name, const std::string& signature,
+                   const std::string& result,
+                   std::function<void(sdbusplus::message::message& call,
+                                      sdbusplus::message::message& reply)>
+                       handler)
+    {
+        methods.push_back({name, signature, result, std::move(handler)});
+    }
+
+    /** @brief Register the interface and emit InterfacesAdded */
+    void emitAdded();
+
+    /** @brief Emit PropertiesChanged for a property
+     *
+     * @param[in] name - The property name
+     */
+    void propertyChanged(const std::string& name);
+
+  private:
+    /** @brief sd-bus callback used for all property reads */
+    static int getProperty(sd_bus* bus, const char* path,
+                           const char* interface, const char* property,
+                           sd_bus_message* reply, void* context,
+                           sd_bus_error* error);
+
+    /** @brief sd-bus callback used for all method calls */
+    static int callMethod(sd_bus_message* msg, void* context,
+                          sd_bus_error* retError);
+
+    struct Property
+    {
+        std::string name;
+        std::string signature;
+        std::function<void(sdbusplus::message::message&)> append;
+    };
+
+    struct Method
+    {
+        std::string name;
+        std::string signature;
+        std::string result;
+        std::function<void(sdbusplus::message::message&,
+                           sdbusplus::message::message&)>
+            handler;
+    };
+
+    /** @brief The Dbus bus object */
+    sdbusplus::bus::bus& bus;
+
+    /** @brief The Dbus object path */
+    const std::string objPath;
+
+    /** @brief The Dbus interface name */
+    const std::string interface;
+
+    /** @brief The properties, a list so the vtable strings stay valid */
+    std::list<Property> properties;
+
+    /** @brief The methods, a list so the vtable strings stay valid */
+    std::list<Method> methods;
+
+    /** @brief The vtable handed to sd-bus, built by emitAdded() */
+    std::vector<sdbusplus::vtable::vtable_t> vtable;
+
+    /** @brief The registered interface */
+    std::unique_ptr<sdbusplus::server::interface::interface> intf;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
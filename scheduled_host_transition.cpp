@@ -1,5 +1,7 @@
 #include "scheduled_host_transition.hpp"
 
+#include "io_worker.hpp"
+#include "state_probes.hpp"
 #include "utils.hpp"
 #include "xyz/openbmc_project/State/Host/server.hpp"
 
@@ -7,23 +9,22 @@
 #include <unistd.h>
 
 #include <cereal/archives/json.hpp>
+#include <cereal/types/utility.hpp>
+#include <cereal/types/vector.hpp>
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/elog.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <xyz/openbmc_project/ScheduledTime/error.hpp>
 
+#include <algorithm>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
-
-// Need to do this since its not exported outside of the kernel.
-// Refer : https://gist.github.com/lethean/446cea944b7441228298
-#ifndef TFD_TIMER_CANCEL_ON_SET
-#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
-#endif
-
-// Needed to make sure timerfd does not misfire even though we set CANCEL_ON_SET
-#define TIME_T_MAX (time_t)((1UL << ((sizeof(time_t) << 3) - 1)) - 1)
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <tuple>
+#include <variant>
 
 namespace phosphor
 {
@@ -53,10 +54,9 @@ uint64_t ScheduledHostTransition::scheduledTime(uint64_t value)
     if (value == 0)
     {
         // 0 means the function Scheduled Host Transition is disabled
-        // Stop the timer if it's running
-        if (timer.isEnabled())
+        if (!schedule.empty())
         {
-            timer.setEnabled(false);
+            schedule.clear();
             debug(
                 "scheduledTime: The function Scheduled Host Transition is disabled.");
         }
@@ -71,34 +71,429 @@ uint64_t ScheduledHostTransition::scheduledTime(uint64_t value)
             elog<InvalidTimeError>(
                 InvalidTime::REASON("Scheduled time is in the past"));
         }
-        else
+
+        // Writing the property reschedules the earliest entry, which keeps
+        // the behavior single schedule users have always seen
+        ScheduleEntry entry{HostTransition::scheduledTransition()};
+        if (!schedule.empty())
         {
-            // Start a timer to do host transition at scheduled time
-            timer.restart(deltaTime);
+            entry.period = schedule.begin()->second.period;
+            schedule.erase(schedule.begin());
         }
+        schedule.emplace(value, entry);
     }
 
-    // Set scheduledTime
-    HostTransition::scheduledTime(value);
-    // Store scheduled values
-    serializeScheduledValues();
+    // Update the properties, timer, and stored values
+    scheduleChanged();
+
+    return value;
+}
+
+Transition ScheduledHostTransition::scheduledTransition(Transition value)
+{
+    if (schedule.empty())
+    {
+        HostTransition::scheduledTransition(value);
+        serializeScheduledValues();
+        return value;
+    }
+
+    // Switching to or from a power on moves the fire time in ready-by mode
+    schedule.begin()->second.transition = value;
+    scheduleChanged();
 
     return value;
 }
 
+void ScheduledHostTransition::addTransition(uint64_t time, Transition trans,
+                                            uint64_t period)
+{
+    if (seconds(time) < getTime())
+    {
+        error("Scheduled time {TIME} is earlier than current time. Fail to "
+              "queue host transition.",
+              "TIME", time);
+        elog<InvalidTimeError>(
+            InvalidTime::REASON("Scheduled time is in the past"));
+    }
+
+    schedule.erase(time);
+    schedule.emplace(time, ScheduleEntry{trans, period});
+    info("Queued host transition {TRANSITION} at {TIME}, repeating every "
+         "{PERIOD}s",
+         "TRANSITION", convertForMessage(trans), "TIME", time, "PERIOD",
+         period);
+
+    scheduleChanged();
+}
+
+bool ScheduledHostTransition::removeTransition(uint64_t time)
+{
+    if (schedule.erase(time) == 0)
+    {
+        return false;
+    }
+
+    info("Removed queued host transition at {TIME}", "TIME", time);
+    scheduleChanged();
+    return true;
+}
+
+void ScheduledHostTransition::scheduleChanged()
+{
+    if (schedule.empty())
+    {
+        if (timer.isEnabled())
+        {
+            timer.setEnabled(false);
+        }
+        HostTransition::scheduledTime(0);
+    }
+    else
+    {
+        const auto& [time, entry] = *schedule.begin();
+        HostTransition::scheduledTime(time);
+        HostTransition::scheduledTransition(entry.transition);
+
+        // Only the earliest entry needs a timer, anything already due is
+        // picked up right away by the callback
+        auto fire = seconds(fireTime(schedule.begin()));
+        timer.restart(std::max(fire - getTime(), seconds(0)));
+    }
+
+    serializeScheduledValues();
+    queueIntf.propertyChanged("Entries");
+}
+
+void ScheduledHostTransition::processSchedule()
+{
+    auto now = static_cast<uint64_t>(getTime().count());
+
+    // Entries whose time is at or before now are due. Of those, the most
+    // recent occurrence is the one requested, and recurring entries go back
+    // on the queue at their first occurrence after both now and their time,
+    // as a timer may fire right on time.
+    std::optional<std::pair<uint64_t, Transition>> latest;
+    std::vector<std::pair<uint64_t, ScheduleEntry>> recurring;
+    size_t dueCount = 0;
+
+    auto due = schedule.begin();
+    for (; (due != schedule.end()) && (due->first <= now); ++due)
+    {
+        const auto& [time, entry] = *due;
+        auto occurrence = time;
+        if (entry.period != 0)
+        {
+            occurrence += (now - time) / entry.period * entry.period;
+            recurring.emplace_back(occurrence + entry.period, entry);
+        }
+
+        if (!latest || (occurrence >= latest->first))
+        {
+            latest.emplace(occurrence, entry.transition);
+        }
+        dueCount++;
+    }
+
+    // Otherwise, in ready-by mode, the earliest entry may be a power on
+    // that's requested ahead of its time. It only comes due once the
+    // entries before it have been requested, so an off/on pair powers the
+    // host off before the on is requested.
+    if (!latest && (due != schedule.end()) && (fireTime(due) <= now))
+    {
+        const auto& [time, entry] = *due;
+        if (entry.period != 0)
+        {
+            recurring.emplace_back(time + entry.period, entry);
+        }
+        latest.emplace(time, entry.transition);
+        ++due;
+    }
+
+    if (!latest)
+    {
+        scheduleChanged();
+        return;
+    }
+
+    if (dueCount > 1)
+    {
+        info("Skipping {COUNT} scheduled host transitions superseded by the "
+             "one at {TIME}",
+             "COUNT", dueCount - 1, "TIME", latest->first);
+    }
+
+    // Requested ahead of its time, so check how close to it the host
+    // reaches Running
+    readyByTarget.reset();
+    if (latest->first > now)
+    {
+        info("Requesting host power on {LEAD}s ahead of {TIME}", "LEAD",
+             latest->first - now, "TIME", latest->first);
+        readyByTarget = latest->first;
+    }
+    offPending = (latest->second == Transition::Off);
+
+    schedule.erase(schedule.begin(), due);
+    for (const auto& [time, entry] : recurring)
+    {
+        schedule.emplace(time, entry);
+    }
+    scheduleChanged();
+
+    hostTransition(latest->second);
+}
+
+uint64_t ScheduledHostTransition::fireTime(Schedule::const_iterator it) const
+{
+    auto time = it->first;
+    if (!readyBy || (it->second.transition != Transition::On) ||
+        (bootEstimateMs == 0))
+    {
+        return time;
+    }
+
+    // Round up, better a second early than late
+    auto lead = (bootEstimateMs + 999) / 1000;
+    auto fire = (time > lead) ? time - lead : 0;
+
+    // Don't overtake the entry before, e.g. the off of an off/on pair, nor
+    // an off still being carried out. The timer is rearmed with the lead
+    // once the host is off.
+    if (it != schedule.begin())
+    {
+        fire = std::max(fire, std::prev(it)->first);
+    }
+    else if (offPending)
+    {
+        fire = time;
+    }
+
+    return fire;
+}
+
+void ScheduledHostTransition::hostStateChange(
+    sdbusplus::message::message& msg)
+{
+    std::string interface;
+    std::map<std::string, std::variant<std::string>> msgData;
+    msg.read(interface, msgData);
+
+    auto propertyMap = msgData.find("RequestedHostTransition");
+    if (propertyMap != msgData.end())
+    {
+        auto requested = HostState::convertTransitionFromString(
+            std::get<std::string>(propertyMap->second));
+        if (requested == Transition::On)
+        {
+            bootStart = steady_clock::now();
+        }
+        else
+        {
+            bootStart.reset();
+            readyByTarget.reset();
+        }
+    }
+
+    propertyMap = msgData.find("CurrentHostState");
+    if (propertyMap == msgData.end())
+    {
+        return;
+    }
+
+    auto state = HostState::convertHostStateFromString(
+        std::get<std::string>(propertyMap->second));
+    if (state != HostState::HostState::Running)
+    {
+        // Anything but Off is still on the way up
+        if (state == HostState::HostState::Off)
+        {
+            bootStart.reset();
+            readyByTarget.reset();
+            hostOff();
+        }
+        return;
+    }
+
+    if (bootStart)
+    {
+        addBootSample(
+            duration_cast<milliseconds>(steady_clock::now() - *bootStart)
+                .count());
+        bootStart.reset();
+    }
+
+    if (readyByTarget)
+    {
+        auto now = duration_cast<milliseconds>(
+            system_clock::now().time_since_epoch());
+        lastErrorMs = now.count() - static_cast<int64_t>(*readyByTarget * 1000);
+        info("Host reached Running {ERROR_MS}ms from its ready-by time",
+             "ERROR_MS", lastErrorMs);
+        readyByTarget.reset();
+        readyByIntf.propertyChanged("LastErrorMs");
+    }
+}
+
+void ScheduledHostTransition::hostOff()
+{
+    if (!offPending)
+    {
+        return;
+    }
+
+    // A power on held back for the off can now be requested ahead of time
+    offPending = false;
+    if (!schedule.empty())
+    {
+        scheduleChanged();
+    }
+}
+
+void ScheduledHostTransition::addBootSample(uint64_t durationMs)
+{
+    if (bootSamples == 0)
+    {
+        bootEstimateMs = durationMs;
+    }
+    else
+    {
+        auto delta = static_cast<int64_t>(durationMs) -
+                     static_cast<int64_t>(bootEstimateMs);
+        bootEstimateMs += delta / BOOT_ESTIMATE_WEIGHT;
+    }
+    bootSamples++;
+
+    info("Host boot took {DURATION_MS}ms, estimate now {ESTIMATE_MS}ms",
+         "DURATION_MS", durationMs, "ESTIMATE_MS", bootEstimateMs);
+
+    readyByIntf.propertyChanged("BootEstimateMs");
+    readyByIntf.propertyChanged("Samples");
+
+    // The estimate moves the fire time of a pending power on
+    if (readyBy && !schedule.empty())
+    {
+        processSchedule();
+    }
+    else
+    {
+        serializeScheduledValues();
+    }
+}
+
+void ScheduledHostTransition::initializeReadyByInterface()
+{
+    readyByIntf.addProperty<bool>("Enabled", [this]() { return readyBy; });
+    readyByIntf.addProperty<uint64_t>("BootEstimateMs",
+                                      [this]() { return bootEstimateMs; });
+    readyByIntf.addProperty<uint64_t>("Samples",
+                                      [this]() { return bootSamples; });
+    readyByIntf.addProperty<int64_t>("LastErrorMs",
+                                     [this]() { return lastErrorMs; });
+    readyByIntf.emitAdded();
+}
+
+void ScheduledHostTransition::rebaseRecurring(uint64_t wentBack)
+{
+    auto now = static_cast<uint64_t>(getTime().count());
+
+    // Each whole period the clock went back is an occurrence to come round
+    // again, but never bring an entry to or before now
+    std::vector<std::pair<uint64_t, ScheduleEntry>> moved;
+    for (auto it = schedule.begin(); it != schedule.end();)
+    {
+        const auto& [time, entry] = *it;
+        if ((entry.period != 0) && (time > now) &&
+            (wentBack >= entry.period) && (time - now > entry.period))
+        {
+            auto periods = std::min(wentBack / entry.period,
+                                    (time - now - 1) / entry.period);
+            moved.emplace_back(time - periods * entry.period, entry);
+            it = schedule.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    for (const auto& [time, entry] : moved)
+    {
+        schedule.emplace(time, entry);
+    }
+}
+
+std::vector<std::tuple<uint64_t, std::string, uint64_t>>
+    ScheduledHostTransition::getEntries() const
+{
+    std::vector<std::tuple<uint64_t, std::string, uint64_t>> entries;
+    entries.reserve(schedule.size());
+    for (const auto& [time, entry] : schedule)
+    {
+        entries.emplace_back(time, convertForMessage(entry.transition),
+                             entry.period);
+    }
+    return entries;
+}
+
+void ScheduledHostTransition::initializeQueueInterface()
+{
+    queueIntf.addProperty<
+        std::vector<std::tuple<uint64_t, std::string, uint64_t>>>(
+        "Entries", [this]() { return getEntries(); });
+
+    queueIntf.addMethod(
+        "AddTransition", "ts", "",
+        [this](sdbusplus::message::message& call,
+               sdbusplus::message::message& /*reply*/) {
+            uint64_t time;
+            std::string trans;
+            call.read(time, trans);
+            addTransition(time, HostState::convertTransitionFromString(trans));
+        });
+
+    queueIntf.addMethod(
+        "AddRecurringTransition", "tst", "",
+        [this](sdbusplus::message::message& call,
+               sdbusplus::message::message& /*reply*/) {
+            uint64_t time;
+            std::string trans;
+            uint64_t period;
+            call.read(time, trans, period);
+            addTransition(time, HostState::convertTransitionFromString(trans),
+                          period);
+        });
+
+    queueIntf.addMethod("RemoveTransition", "t", "b",
+                        [this](sdbusplus::message::message& call,
+                               sdbusplus::message::message& reply) {
+                            uint64_t time;
+                            call.read(time);
+                            reply.append(removeTransition(time));
+                        });
+
+    queueIntf.emitAdded();
+}
+
 seconds ScheduledHostTransition::getTime()
 {
     auto now = system_clock::now();
     return duration_cast<seconds>(now.time_since_epoch());
 }
 
-void ScheduledHostTransition::hostTransition()
+seconds ScheduledHostTransition::getClockOffset()
+{
+    return duration_cast<seconds>(system_clock::now().time_since_epoch() -
+                                  steady_clock::now().time_since_epoch());
+}
+
+void ScheduledHostTransition::hostTransition(Transition trans)
 {
     auto hostPath = std::string{HOST_OBJPATH} + '0';
 
     // Set RestartCause to indicate this transition is occurring due to a
     // scheduled host transition as long as it's not an off request
-    if (HostTransition::scheduledTransition() != HostState::Transition::Off)
+    if (trans != HostState::Transition::Off)
     {
         info("Set RestartCause to scheduled power on reason");
         auto resCause =
@@ -106,7 +501,8 @@ void ScheduledHostTransition::hostTransition()
         utils::setProperty(bus, hostPath, HOST_BUSNAME, PROPERTY_RESTART_CAUSE,
                            resCause);
     }
-    auto reqTrans = convertForMessage(HostTransition::scheduledTransition());
+    auto reqTrans = convertForMessage(trans);
+    STATE_PROBE(transition_request, probes::Scheduled, 0, reqTrans.c_str());
 
     utils::setProperty(bus, hostPath, HOST_BUSNAME, PROPERTY_TRANSITION,
                        reqTrans);
@@ -117,12 +513,9 @@ void ScheduledHostTransition::hostTransition()
 
 void ScheduledHostTransition::callback()
 {
-    // Stop timer, since we need to do host transition once only
+    // Stop timer, it is rearmed for the next entry if there is one
     timer.setEnabled(false);
-    hostTransition();
-    // Set scheduledTime to 0 to disable host transition and update scheduled
-    // values
-    scheduledTime(0);
+    processSchedule();
 }
 
 void ScheduledHostTransition::initialize()
@@ -179,7 +572,7 @@ ScheduledHostTransition::~ScheduledHostTransition()
     close(timeFd);
 }
 
-void ScheduledHostTransition::handleTimeUpdates()
+void ScheduledHostTransition::handleTimeUpdates(uint64_t wentBack)
 {
     // Stop the timer if it's running.
     // Don't return directly when timer is stopped, because the timer is always
@@ -189,35 +582,27 @@ void ScheduledHostTransition::handleTimeUpdates()
         timer.setEnabled(false);
     }
 
-    // Get scheduled time
-    auto schedTime = HostTransition::scheduledTime();
-
-    if (schedTime == 0)
+    if (schedule.empty())
     {
         debug(
             "handleTimeUpdates: The function Scheduled Host Transition is disabled.");
         return;
     }
 
-    auto deltaTime = seconds(schedTime) - getTime();
-    if (deltaTime <= seconds(0))
-    {
-        hostTransition();
-        // Set scheduledTime to 0 to disable host transition and update
-        // scheduled values
-        scheduledTime(0);
-    }
-    else
+    // Run whatever became due with the new time and rearm the timer
+    // relative to it for the rest
+    if (wentBack != 0)
     {
-        // Start a timer to do host transition at scheduled time
-        timer.restart(deltaTime);
+        rebaseRecurring(wentBack);
     }
+    processSchedule();
 }
 
 int ScheduledHostTransition::onTimeChange(sd_event_source* /* es */, int fd,
                                           uint32_t /* revents */,
                                           void* userdata)
 {
+    eventloop::Scope scope{"scheduled.TimeChange"};
     auto schedHostTran = static_cast<ScheduledHostTransition*>(userdata);
 
     std::array<char, 64> time{};
@@ -227,24 +612,52 @@ int ScheduledHostTransition::onTimeChange(sd_event_source* /* es */, int fd,
     while (read(fd, time.data(), time.max_size()) > 0)
         ;
 
-    debug("BMC system time is changed");
-    schedHostTran->handleTimeUpdates();
+    // Only the realtime clock jumps, so the change in its offset from the
+    // monotonic one is how far it went
+    auto offset = getClockOffset();
+    auto wentBack = std::max(schedHostTran->clockOffset - offset, seconds(0));
+    schedHostTran->clockOffset = offset;
+
+    debug("BMC system time is changed, back {BACK}s", "BACK",
+          wentBack.count());
+    schedHostTran->handleTimeUpdates(static_cast<uint64_t>(wentBack.count()));
 
     return 0;
 }
 
 void ScheduledHostTransition::serializeScheduledValues()
 {
-    fs::path path{SCHEDULED_HOST_TRANSITION_PERSIST_PATH};
-    std::ofstream os(path.c_str(), std::ios::binary);
-    cereal::JSONOutputArchive oarchive(os);
+    // The queue is stored in order after the original values, followed by
+    // the period of just the recurring entries, by their place in the
+    // queue as times may repeat
+    std::vector<std::pair<uint64_t, Transition>> entries;
+    std::vector<std::pair<uint64_t, uint64_t>> periods;
+    entries.reserve(schedule.size());
+    for (const auto& [time, entry] : schedule)
+    {
+        if (entry.period != 0)
+        {
+            periods.emplace_back(entries.size(), entry.period);
+        }
+        entries.emplace_back(time, entry.transition);
+    }
 
-    oarchive(HostTransition::scheduledTime(),
-             HostTransition::scheduledTransition());
+    std::ostringstream os;
+    {
+        cereal::JSONOutputArchive oarchive(os);
+        oarchive(HostTransition::scheduledTime(),
+                 HostTransition::scheduledTransition(), entries, periods,
+                 std::make_pair(bootEstimateMs, bootSamples));
+    }
+    io::queueWrite(SCHEDULED_HOST_TRANSITION_PERSIST_PATH, os.str(),
+                   probes::Scheduled, 0);
 }
 
-bool ScheduledHostTransition::deserializeScheduledValues(uint64_t& time,
-                                                         Transition& trans)
+bool ScheduledHostTransition::deserializeScheduledValues(
+    uint64_t& time, Transition& trans,
+    std::vector<std::pair<uint64_t, Transition>>& entries,
+    std::vector<std::pair<uint64_t, uint64_t>>& periods,
+    std::pair<uint64_t, uint64_t>& estimate)
 {
     fs::path path{SCHEDULED_HOST_TRANSITION_PERSIST_PATH};
 
@@ -255,6 +668,31 @@ bool ScheduledHostTransition::deserializeScheduledValues(uint64_t& time,
             std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
             cereal::JSONInputArchive iarchive(is);
             iarchive(time, trans);
+
+            try
+            {
+                iarchive(entries, periods);
+            }
+            catch (const cereal::Exception&)
+            {
+                // Written before the queue existed, it holds a single entry
+                entries.clear();
+                periods.clear();
+                if (time != 0)
+                {
+                    entries.emplace_back(time, trans);
+                }
+            }
+
+            try
+            {
+                iarchive(estimate);
+            }
+            catch (const cereal::Exception&)
+            {
+                // Nothing learned yet
+                estimate = {0, 0};
+            }
             return true;
         }
     }
@@ -271,7 +709,13 @@ void ScheduledHostTransition::restoreScheduledValues()
 {
     uint64_t time;
     Transition trans;
-    if (!deserializeScheduledValues(time, trans))
+    std::vector<std::pair<uint64_t, Transition>> entries;
+    std::vector<std::pair<uint64_t, uint64_t>> periods;
+    std::pair<uint64_t, uint64_t> estimate;
+
+    // Anything this thread saved has to be on file before it's read back
+    io::worker().drain();
+    if (!deserializeScheduledValues(time, trans, entries, periods, estimate))
     {
         // set to default value
         HostTransition::scheduledTime(0);
@@ -281,6 +725,24 @@ void ScheduledHostTransition::restoreScheduledValues()
     {
         HostTransition::scheduledTime(time);
         HostTransition::scheduledTransition(trans);
+        std::tie(bootEstimateMs, bootSamples) = estimate;
+        std::vector<ScheduleEntry> restored;
+        restored.reserve(entries.size());
+        for (const auto& [entryTime, entryTrans] : entries)
+        {
+            restored.push_back(ScheduleEntry{entryTrans});
+        }
+        for (const auto& [index, period] : periods)
+        {
+            if (index < restored.size())
+            {
+                restored[index].period = period;
+            }
+        }
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            schedule.emplace(entries[i].first, restored[i]);
+        }
         // Rebooting BMC is something like the BMC time is changed,
         // so go on with the same process as BMC time changed.
         handleTimeUpdates();
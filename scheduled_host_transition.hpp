@@ -2,11 +2,23 @@
 
 #include "config.h"
 
+#include "event_loop_stats.hpp"
+#include "property_interface.hpp"
+
 #include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
 #include <sdeventplus/event.hpp>
 #include <sdeventplus/utility/timer.hpp>
 #include <xyz/openbmc_project/State/ScheduledHostTransition/server.hpp>
 
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 class TestScheduledHostTransition;
 
 namespace phosphor
@@ -25,6 +37,16 @@ using ScheduledHostTransitionInherit = sdbusplus::server::object::object<
  *  @brief Scheduled host transition implementation.
  *  @details A concrete implementation for
  *  xyz.openbmc_project.State.ScheduledHostTransition
+ *
+ *  Any number of transitions can be queued, ordered by scheduled time, and
+ *  a single timer is armed for the earliest one. The ScheduledTime and
+ *  ScheduledTransition properties always reflect the earliest entry, the
+ *  rest of the queue is managed through
+ *  xyz.openbmc_project.State.ScheduledHostTransition.Queue.
+ *
+ *  In ready-by mode a power on is requested ahead of its scheduled time by
+ *  the expected boot duration, so the host is Running at that time. The
+ *  duration is learned from the host's own state changes.
  */
 class ScheduledHostTransition : public ScheduledHostTransitionInherit
 {
@@ -33,12 +55,28 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
                             const sdeventplus::Event& event) :
         ScheduledHostTransitionInherit(bus, objPath, true),
         bus(bus), event(event),
-        timer(event, std::bind(&ScheduledHostTransition::callback, this))
+        timer(event,
+              eventloop::timed(
+                  "scheduled.Timer",
+                  std::bind(&ScheduledHostTransition::callback, this))),
+        hostStateChangeSignal(
+            bus,
+            sdbusplus::bus::match::rules::propertiesChanged(
+                std::string{HOST_OBJPATH} + '0',
+                "xyz.openbmc_project.State.Host"),
+            eventloop::timed("scheduled.HostState", [this](auto& msg) {
+                this->hostStateChange(msg);
+            })),
+        queueIntf(bus, objPath, QUEUE_INTERFACE),
+        readyByIntf(bus, objPath, READY_BY_INTERFACE)
     {
         initialize();
 
         restoreScheduledValues();
 
+        initializeQueueInterface();
+        initializeReadyByInterface();
+
         // We deferred this until we could get our property correct
         this->emit_object_added();
     }
@@ -48,6 +86,10 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
     /**
      * @brief Handle with scheduled time
      *
+     * A non-zero value replaces the earliest queued entry, or adds one if
+     * the queue is empty, using the current ScheduledTransition. 0 clears
+     * the whole queue.
+     *
      * @param[in] value - The seconds since epoch
      * @return The time for the transition. It is the same as the input value if
      * it is set successfully. Otherwise, it won't return value, but throw an
@@ -55,9 +97,76 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
      **/
     uint64_t scheduledTime(uint64_t value) override;
 
+    using sdbusplus::xyz::openbmc_project::State::server::
+        ScheduledHostTransition::scheduledTransition;
+
+    /**
+     * @brief Handle with scheduled transition
+     *
+     * Changes the transition of the earliest queued entry, if there is one.
+     *
+     * @param[in] value - The requested transition
+     * @return The requested transition
+     **/
+    Transition scheduledTransition(Transition value) override;
+
+    /** @brief Queue a transition, replacing any entries at the same time
+     *
+     * A recurring entry is requested again every period seconds after
+     * time, e.g. 86400 for daily and 604800 for weekly.
+     *
+     * @param[in] time   - The seconds since epoch
+     * @param[in] trans  - The requested transition
+     * @param[in] period - Seconds between occurrences, 0 for a single one
+     */
+    void addTransition(uint64_t time, Transition trans, uint64_t period = 0);
+
+    /** @brief Remove the queued transitions at a time
+     *
+     * @param[in] time - The seconds since epoch of the entries
+     *
+     * @return true if an entry was removed
+     */
+    bool removeTransition(uint64_t time);
+
   private:
     friend class TestScheduledHostTransition;
 
+    /** @brief The queue D-Bus interface name */
+    static constexpr auto QUEUE_INTERFACE =
+        "xyz.openbmc_project.State.ScheduledHostTransition.Queue";
+
+    /** @brief A queued transition */
+    struct ScheduleEntry
+    {
+        Transition transition;
+        /** @brief Seconds between occurrences, 0 if it doesn't recur */
+        uint64_t period = 0;
+    };
+
+    /** @brief The ready-by D-Bus interface name */
+    static constexpr auto READY_BY_INTERFACE =
+        "xyz.openbmc_project.State.ScheduledHostTransition.ReadyBy";
+
+    /** @brief Weight of a new sample in the boot duration estimate, as
+     *  1/BOOT_ESTIMATE_WEIGHT
+     */
+    static constexpr int64_t BOOT_ESTIMATE_WEIGHT = 4;
+
+    /** @brief Queued transitions keyed by the next time they are due
+     *
+     *  Ordered so the earliest entry is always begin(), and insert and
+     *  erase are O(log n). Recurring entries can come round to the same
+     *  time as another, so times may repeat.
+     */
+    using Schedule = std::multimap<uint64_t, ScheduleEntry>;
+    Schedule schedule;
+
+    /** @brief The realtime clock less the monotonic one when the clock was
+     *  last checked, it only moves when the clock is changed
+     */
+    std::chrono::seconds clockOffset = getClockOffset();
+
     /** @brief sdbusplus bus client connection */
     sdbusplus::bus::bus& bus;
 
@@ -77,15 +186,85 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
     std::chrono::seconds getTime();
 
     /** @brief Implement host transition
+     *
+     *  @param[in] trans - The transition to request
      *
      *  @return - Does not return anything. Error will result in exception
      *            being thrown
      */
-    void hostTransition();
+    void hostTransition(Transition trans);
 
     /** @brief Used by the timer to do host transition */
     void callback();
 
+    /** @brief Return when an entry is to be requested
+     *
+     *  That is its scheduled time, except for a power on in ready-by mode
+     *  which is moved ahead by the boot estimate. It is never moved ahead
+     *  of the entry before it, nor at all while a requested off hasn't
+     *  completed.
+     *
+     *  @param[in] it - The queue entry
+     *
+     *  @return The seconds since epoch to request the entry at
+     */
+    uint64_t
+        fireTime(Schedule::const_iterator it) const;
+
+    /** @brief Learn the boot duration from host property changes
+     *
+     *  @param[in] msg - The PropertiesChanged signal
+     */
+    void hostStateChange(sdbusplus::message::message& msg);
+
+    /** @brief Rearm the timer for a power on held back by an off, now the
+     *  host is off
+     */
+    void hostOff();
+
+    /** @brief Fold a boot duration into the estimate
+     *
+     *  @param[in] durationMs - Time from the On request until Running
+     */
+    void addBootSample(uint64_t durationMs);
+
+    /** @brief Add the ready-by properties and put them on D-Bus */
+    void initializeReadyByInterface();
+
+    /** @brief Fire due entries, then arm the timer for the earliest one
+     *
+     *  If more than one entry is due, e.g. after the clock jumped forward,
+     *  only the latest of them is requested since it is the state the host
+     *  is meant to be in now. A power on requested ahead of its time is
+     *  never among them, it's only requested on its own once the entries
+     *  before it have been. Recurring entries are requeued at their next
+     *  occurrence, computed from the one that just came due.
+     */
+    void processSchedule();
+
+    /** @brief Bring recurring entries back by the whole periods the clock
+     *  went back, so they recur at the times they would have
+     *
+     *  Only ever moved back as far as the clock was, so an entry queued
+     *  more than a period out is left alone.
+     *
+     *  @param[in] wentBack - Seconds the clock was set back
+     */
+    void rebaseRecurring(uint64_t wentBack);
+
+    /** @brief Return the realtime clock less the monotonic one */
+    static std::chrono::seconds getClockOffset();
+
+    /** @brief Update the properties and the persisted file from the queue */
+    void scheduleChanged();
+
+    /** @brief Return the queue as (time, transition, period) for D-Bus */
+    std::vector<std::tuple<uint64_t, std::string, uint64_t>>
+        getEntries() const;
+
+    /** @brief Add the queue methods and properties and put them on D-Bus */
+    void initializeQueueInterface();
+
     /** @brief Initialize timerFd related resource */
     void initialize();
 
@@ -114,24 +293,76 @@ class ScheduledHostTransition : public ScheduledHostTransitionInherit
     /** @brief The event source on system time change */
     SdEventSource timeChangeEventSource{nullptr, sdEventSourceDeleter};
 
-    /** @brief Handle with the process when bmc time is changed*/
-    void handleTimeUpdates();
+    /** @brief Handle with the process when bmc time is changed
+     *
+     *  @param[in] wentBack - Seconds the clock was set back, if it was
+     */
+    void handleTimeUpdates(uint64_t wentBack = 0);
 
-    /** @brief Serialize the scheduled values */
+    /** @brief Serialize the scheduled values, persisted on the I/O worker */
     void serializeScheduledValues();
 
     /** @brief Deserialize the scheduled values
      *
      *  @param[out] time - Deserialized scheduled time
      *  @param[out] trans - Deserialized requested transition
+     *  @param[out] entries - Deserialized queue, in order
+     *  @param[out] periods - Deserialized periods of the recurring entries
+     *  @param[out] estimate - Deserialized boot estimate and sample count
      *
      *  @return bool - true if successful, false otherwise
      */
-    bool deserializeScheduledValues(uint64_t& time, Transition& trans);
+    bool deserializeScheduledValues(
+        uint64_t& time, Transition& trans,
+        std::vector<std::pair<uint64_t, Transition>>& entries,
+        std::vector<std::pair<uint64_t, uint64_t>>& periods,
+        std::pair<uint64_t, uint64_t>& estimate);
 
     /** @brief Restore scheduled time and requested transition from persisted
      * file */
     void restoreScheduledValues();
+
+    /** @brief Whether power ons are requested ahead of time */
+#ifdef ENABLE_SCHEDULED_READY_BY
+    bool readyBy = true;
+#else
+    bool readyBy = false;
+#endif
+
+    /** @brief Estimated time from an On request until Running, EWMA */
+    uint64_t bootEstimateMs = 0;
+
+    /** @brief Number of boots the estimate was learned from */
+    uint64_t bootSamples = 0;
+
+    /** @brief When the host was last asked to power on, if it hasn't
+     *  reached Running yet
+     */
+    std::optional<std::chrono::steady_clock::time_point> bootStart;
+
+    /** @brief Scheduled time, seconds since epoch, of the power on last
+     *  requested ahead of time, if the host hasn't reached Running yet
+     */
+    std::optional<uint64_t> readyByTarget;
+
+    /** @brief Whether an Off was requested and the host hasn't reached Off
+     *  yet, a ready-by power on waits for it
+     */
+    bool offPending = false;
+
+    /** @brief How late the host reached Running after the last ready-by
+     *  power on, negative if early
+     */
+    int64_t lastErrorMs = 0;
+
+    /** @brief Used to subscribe to host property changes */
+    sdbusplus::bus::match_t hostStateChangeSignal;
+
+    /** @brief The queue D-Bus interface */
+    PropertyInterface queueIntf;
+
+    /** @brief The ready-by D-Bus interface */
+    PropertyInterface readyByIntf;
 };
 } // namespace manager
 } // namespace state
@@ -1,6 +1,8 @@
 #include "config.h"
 
+#include "event_loop_monitor.hpp"
 #include "scheduled_host_transition.hpp"
+#include "startup_timing.hpp"
 
 #include <sdbusplus/bus.hpp>
 
@@ -11,12 +13,16 @@
 int main()
 {
     namespace fs = std::filesystem;
+    namespace startup = phosphor::state::manager::startup;
+
+    startup::milestone("main");
 
     // Get a default event loop
     auto event = sdeventplus::Event::get_default();
 
     // Get a handle to system dbus
     auto bus = sdbusplus::bus::new_default();
+    startup::milestone("bus");
 
     // For now, we only have one instance of the host
     auto objPathInst = std::string{HOST_OBJPATH} + '0';
@@ -33,8 +39,12 @@ int main()
 
     phosphor::state::manager::ScheduledHostTransition manager(
         bus, objPathInst.c_str(), event);
+    phosphor::state::manager::eventloop::Monitor loopMonitor(bus, event,
+                                                             objPathInst);
+    startup::milestone("constructed");
 
     bus.request_name(SCHEDULED_HOST_TRANSITION_BUSNAME);
+    startup::milestone(startup::READY);
 
     // Attach the bus to sd_event to service user requests
     bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
@@ -1,5 +1,6 @@
 #include "settings.hpp"
 
+#include "state_probes.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 
 #include <phosphor-logging/elog-errors.hpp>
@@ -12,6 +13,7 @@ namespace settings
 PHOSPHOR_LOG2_USING;
 
 using namespace phosphor::logging;
+namespace probes = phosphor::state::manager::probes;
 using namespace sdbusplus::xyz::openbmc_project::Common::Error;
 
 constexpr auto mapperService = "xyz.openbmc_project.ObjectMapper";
@@ -35,6 +37,7 @@ Objects::Objects(sdbusplus::bus::bus& bus) : bus(bus)
 
     try
     {
+        probes::MapperCall probe{"GetSubTree", root};
         auto response = bus.call(mapperCall);
 
         response.read(result);
@@ -109,6 +112,7 @@ Service Objects::service(const Path& path, const Interface& interface) const
 
     try
     {
+        probes::MapperCall probe{"GetObject", path.c_str()};
         auto response = bus.call(mapperCall);
         response.read(result);
     }
@@ -0,0 +1,71 @@
+#include "startup_timing.hpp"
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace startup
+{
+
+PHOSPHOR_LOG2_USING;
+
+/** @brief Return CLOCK_MONOTONIC in nanoseconds */
+static uint64_t monotonicNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000000) + ts.tv_nsec;
+}
+
+void milestone(const char* name)
+{
+    static const uint64_t start = monotonicNs();
+    auto now = monotonicNs();
+
+    info("Startup reached {MILESTONE} {ELAPSED_US}us after main", "MILESTONE",
+         name, "ELAPSED_US", (now - start) / 1000);
+
+    auto path = std::getenv(TRACE_ENV);
+    if (path == nullptr)
+    {
+        return;
+    }
+
+    char line[128];
+    auto size = std::snprintf(line, sizeof(line), "%s %llu\n", name,
+                              static_cast<unsigned long long>(now));
+    if ((size <= 0) || (static_cast<std::size_t>(size) >= sizeof(line)))
+    {
+        return;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if ((fd < 0) || (write(fd, line, size) != size))
+    {
+        error("Failed to trace startup to {PATH}: {ERRNO}", "PATH", path,
+              "ERRNO", errno);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+} // namespace startup
+} // namespace manager
+} // namespace state
+} // namespace phosphor
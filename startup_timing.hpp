@@ -0,0 +1,34 @@
+#pragma once
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace startup
+{
+
+/** @brief Names a file to also trace the milestones to, if set */
+constexpr auto TRACE_ENV = "PHOSPHOR_STATE_STARTUP_TRACE";
+
+/** @brief The milestone each daemon's startup ends with, once its objects
+ *  are on D-Bus and it owns its bus names
+ */
+constexpr auto READY = "named";
+
+/** @brief Record that startup has reached a milestone
+ *
+ *  Logs the time since the first milestone, which each daemon records as
+ *  it enters main(). If TRACE_ENV is set, a "<milestone> <CLOCK_MONOTONIC
+ *  ns>" line is also appended to the file it names, for the startup
+ *  benchmark.
+ *
+ * @param[in] name - The milestone, without spaces
+ */
+void milestone(const char* name);
+
+} // namespace startup
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,392 @@
+#include "state_journal.hpp"
+
+#include "event_loop_stats.hpp"
+#include "io_worker.hpp"
+
+#include <sys/file.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace journal
+{
+
+PHOSPHOR_LOG2_USING;
+
+namespace fs = std::filesystem;
+
+/** @brief Return the current time in microseconds since the epoch */
+static uint64_t nowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch())
+        .count();
+}
+
+/** @brief Write all of buf, false on error */
+static bool writeAll(int fd, const void* buf, std::size_t size)
+{
+    auto data = static_cast<const char*>(buf);
+    while (size > 0)
+    {
+        auto written = write(fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+Writer::Writer(const sdeventplus::Event& event, const char* path,
+               const char* persistPath, uint32_t capacity) :
+    path(path),
+    persistPath(persistPath), capacity(capacity),
+    flushTimer(event, eventloop::timed("journal.Flush",
+                                       std::bind(&Writer::flush, this)))
+{
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    fs::create_directories(fs::path(persistPath).parent_path(), ec);
+
+    ring = mapRing();
+    if (ring != nullptr)
+    {
+        flushedTo = ring->persisted.load(std::memory_order_relaxed);
+        return;
+    }
+
+    if (access(path, F_OK) == 0)
+    {
+        info("Replacing {PATH}, it isn't a version {VERSION} journal of "
+             "{CAPACITY} records",
+             "PATH", path, "VERSION", VERSION, "CAPACITY", capacity);
+        createRing(true);
+    }
+    else
+    {
+        createRing(false);
+    }
+
+    ring = mapRing();
+    if (ring == nullptr)
+    {
+        error("State journal {PATH} unavailable, not recording to it", "PATH",
+              path);
+        return;
+    }
+    flushedTo = ring->persisted.load(std::memory_order_relaxed);
+}
+
+Writer::~Writer()
+{
+    if (ring != nullptr)
+    {
+        // Up to a batch may still be waiting on the timer, and the worker
+        // reads the ring until it's mirrored
+        flush();
+        io::worker().drain();
+        munmap(ring, ringSize(capacity));
+    }
+}
+
+Ring* Writer::mapRing()
+{
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    Ring* mapped = nullptr;
+    struct stat st;
+    if ((fstat(fd, &st) == 0) &&
+        (static_cast<std::size_t>(st.st_size) == ringSize(capacity)))
+    {
+        auto addr = mmap(nullptr, ringSize(capacity), PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            mapped = static_cast<Ring*>(addr);
+            if (!validRing(*mapped, ringSize(capacity)))
+            {
+                munmap(addr, ringSize(capacity));
+                mapped = nullptr;
+            }
+        }
+    }
+    close(fd);
+    return mapped;
+}
+
+void Writer::createRing(bool replace)
+{
+    auto tmpPath = path + ".tmp." + std::to_string(getpid());
+
+    int fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd < 0)
+    {
+        error("Failed to create {PATH}: {ERRNO}", "PATH", tmpPath, "ERRNO",
+              errno);
+        return;
+    }
+
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, ringSize(capacity)) == 0)
+    {
+        addr = mmap(nullptr, ringSize(capacity), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (addr == MAP_FAILED)
+    {
+        error("Failed to lay out {PATH}: {ERRNO}", "PATH", tmpPath, "ERRNO",
+              errno);
+        unlink(tmpPath.c_str());
+        return;
+    }
+
+    // Carry on from what made it to flash, so history and sequences
+    // survive a reboot
+    auto newRing = static_cast<Ring*>(addr);
+    auto persisted = readPersisted(persistPath.c_str());
+    auto keep = std::min(persisted.size(), static_cast<std::size_t>(capacity));
+    uint64_t last = 0;
+    for (auto it = persisted.end() - keep; it != persisted.end(); it++)
+    {
+        auto& slot = newRing->slots()[(it->sequence - 1) % capacity];
+        slot.record = *it;
+        slot.sequence.store(it->sequence, std::memory_order_relaxed);
+        last = it->sequence;
+    }
+
+    newRing->version = VERSION;
+    newRing->capacity = capacity;
+    newRing->next.store(last + 1, std::memory_order_relaxed);
+    newRing->persisted.store(last, std::memory_order_relaxed);
+    newRing->magic.store(MAGIC, std::memory_order_release);
+    munmap(addr, ringSize(capacity));
+
+    if (replace)
+    {
+        if (rename(tmpPath.c_str(), path.c_str()) != 0)
+        {
+            error("Failed to replace {PATH}: {ERRNO}", "PATH", path, "ERRNO",
+                  errno);
+            unlink(tmpPath.c_str());
+        }
+        return;
+    }
+
+    // Linked so a ring another manager created meanwhile is kept
+    if ((link(tmpPath.c_str(), path.c_str()) != 0) && (errno != EEXIST))
+    {
+        error("Failed to create {PATH}: {ERRNO}", "PATH", path, "ERRNO",
+              errno);
+    }
+    unlink(tmpPath.c_str());
+}
+
+void Writer::append(Source source, std::string_view previous,
+                    std::string_view state)
+{
+    if (ring == nullptr)
+    {
+        return;
+    }
+
+    auto sequence = ring->next.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = ring->slots()[(sequence - 1) % capacity];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = Record{.sequence = sequence,
+                         .timeUs = nowUs(),
+                         .source = source,
+                         .reserved = {},
+                         .previous = stateCode(source, previous),
+                         .state = stateCode(source, state),
+                         .reserved2 = 0};
+    slot.sequence.store(sequence, std::memory_order_release);
+
+    auto mirrored =
+        std::max(flushedTo, ring->persisted.load(std::memory_order_relaxed));
+    if ((sequence - mirrored) >= FLUSH_BATCH)
+    {
+        flush();
+    }
+    else if (!flushTimer.isEnabled())
+    {
+        flushTimer.restartOnce(FLUSH_INTERVAL);
+    }
+}
+
+void Writer::flush()
+{
+    if (ring == nullptr)
+    {
+        return;
+    }
+    flushTimer.setEnabled(false);
+
+    // Whatever is in the ring now is mirrored by the job, and one that
+    // fails is retried by the next flush as persisted doesn't move
+    flushedTo = ring->next.load(std::memory_order_acquire) - 1;
+    io::worker().queue([this]() { mirror(); });
+}
+
+void Writer::mirror()
+{
+    // The lock serializes flushes from the managers, each mirrors whatever
+    // the others haven't. A trim replaces the file, so retry if it was
+    // replaced while waiting for the lock.
+    int fd = -1;
+    struct stat st;
+    for (int attempt = 0; (fd < 0) && (attempt < 3); attempt++)
+    {
+        fd = open(persistPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC,
+                  0644);
+        if (fd < 0)
+        {
+            break;
+        }
+
+        struct stat current;
+        flock(fd, LOCK_EX);
+        if ((fstat(fd, &st) != 0) ||
+            (stat(persistPath.c_str(), &current) != 0) ||
+            (st.st_ino != current.st_ino))
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0)
+    {
+        error("Failed to open {PATH}: {ERRNO}", "PATH", persistPath, "ERRNO",
+              errno);
+        return;
+    }
+
+    // Start over on a mirror of another version rather than mix records
+    FileHeader header{};
+    if ((st.st_size != 0) &&
+        ((pread(fd, &header, sizeof(header), 0) != sizeof(header)) ||
+         (header.magic != MAGIC) || (header.version != VERSION) ||
+         (header.recordSize != sizeof(Record))))
+    {
+        info("Replacing {PATH}, it isn't a version {VERSION} journal", "PATH",
+             persistPath, "VERSION", VERSION);
+        if (ftruncate(fd, 0) == 0)
+        {
+            st.st_size = 0;
+        }
+    }
+    if (st.st_size == 0)
+    {
+        header = FileHeader{MAGIC, VERSION, sizeof(Record)};
+        writeAll(fd, &header, sizeof(header));
+    }
+
+    auto next = ring->next.load(std::memory_order_acquire);
+    auto from = ring->persisted.load(std::memory_order_acquire) + 1;
+    if ((next - from) > capacity)
+    {
+        error("State journal overran {COUNT} records before reaching flash",
+              "COUNT", next - from - capacity);
+        from = next - capacity;
+    }
+
+    // Stop at a record still being written, the next flush gets it
+    std::vector<Record> records;
+    for (auto sequence = from; sequence < next; sequence++)
+    {
+        auto record =
+            readSlot(ring->slots()[(sequence - 1) % capacity], sequence);
+        if (!record)
+        {
+            break;
+        }
+        records.push_back(*record);
+    }
+
+    if (!records.empty())
+    {
+        if (writeAll(fd, records.data(), records.size() * sizeof(Record)) &&
+            (fdatasync(fd) == 0))
+        {
+            ring->persisted.store(records.back().sequence,
+                                  std::memory_order_release);
+        }
+        else
+        {
+            error("Failed to write {PATH}: {ERRNO}", "PATH", persistPath,
+                  "ERRNO", errno);
+        }
+    }
+
+    if ((fstat(fd, &st) == 0) &&
+        (static_cast<std::size_t>(st.st_size) >
+         (sizeof(FileHeader) +
+          (PERSIST_MAX_RINGS * capacity * sizeof(Record)))))
+    {
+        trimPersisted();
+    }
+
+    close(fd);
+}
+
+void Writer::trimPersisted()
+{
+    auto records = readPersisted(persistPath.c_str());
+    auto keep = std::min(records.size(), 2 * static_cast<std::size_t>(capacity));
+
+    auto tmpPath = persistPath + ".tmp";
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd < 0)
+    {
+        error("Failed to create {PATH}: {ERRNO}", "PATH", tmpPath, "ERRNO",
+              errno);
+        return;
+    }
+
+    FileHeader header{MAGIC, VERSION, sizeof(Record)};
+    auto written =
+        writeAll(fd, &header, sizeof(header)) &&
+        writeAll(fd, records.data() + (records.size() - keep),
+                 keep * sizeof(Record)) &&
+        (fdatasync(fd) == 0);
+    close(fd);
+
+    if (!written || (rename(tmpPath.c_str(), persistPath.c_str()) != 0))
+    {
+        error("Failed to trim {PATH}: {ERRNO}", "PATH", persistPath, "ERRNO",
+              errno);
+        unlink(tmpPath.c_str());
+    }
+}
+
+} // namespace journal
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "state_journal_reader.hpp"
+
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace journal
+{
+
+/** @class Writer
+ *  @brief Appends a manager's state changes to the ring
+ *  @details Any manager may append, slots are claimed with an atomic
+ *  increment. Records are mirrored to flash once a batch has built up or
+ *  a little while after the last change, whichever comes first, so a burst
+ *  of changes over a boot costs one flash write. The mirroring runs on the
+ *  I/O worker, the event loop only queues it. A new ring, as after a
+ *  reboot, is seeded from the end of the flash mirror.
+ *
+ *  Journaling is best effort, a manager that can't map the ring carries on
+ *  without it.
+ */
+class Writer
+{
+  public:
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    Writer(Writer&&) = delete;
+    Writer& operator=(Writer&&) = delete;
+
+    /** @brief Map the ring, creating it if needed
+     *
+     * @param[in] event       - The event loop the flush timer runs on
+     * @param[in] path        - The ring, usually STATE_JOURNAL_FILE
+     * @param[in] persistPath - The flash mirror, usually
+     *                          STATE_JOURNAL_PERSIST_PATH
+     * @param[in] capacity    - The records the ring holds
+     */
+    Writer(const sdeventplus::Event& event, const char* path,
+           const char* persistPath, uint32_t capacity);
+
+    /** @brief Mirror what's left to flash and unmap the ring */
+    ~Writer();
+
+    /** @brief Append a state change
+     *
+     * @param[in] source   - The manager
+     * @param[in] previous - The state before, as its D-Bus string
+     * @param[in] state    - The new state, as its D-Bus string
+     */
+    void append(Source source, std::string_view previous,
+                std::string_view state);
+
+    /** @brief Queue mirroring the records not yet on flash on the I/O
+     *  worker
+     */
+    void flush();
+
+  private:
+    /** @brief Records to build up before mirroring them right away */
+    static constexpr uint64_t FLUSH_BATCH = 32;
+
+    /** @brief Longest a record waits to be mirrored */
+    static constexpr auto FLUSH_INTERVAL = std::chrono::seconds{30};
+
+    /** @brief The mirror is trimmed when it holds this many ring's worth */
+    static constexpr std::size_t PERSIST_MAX_RINGS = 4;
+
+    /** @brief Create a ring seeded from the flash mirror, unless another
+     *  manager got there first or replace is set
+     */
+    void createRing(bool replace);
+
+    /** @brief Map the ring, nullptr if it isn't one of this version and
+     *  capacity
+     */
+    Ring* mapRing();
+
+    /** @brief Mirror the records not yet on flash, run on the I/O worker */
+    void mirror();
+
+    /** @brief Rewrite the mirror with just its newest records */
+    void trimPersisted();
+
+    /** @brief The ring path */
+    const std::string path;
+
+    /** @brief The flash mirror path */
+    const std::string persistPath;
+
+    /** @brief The records the ring holds */
+    const uint32_t capacity;
+
+    /** @brief The mapped ring, nullptr if it couldn't be mapped */
+    Ring* ring = nullptr;
+
+    /** @brief The last sequence queued to be mirrored */
+    uint64_t flushedTo = 0;
+
+    /** @brief Mirrors records that didn't make up a batch */
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> flushTimer;
+};
+
+} // namespace journal
+} // namespace manager
+} // namespace state
+} // namespace phosphor
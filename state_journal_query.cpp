@@ -0,0 +1,192 @@
+#include "config.h"
+
+#include "state_journal_reader.hpp"
+
+#include <getopt.h>
+
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace phosphor::state::manager::journal;
+
+/** @brief Return the name of a source */
+static const char* sourceName(Source source)
+{
+    switch (source)
+    {
+        case Source::BMC:
+            return "bmc";
+        case Source::Chassis:
+            return "chassis";
+        case Source::Host:
+            return "host";
+    }
+    return "unknown";
+}
+
+/** @brief Return a source from its name */
+static std::optional<Source> parseSource(const std::string& name)
+{
+    for (auto source : {Source::BMC, Source::Chassis, Source::Host})
+    {
+        if (name == sourceName(source))
+        {
+            return source;
+        }
+    }
+    return std::nullopt;
+}
+
+/** @brief Return the D-Bus string of a recorded state, or its number if it
+ *  isn't one this build knows
+ */
+static std::string describeState(uint32_t state)
+{
+    if (auto known = stateName(state))
+    {
+        return std::string{known->name};
+    }
+    return std::to_string(state);
+}
+
+/** @brief Return the source and number of a state from its D-Bus string */
+static std::optional<std::pair<Source, uint32_t>>
+    parseState(const std::string& value)
+{
+    for (uint32_t i = 0; i < STATES.size(); i++)
+    {
+        if (STATES[i].name == value)
+        {
+            return std::make_pair(STATES[i].source, i);
+        }
+    }
+    return std::nullopt;
+}
+
+static void usage(const char* name)
+{
+    std::fprintf(
+        stderr,
+        "Usage: %s [options]\n"
+        "Print the recorded BMC, chassis and host state changes, oldest "
+        "first.\n"
+        "  -s, --source bmc|chassis|host  only changes of this manager\n"
+        "  -S, --state STATE              only changes to this D-Bus state\n"
+        "  -f, --from SECONDS             only changes at or after this "
+        "epoch time\n"
+        "  -t, --to SECONDS               only changes at or before this "
+        "epoch time\n"
+        "  -p, --persisted                read the flash copy, which goes "
+        "further back\n",
+        name);
+}
+
+int main(int argc, char** argv)
+{
+    Filter filter;
+    bool persisted = false;
+
+    static struct option longOpts[] = {{"source", required_argument, 0, 's'},
+                                       {"state", required_argument, 0, 'S'},
+                                       {"from", required_argument, 0, 'f'},
+                                       {"to", required_argument, 0, 't'},
+                                       {"persisted", no_argument, 0, 'p'},
+                                       {0, 0, 0, 0}};
+
+    int arg;
+    int optIndex = 0;
+    while ((arg = getopt_long(argc, argv, "s:S:f:t:p", longOpts,
+                              &optIndex)) != -1)
+    {
+        try
+        {
+            switch (arg)
+            {
+                case 's':
+                    filter.source = parseSource(optarg);
+                    if (!filter.source)
+                    {
+                        usage(argv[0]);
+                        return 2;
+                    }
+                    break;
+                case 'S':
+                {
+                    auto state = parseState(optarg);
+                    if (!state || (filter.source &&
+                                   (*filter.source != state->first)))
+                    {
+                        std::fprintf(stderr, "Unknown state %s\n", optarg);
+                        return 2;
+                    }
+                    filter.source = state->first;
+                    filter.state = state->second;
+                    break;
+                }
+                case 'f':
+                    filter.fromUs = std::stoull(optarg) * 1000000;
+                    break;
+                case 't':
+                    filter.toUs = std::stoull(optarg) * 1000000;
+                    break;
+                case 'p':
+                    persisted = true;
+                    break;
+                default:
+                    usage(argv[0]);
+                    return 2;
+            }
+        }
+        catch (const std::exception&)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Record> records;
+    if (persisted)
+    {
+        for (const auto& record : readPersisted(STATE_JOURNAL_PERSIST_PATH))
+        {
+            if (matches(record, filter))
+            {
+                records.push_back(record);
+            }
+        }
+    }
+    else
+    {
+        Reader reader{STATE_JOURNAL_FILE};
+        if (!reader.valid())
+        {
+            std::fprintf(stderr, "No state journal at %s\n",
+                         STATE_JOURNAL_FILE);
+            return 1;
+        }
+        records = reader.query(filter);
+    }
+
+    for (const auto& record : records)
+    {
+        time_t seconds = record.timeUs / 1000000;
+        struct tm tm;
+        char time[32];
+        gmtime_r(&seconds, &tm);
+        std::strftime(time, sizeof(time), "%Y-%m-%dT%H:%M:%S", &tm);
+
+        std::printf("%llu %s.%06lluZ %s %s -> %s\n",
+                    static_cast<unsigned long long>(record.sequence), time,
+                    static_cast<unsigned long long>(record.timeUs % 1000000),
+                    sourceName(record.source),
+                    describeState(record.previous).c_str(),
+                    describeState(record.state).c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace journal
+{
+
+/** @brief "PSMJ" */
+constexpr uint32_t MAGIC = 0x4a4d5350;
+
+/** @brief Bumped whenever the layout of the ring or records, or what the
+ *  states stored in them mean, changes
+ */
+constexpr uint16_t VERSION = 2;
+
+/** @brief The manager a record came from */
+enum class Source : uint8_t
+{
+    BMC = 1,
+    Chassis = 2,
+    Host = 3
+};
+
+/** @brief A state records can hold */
+struct StateName
+{
+    Source source;
+    std::string_view name;
+};
+
+/** @brief The states records hold, by the number stored for them
+ *
+ *  The sdbusplus enum values follow the order of the interface YAML, so
+ *  they aren't stored as they could change under a rebuild. Only ever
+ *  append to this, changing what's here needs a VERSION bump.
+ */
+constexpr std::array STATES = {
+    StateName{Source::BMC, "xyz.openbmc_project.State.BMC.BMCState.Ready"},
+    StateName{Source::BMC, "xyz.openbmc_project.State.BMC.BMCState.NotReady"},
+    StateName{Source::BMC,
+              "xyz.openbmc_project.State.BMC.BMCState.UpdateInProgress"},
+    StateName{Source::BMC, "xyz.openbmc_project.State.BMC.BMCState.Quiesced"},
+    StateName{Source::Chassis,
+              "xyz.openbmc_project.State.Chassis.PowerState.Off"},
+    StateName{Source::Chassis,
+              "xyz.openbmc_project.State.Chassis.PowerState.On"},
+    StateName{Source::Chassis,
+              "xyz.openbmc_project.State.Chassis.PowerState."
+              "TransitioningToOff"},
+    StateName{Source::Chassis,
+              "xyz.openbmc_project.State.Chassis.PowerState."
+              "TransitioningToOn"},
+    StateName{Source::Host, "xyz.openbmc_project.State.Host.HostState.Off"},
+    StateName{Source::Host,
+              "xyz.openbmc_project.State.Host.HostState.Running"},
+    StateName{Source::Host,
+              "xyz.openbmc_project.State.Host.HostState.TransitioningToRunning"},
+    StateName{Source::Host,
+              "xyz.openbmc_project.State.Host.HostState.TransitioningToOff"},
+    StateName{Source::Host,
+              "xyz.openbmc_project.State.Host.HostState.Quiesced"},
+    StateName{Source::Host,
+              "xyz.openbmc_project.State.Host.HostState.DiagnosticMode"},
+    StateName{Source::Host,
+              "xyz.openbmc_project.State.Host.HostState.Standby"},
+};
+
+/** @brief Stored for a state that isn't in STATES */
+constexpr uint32_t UNKNOWN_STATE = UINT32_MAX;
+
+/** @brief Return the number stored for a manager's state
+ *
+ * @param[in] source - The manager
+ * @param[in] name   - The state's D-Bus string
+ *
+ * @return Its index in STATES, UNKNOWN_STATE if it isn't there
+ */
+constexpr uint32_t stateCode(Source source, std::string_view name)
+{
+    for (uint32_t i = 0; i < STATES.size(); i++)
+    {
+        if ((STATES[i].source == source) && (STATES[i].name == name))
+        {
+            return i;
+        }
+    }
+    return UNKNOWN_STATE;
+}
+
+/** @brief Return the state stored as a number, nullopt if it's unknown */
+constexpr std::optional<StateName> stateName(uint32_t code)
+{
+    if (code >= STATES.size())
+    {
+        return std::nullopt;
+    }
+    return STATES[code];
+}
+
+/** @brief One state change
+ *
+ *  States are stored as their index in STATES, see stateCode().
+ */
+struct Record
+{
+    uint64_t sequence;
+    uint64_t timeUs;
+    Source source;
+    uint8_t reserved[3];
+    uint32_t previous;
+    uint32_t state;
+    uint32_t reserved2;
+};
+
+static_assert(sizeof(Record) == 32);
+
+/** @brief A ring slot, its sequence is 0 while being written */
+struct Slot
+{
+    std::atomic<uint64_t> sequence;
+    Record record;
+};
+
+/** @brief The header of the ring in /run, followed by its slots
+ *
+ *  next is the sequence the next record gets and persisted the last one
+ *  mirrored to flash. Sequences start at 1 and carry on across reboots.
+ */
+struct Ring
+{
+    std::atomic<uint32_t> magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t capacity;
+    uint32_t reserved2;
+    std::atomic<uint64_t> next;
+    std::atomic<uint64_t> persisted;
+
+    Slot* slots()
+    {
+        return reinterpret_cast<Slot*>(this + 1);
+    }
+
+    const Slot* slots() const
+    {
+        return reinterpret_cast<const Slot*>(this + 1);
+    }
+};
+
+/** @brief The header of the flash mirror, followed by its records */
+struct FileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+/** @brief Return the size of a ring of the given capacity */
+inline std::size_t ringSize(uint32_t capacity)
+{
+    return sizeof(Ring) + (static_cast<std::size_t>(capacity) * sizeof(Slot));
+}
+
+/** @brief Return true if the header is that of a ring of this version */
+inline bool validRing(const Ring& ring, std::size_t size)
+{
+    return (ring.magic.load(std::memory_order_acquire) == MAGIC) &&
+           (ring.version == VERSION) && (ring.capacity != 0) &&
+           (ringSize(ring.capacity) == size);
+}
+
+/** @brief Read a slot, if it holds the given record and isn't being
+ *  rewritten
+ */
+inline std::optional<Record> readSlot(const Slot& slot, uint64_t sequence)
+{
+    if (slot.sequence.load(std::memory_order_acquire) != sequence)
+    {
+        return std::nullopt;
+    }
+
+    Record record = slot.record;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+    {
+        return std::nullopt;
+    }
+    return record;
+}
+
+/** @brief What to return from a query, an empty filter matches all */
+struct Filter
+{
+    std::optional<Source> source = std::nullopt;
+    std::optional<uint32_t> state = std::nullopt;
+    std::optional<uint64_t> fromUs = std::nullopt;
+    std::optional<uint64_t> toUs = std::nullopt;
+};
+
+/** @brief Return true if the record matches the filter
+ *
+ *  A state only matches records of the filter's source, if it has one. The
+ *  time range includes both ends.
+ */
+inline bool matches(const Record& record, const Filter& filter)
+{
+    return (!filter.source || (record.source == *filter.source)) &&
+           (!filter.state || (record.state == *filter.state)) &&
+           (!filter.fromUs || (record.timeUs >= *filter.fromUs)) &&
+           (!filter.toUs || (record.timeUs <= *filter.toUs));
+}
+
+/** @brief Read the records mirrored to flash
+ *
+ * @param[in] path - The flash mirror, usually STATE_JOURNAL_PERSIST_PATH
+ *
+ * @return The records, oldest first, empty if there's no usable file
+ */
+inline std::vector<Record> readPersisted(const char* path)
+{
+    std::vector<Record> records;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return records;
+    }
+
+    FileHeader header{};
+    struct stat st;
+    if ((fstat(fd, &st) == 0) &&
+        (pread(fd, &header, sizeof(header), 0) == sizeof(header)) &&
+        (header.magic == MAGIC) && (header.version == VERSION) &&
+        (header.recordSize == sizeof(Record)))
+    {
+        auto count = (static_cast<std::size_t>(st.st_size) - sizeof(header)) /
+                     sizeof(Record);
+        records.resize(count);
+        auto size = pread(fd, records.data(), count * sizeof(Record),
+                          sizeof(header));
+        records.resize((size > 0) ? (size / sizeof(Record)) : 0);
+    }
+    close(fd);
+    return records;
+}
+
+/** @class Reader
+ *  @brief Queries the state change ring in /run
+ *  @details Maps the ring read only, a query is a scan of at most its
+ *  capacity and never blocks the managers appending to it. Records being
+ *  rewritten as the query passes are skipped.
+ */
+class Reader
+{
+  public:
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    Reader(Reader&&) = delete;
+    Reader& operator=(Reader&&) = delete;
+
+    /** @brief Map the ring
+     *
+     * @param[in] path - The ring, usually STATE_JOURNAL_FILE
+     */
+    explicit Reader(const char* path)
+    {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        struct stat st;
+        if ((fstat(fd, &st) == 0) &&
+            (static_cast<std::size_t>(st.st_size) >= sizeof(Ring)))
+        {
+            auto addr =
+                mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                ring = static_cast<const Ring*>(addr);
+                size = st.st_size;
+                if (!validRing(*ring, size))
+                {
+                    munmap(addr, size);
+                    ring = nullptr;
+                }
+            }
+        }
+        close(fd);
+    }
+
+    ~Reader()
+    {
+        if (ring != nullptr)
+        {
+            munmap(const_cast<Ring*>(ring), size);
+        }
+    }
+
+    /** @brief Return true if the ring could be mapped */
+    bool valid() const
+    {
+        return ring != nullptr;
+    }
+
+    /** @brief Return the records matching a filter
+     *
+     * @param[in] filter - What to return
+     *
+     * @return The records, oldest first
+     */
+    std::vector<Record> query(const Filter& filter = {}) const
+    {
+        std::vector<Record> records;
+        if (ring == nullptr)
+        {
+            return records;
+        }
+
+        auto next = ring->next.load(std::memory_order_acquire);
+        auto first = (next > ring->capacity) ? (next - ring->capacity) : 1;
+        for (auto sequence = first; sequence < next; sequence++)
+        {
+            auto record = readSlot(
+                ring->slots()[(sequence - 1) % ring->capacity], sequence);
+            if (record && matches(*record, filter))
+            {
+                records.push_back(*record);
+            }
+        }
+        return records;
+    }
+
+  private:
+    /** @brief The mapped ring, nullptr if it couldn't be mapped */
+    const Ring* ring = nullptr;
+
+    /** @brief The size of the mapping */
+    std::size_t size = 0;
+};
+
+} // namespace journal
+} // namespace manager
+} // namespace state
+} // namespace phosphor
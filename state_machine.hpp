@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace sm
+{
+
+/** @brief What a guard requires of its systemd unit */
+enum class Require
+{
+    None,
+    Active,
+    Inactive
+};
+
+/** @brief A condition on a systemd unit checked before a rule is applied */
+struct Guard
+{
+    std::string_view unit = {};
+    Require require = Require::None;
+};
+
+/** @brief One entry of a state machine table
+ *
+ *  The rule applies to an event, which is a systemd unit and job result
+ *  for JobRemoved, a unit alone for JobNew or a property value. When its
+ *  guard holds the state is set, if it has one, and then the action is
+ *  run, if it has one.
+ *
+ *  @tparam Machine - The state manager class
+ *  @tparam State   - Its state enum
+ */
+template <typename Machine, typename State>
+struct Rule
+{
+    std::string_view event;
+    std::string_view result = {};
+    Guard guard = {};
+    std::optional<State> state = std::nullopt;
+    void (Machine::*action)() = nullptr;
+};
+
+/** @brief Binds a requested transition to the systemd target started */
+template <typename Transition>
+struct Target
+{
+    Transition transition;
+    std::string_view unit;
+};
+
+/** @class Engine
+ *  @brief Table driven state machine
+ *  @details Built at compile time by makeEngine(), which sorts the rules
+ *  by event length and then event. Dispatch scans small tables, stopping
+ *  at the first longer event, and binary searches larger ones. valid() is
+ *  meant to be used in a static_assert next to the table.
+ *
+ *  The engine calls the state setter, unit check and actions through
+ *  member pointers, so the table must be built where they're accessible,
+ *  usually as a static constexpr local of a member function.
+ */
+template <typename Machine, typename State, std::size_t N>
+class Engine
+{
+  public:
+    using RuleType = Rule<Machine, State>;
+    using Setter = State (Machine::*)(State);
+    using UnitActive = bool (Machine::*)(const std::string&);
+
+    constexpr Engine(Setter setter, UnitActive unitActive,
+                     const std::array<RuleType, N>& rules) :
+        setter(setter),
+        unitActive(unitActive), rules(rules)
+    {
+        // Insertion sort, the tables are small and it's constexpr
+        for (std::size_t i = 1; i < N; i++)
+        {
+            for (std::size_t j = i;
+                 (j > 0) && less(this->rules[j], this->rules[j - 1]); j--)
+            {
+                std::swap(this->rules[j], this->rules[j - 1]);
+            }
+        }
+    }
+
+    /** @brief Check the table, for use in a static_assert
+     *
+     *  Events must be unique, a guard must name a unit exactly when it
+     *  requires something of one and every rule must do something.
+     */
+    constexpr bool valid() const
+    {
+        if (setter == nullptr)
+        {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < N; i++)
+        {
+            const auto& rule = rules[i];
+
+            if (rule.event.empty())
+            {
+                return false;
+            }
+            if ((i > 0) && !less(rules[i - 1], rule))
+            {
+                return false;
+            }
+            if (rule.guard.unit.empty() !=
+                (rule.guard.require == Require::None))
+            {
+                return false;
+            }
+            if ((rule.guard.require != Require::None) &&
+                (unitActive == nullptr))
+            {
+                return false;
+            }
+            if (!rule.state && (rule.action == nullptr))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** @brief Find the rule for an event
+     *
+     *  @param[in] event  - The unit or property value
+     *  @param[in] result - The job result, empty if there isn't one
+     *
+     *  @return The rule, nullptr if there is none
+     */
+    constexpr const RuleType* find(std::string_view event,
+                                   std::string_view result = {}) const
+    {
+        // A scan beats a search on the handful of rules the managers have
+        if constexpr (N <= LINEAR_MAX)
+        {
+            for (const auto& rule : rules)
+            {
+                if (rule.event.size() > event.size())
+                {
+                    break;
+                }
+                if ((rule.event == event) && (rule.result == result))
+                {
+                    return &rule;
+                }
+            }
+            return nullptr;
+        }
+        else
+        {
+            auto it = std::lower_bound(
+                rules.begin(), rules.end(), std::make_pair(event, result),
+                [](const RuleType& rule, const auto& key) {
+                    return keyLess(rule.event, rule.result, key.first,
+                                   key.second);
+                });
+            if ((it == rules.end()) || (it->event != event) ||
+                (it->result != result))
+            {
+                return nullptr;
+            }
+            return &*it;
+        }
+    }
+
+    /** @brief Apply the rule for an event, if there is one and its guard
+     *  holds
+     *
+     *  @param[in] machine - The state manager
+     *  @param[in] event   - The unit or property value
+     *  @param[in] result  - The job result, empty if there isn't one
+     *
+     *  @return true if a rule was applied
+     */
+    bool dispatch(Machine& machine, std::string_view event,
+                  std::string_view result = {}) const
+    {
+        auto rule = find(event, result);
+        if (rule == nullptr)
+        {
+            return false;
+        }
+
+        if (rule->guard.require != Require::None)
+        {
+            auto unit = std::string{rule->guard.unit};
+            auto active = (machine.*unitActive)(unit);
+            if (active != (rule->guard.require == Require::Active))
+            {
+                return false;
+            }
+        }
+
+        if (rule->state)
+        {
+            (machine.*setter)(*rule->state);
+        }
+        if (rule->action != nullptr)
+        {
+            (machine.*(rule->action))();
+        }
+        return true;
+    }
+
+  private:
+    /** @brief Tables up to this size are scanned rather than searched */
+    static constexpr std::size_t LINEAR_MAX = 8;
+
+    /** @brief Order events by length first, most unit names differ in
+     *  length so a probe rarely needs to compare characters
+     */
+    static constexpr bool keyLess(std::string_view aEvent,
+                                  std::string_view aResult,
+                                  std::string_view bEvent,
+                                  std::string_view bResult)
+    {
+        if (aEvent.size() != bEvent.size())
+        {
+            return aEvent.size() < bEvent.size();
+        }
+        if (aEvent != bEvent)
+        {
+            return aEvent < bEvent;
+        }
+        return aResult < bResult;
+    }
+
+    static constexpr bool less(const RuleType& a, const RuleType& b)
+    {
+        return keyLess(a.event, a.result, b.event, b.result);
+    }
+
+    /** @brief Sets the machine's current state */
+    Setter setter;
+
+    /** @brief Checks if a systemd unit is active, for guards */
+    UnitActive unitActive;
+
+    /** @brief The rules, sorted by event */
+    std::array<RuleType, N> rules;
+};
+
+/** @brief Build an engine, usually into a static constexpr
+ *
+ *  @param[in] setter     - Sets the machine's current state
+ *  @param[in] unitActive - Checks if a unit is active, nullptr if no rule
+ *                          has a guard
+ *  @param[in] rules      - The rules, in any order
+ */
+template <typename Machine, typename State, std::size_t N>
+constexpr auto makeEngine(
+    State (Machine::*setter)(State),
+    std::type_identity_t<bool (Machine::*)(const std::string&)> unitActive,
+    const Rule<Machine, State> (&rules)[N])
+{
+    std::array<Rule<Machine, State>, N> sorted{};
+    std::copy(std::begin(rules), std::end(rules), sorted.begin());
+    return Engine<Machine, State, N>(setter, unitActive, sorted);
+}
+
+/** @brief Check a target table, for use in a static_assert
+ *
+ *  Each transition must be bound once and to a unit.
+ */
+template <typename Transition, std::size_t N>
+constexpr bool validTargets(const std::array<Target<Transition>, N>& targets)
+{
+    for (std::size_t i = 0; i < N; i++)
+    {
+        if (targets[i].unit.empty())
+        {
+            return false;
+        }
+        for (std::size_t j = i + 1; j < N; j++)
+        {
+            if (targets[i].transition == targets[j].transition)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** @brief Find the unit a transition starts
+ *
+ *  @return The unit, empty if the transition isn't bound
+ */
+template <typename Transition, std::size_t N>
+constexpr std::string_view
+    findTarget(const std::array<Target<Transition>, N>& targets,
+               Transition transition)
+{
+    for (const auto& target : targets)
+    {
+        if (target.transition == transition)
+        {
+            return target.unit;
+        }
+    }
+    return {};
+}
+
+} // namespace sm
+} // namespace manager
+} // namespace state
+} // namespace phosphor
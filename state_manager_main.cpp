@@ -0,0 +1,98 @@
+#include "config.h"
+
+#include "bmc_state_manager.hpp"
+#include "chassis_state_manager.hpp"
+#include "event_loop_monitor.hpp"
+#include "host_state_manager.hpp"
+#ifdef ENABLE_CONSOLIDATED_HYPERVISOR
+#include "hypervisor_state_manager.hpp"
+#endif
+#include "scheduled_host_transition.hpp"
+#include "startup_timing.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdeventplus/event.hpp>
+
+#include <filesystem>
+#include <string>
+
+/* Runs the BMC, Chassis, Host and ScheduledHostTransition managers, and
+ * the Hypervisor manager if built with it, in one process, on one bus
+ * connection and event loop. Each still owns its own bus name, so clients
+ * and the per-manager service names are unaffected.
+ */
+int main()
+{
+    namespace fs = std::filesystem;
+    namespace startup = phosphor::state::manager::startup;
+
+    startup::milestone("main");
+
+    auto event = sdeventplus::Event::get_default();
+    auto bus = sdbusplus::bus::new_default();
+    startup::milestone("bus");
+
+    for (const auto& file :
+         {POH_COUNTER_PERSIST_PATH, HOST_STATE_PERSIST_PATH,
+          SCHEDULED_HOST_TRANSITION_PERSIST_PATH})
+    {
+        fs::create_directories(fs::path(file).parent_path());
+    }
+
+    // For now, we only have one instance of each
+    auto bmcPath = std::string{BMC_OBJPATH} + '0';
+    auto chassisPath = std::string{CHASSIS_OBJPATH} + '0';
+    auto hostPath = std::string{HOST_OBJPATH} + '0';
+
+    // Add sdbusplus ObjectManagers. Host and ScheduledHostTransition share
+    // an object, so one manager covers both.
+    sdbusplus::server::manager::manager bmcObjManager(bus, bmcPath.c_str());
+    sdbusplus::server::manager::manager chassisObjManager(bus,
+                                                          chassisPath.c_str());
+    sdbusplus::server::manager::manager hostObjManager(bus, hostPath.c_str());
+
+    phosphor::state::manager::BMC bmc(bus, bmcPath.c_str());
+    startup::milestone("bmc");
+    phosphor::state::manager::Chassis chassis(bus, chassisPath.c_str());
+    startup::milestone("chassis");
+#ifdef ENABLE_CONSOLIDATED_HYPERVISOR
+    auto hypervisorPath = std::string{HYPERVISOR_OBJPATH} + '0';
+    sdbusplus::server::manager::manager hypervisorObjManager(
+        bus, hypervisorPath.c_str());
+    phosphor::state::manager::Hypervisor hypervisor(bus,
+                                                    hypervisorPath.c_str());
+    startup::milestone("hypervisor");
+#endif
+    phosphor::state::manager::Host host(bus, hostPath.c_str());
+#ifdef ENABLE_HOST_POWER_RESTORE
+    // The BMC object isn't reachable over D-Bus until its name is owned,
+    // and calling ourselves would block anyway, so its cause is passed in
+    namespace server = sdbusplus::xyz::openbmc_project::State::server;
+    host.runPowerRestorePolicy(
+        server::convertForMessage(bmc.server::BMC::lastRebootCause()));
+#endif
+    startup::milestone("host");
+    phosphor::state::manager::ScheduledHostTransition scheduled(
+        bus, hostPath.c_str(), event);
+    startup::milestone("scheduled");
+
+    // One loop, so one set of statistics, on the BMC object
+    phosphor::state::manager::eventloop::Monitor loopMonitor(bus, event,
+                                                             bmcPath);
+
+    // The Host name goes last, it's the one the service waits for so the
+    // others must already be owned once systemd considers us started
+    bus.request_name(BMC_BUSNAME);
+    bus.request_name(CHASSIS_BUSNAME);
+#ifdef ENABLE_CONSOLIDATED_HYPERVISOR
+    bus.request_name(HYPERVISOR_BUSNAME);
+#endif
+    bus.request_name(SCHEDULED_HOST_TRANSITION_BUSNAME);
+    bus.request_name(HOST_BUSNAME);
+    startup::milestone(startup::READY);
+
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    event.loop();
+
+    return 0;
+}
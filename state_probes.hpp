@@ -0,0 +1,152 @@
+#pragma once
+
+#include <time.h>
+
+#include <cstdint>
+#include <string_view>
+
+/* USDT probes of the phosphor_state_manager provider, for perf and bpftrace
+ * to attach to. They compile to nothing unless the usdt-probes option is
+ * enabled, and then each is a nop until something attaches to it. The
+ * arguments are only evaluated when probes are compiled in.
+ */
+#ifdef ENABLE_USDT_PROBES
+#include <sys/sdt.h>
+
+#define STATE_PROBE(name, ...)                                                 \
+    STAP_PROBEV(phosphor_state_manager, name, __VA_ARGS__)
+#else
+#define STATE_PROBE(name, ...)                                                 \
+    static_cast<void>(                                                         \
+        sizeof(phosphor::state::manager::probes::discard(__VA_ARGS__)))
+#endif
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace probes
+{
+
+/** @brief The manager firing a probe, its first argument */
+enum Manager : int
+{
+    BMC = 1,
+    Chassis = 2,
+    Host = 3,
+    Hypervisor = 4,
+    Scheduled = 5,
+};
+
+/** @brief Stands in for a probe's arguments when probes are compiled out,
+ *  so values only computed for a probe aren't unused. Never called.
+ */
+template <typename... Args>
+int discard(const Args&... args);
+
+/** @brief Return the CLOCK_MONOTONIC time in nanoseconds, for probe
+ *  durations, or 0 when probes are compiled out
+ */
+inline uint64_t now()
+{
+#ifdef ENABLE_USDT_PROBES
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (static_cast<uint64_t>(ts.tv_sec) * 1000000000) + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/** @brief Return the instance number ending an object path, such as the 0
+ *  of /xyz/openbmc_project/state/host0, or 0 if it has none
+ */
+inline uint32_t instanceOf(std::string_view objPath)
+{
+    auto digits = objPath.find_last_not_of("0123456789");
+    digits = (digits == std::string_view::npos) ? 0 : digits + 1;
+
+    uint32_t instance = 0;
+    for (auto c : objPath.substr(digits))
+    {
+        instance = (instance * 10) + (c - '0');
+    }
+    return instance;
+}
+
+/** @class MapperCall
+ *  @brief Fires mapper_begin when constructed and mapper_end, with the
+ *  duration, when it goes out of scope, whether or not the call threw
+ */
+class MapperCall
+{
+  public:
+    MapperCall(const MapperCall&) = delete;
+    MapperCall& operator=(const MapperCall&) = delete;
+    MapperCall(MapperCall&&) = delete;
+    MapperCall& operator=(MapperCall&&) = delete;
+
+    /** @brief Fire mapper_begin
+     *
+     * @param[in] method  - The mapper method, such as GetObject
+     * @param[in] subject - The path or interface looked up
+     */
+    MapperCall(const char* method, const char* subject) :
+        method(method), subject(subject), start(now())
+    {
+        STATE_PROBE(mapper_begin, method, subject);
+    }
+
+    ~MapperCall()
+    {
+        STATE_PROBE(mapper_end, method, subject, now() - start);
+    }
+
+  private:
+    [[maybe_unused]] const char* method;
+    [[maybe_unused]] const char* subject;
+    [[maybe_unused]] uint64_t start;
+};
+
+/** @class PersistWrite
+ *  @brief Fires persist_begin when constructed and persist_end, with the
+ *  duration, when it goes out of scope
+ */
+class PersistWrite
+{
+  public:
+    PersistWrite(const PersistWrite&) = delete;
+    PersistWrite& operator=(const PersistWrite&) = delete;
+    PersistWrite(PersistWrite&&) = delete;
+    PersistWrite& operator=(PersistWrite&&) = delete;
+
+    /** @brief Fire persist_begin
+     *
+     * @param[in] manager  - The manager writing
+     * @param[in] instance - The manager's instance
+     * @param[in] path     - The file written, which must outlive this
+     */
+    PersistWrite(Manager manager, uint32_t instance, const char* path) :
+        manager(manager), instance(instance), path(path), start(now())
+    {
+        STATE_PROBE(persist_begin, manager, instance, path);
+    }
+
+    ~PersistWrite()
+    {
+        STATE_PROBE(persist_end, manager, instance, path, now() - start);
+    }
+
+  private:
+    [[maybe_unused]] Manager manager;
+    [[maybe_unused]] uint32_t instance;
+    [[maybe_unused]] const char* path;
+    [[maybe_unused]] uint64_t start;
+};
+
+} // namespace probes
+} // namespace manager
+} // namespace state
+} // namespace phosphor
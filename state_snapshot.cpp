@@ -0,0 +1,157 @@
+#include "state_snapshot.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+#include <filesystem>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace snapshot
+{
+
+PHOSPHOR_LOG2_USING;
+
+namespace fs = std::filesystem;
+
+/** @brief Map the snapshot at path, if it's one of this version */
+static Snapshot* mapSnapshot(const char* path)
+{
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    Snapshot* snapshot = nullptr;
+    struct stat st;
+    if ((fstat(fd, &st) == 0) &&
+        (static_cast<std::size_t>(st.st_size) == sizeof(Snapshot)))
+    {
+        auto addr = mmap(nullptr, sizeof(Snapshot), PROT_READ | PROT_WRITE,
+                         MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            snapshot = static_cast<Snapshot*>(addr);
+            if (!validHeader(*snapshot))
+            {
+                munmap(addr, sizeof(Snapshot));
+                snapshot = nullptr;
+            }
+        }
+    }
+    close(fd);
+    return snapshot;
+}
+
+/** @brief Lay out an empty snapshot and move it into place
+ *
+ *  The file is built aside so a reader never maps one of the wrong size. A
+ *  new file is linked rather than renamed in, so if another manager got
+ *  there first its snapshot is kept.
+ *
+ *  @param[in] path    - The snapshot file
+ *  @param[in] replace - Whether to replace an existing file
+ */
+static void createSnapshot(const char* path, bool replace)
+{
+    auto tmpPath = std::string{path} + ".tmp." + std::to_string(getpid());
+
+    int fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+    if (fd < 0)
+    {
+        error("Failed to create {PATH}: {ERRNO}", "PATH", tmpPath, "ERRNO",
+              errno);
+        return;
+    }
+
+    void* addr = MAP_FAILED;
+    if (ftruncate(fd, sizeof(Snapshot)) == 0)
+    {
+        addr = mmap(nullptr, sizeof(Snapshot), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+    }
+    close(fd);
+
+    if (addr == MAP_FAILED)
+    {
+        error("Failed to lay out {PATH}: {ERRNO}", "PATH", tmpPath, "ERRNO",
+              errno);
+        unlink(tmpPath.c_str());
+        return;
+    }
+
+    // The file starts zeroed, so every section is unpublished
+    auto snapshot = static_cast<Snapshot*>(addr);
+    snapshot->version = VERSION;
+    snapshot->size = sizeof(Snapshot);
+    snapshot->magic.store(MAGIC, std::memory_order_release);
+    munmap(addr, sizeof(Snapshot));
+
+    if (replace)
+    {
+        if (rename(tmpPath.c_str(), path) != 0)
+        {
+            error("Failed to replace {PATH}: {ERRNO}", "PATH", path, "ERRNO",
+                  errno);
+            unlink(tmpPath.c_str());
+        }
+        return;
+    }
+
+    if ((link(tmpPath.c_str(), path) != 0) && (errno != EEXIST))
+    {
+        error("Failed to create {PATH}: {ERRNO}", "PATH", path, "ERRNO",
+              errno);
+    }
+    unlink(tmpPath.c_str());
+}
+
+Writer::Writer(const char* path)
+{
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    snapshot = mapSnapshot(path);
+    if (snapshot != nullptr)
+    {
+        return;
+    }
+
+    if (access(path, F_OK) == 0)
+    {
+        info("Replacing {PATH}, it isn't a version {VERSION} snapshot",
+             "PATH", path, "VERSION", VERSION);
+        createSnapshot(path, true);
+    }
+    else
+    {
+        createSnapshot(path, false);
+    }
+
+    snapshot = mapSnapshot(path);
+    if (snapshot == nullptr)
+    {
+        error("State snapshot {PATH} unavailable, not publishing to it",
+              "PATH", path);
+    }
+}
+
+Writer::~Writer()
+{
+    if (snapshot != nullptr)
+    {
+        munmap(snapshot, sizeof(Snapshot));
+    }
+}
+
+} // namespace snapshot
+} // namespace manager
+} // namespace state
+} // namespace phosphor
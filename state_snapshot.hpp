@@ -0,0 +1,290 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace snapshot
+{
+
+/** @brief "PSMS" */
+constexpr uint32_t MAGIC = 0x534d5350;
+
+/** @brief Bumped whenever the layout of Snapshot changes */
+constexpr uint16_t VERSION = 1;
+
+/** @brief Room for a D-Bus enum value, NUL included */
+constexpr std::size_t VALUE_MAX = 96;
+
+/** @brief A D-Bus enum value, as its string */
+using Value = std::array<char, VALUE_MAX>;
+
+/** @brief The values published by the BMC manager */
+enum BMCValue : std::size_t
+{
+    CurrentBMCState,
+    BMCValueCount
+};
+
+/** @brief The values published by the chassis manager */
+enum ChassisValue : std::size_t
+{
+    CurrentPowerState,
+    CurrentPowerStatus,
+    ChassisValueCount
+};
+
+/** @brief The values published by the host manager */
+enum HostValue : std::size_t
+{
+    CurrentHostState,
+    RequestedHostTransition,
+    BootProgress,
+    OperatingSystemState,
+    HostValueCount
+};
+
+/** @brief The values one manager publishes, under a seqlock
+ *
+ *  The sequence is odd while the owner is writing and 0 until it first
+ *  publishes. Each section has a single writer, so the managers never
+ *  contend with each other.
+ */
+template <std::size_t N>
+struct Section
+{
+    std::atomic<uint32_t> sequence;
+    uint32_t reserved;
+    std::array<Value, N> values;
+};
+
+/** @brief The layout of the snapshot file */
+struct Snapshot
+{
+    std::atomic<uint32_t> magic;
+    uint16_t version;
+    uint16_t size;
+    Section<BMCValueCount> bmc;
+    Section<ChassisValueCount> chassis;
+    Section<HostValueCount> host;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+/** @brief Return true if the header is that of a snapshot of this version */
+inline bool validHeader(const Snapshot& snapshot)
+{
+    return (snapshot.magic.load(std::memory_order_acquire) == MAGIC) &&
+           (snapshot.version == VERSION) &&
+           (snapshot.size == sizeof(Snapshot));
+}
+
+/** @class Reader
+ *  @brief Reads the state snapshot the managers publish
+ *  @details Maps the file read only. Reads never block a writer, they retry
+ *  if one was writing and give up after a few tries. Anything unavailable
+ *  comes back as std::nullopt and the caller should fall back to D-Bus.
+ */
+class Reader
+{
+  public:
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    Reader(Reader&&) = delete;
+    Reader& operator=(Reader&&) = delete;
+
+    /** @brief Map the snapshot
+     *
+     * @param[in] path - The snapshot file, usually STATE_SNAPSHOT_FILE
+     */
+    explicit Reader(const char* path)
+    {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+
+        struct stat st;
+        if ((fstat(fd, &st) == 0) &&
+            (static_cast<std::size_t>(st.st_size) == sizeof(Snapshot)))
+        {
+            auto addr = mmap(nullptr, sizeof(Snapshot), PROT_READ, MAP_SHARED,
+                             fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                snapshot = static_cast<const Snapshot*>(addr);
+            }
+        }
+        close(fd);
+    }
+
+    ~Reader()
+    {
+        if (snapshot != nullptr)
+        {
+            munmap(const_cast<Snapshot*>(snapshot), sizeof(Snapshot));
+        }
+    }
+
+    /** @brief Return true if the file is a snapshot of this version */
+    bool valid() const
+    {
+        return (snapshot != nullptr) && validHeader(*snapshot);
+    }
+
+    /** @brief Read a consistent copy of one manager's values
+     *
+     * @param[in] section - The section, e.g. &Snapshot::host
+     *
+     * @return The values, std::nullopt if they aren't available
+     */
+    template <std::size_t N>
+    std::optional<std::array<std::string, N>>
+        read(Section<N> Snapshot::*section) const
+    {
+        if (!valid())
+        {
+            return std::nullopt;
+        }
+
+        const auto& s = snapshot->*section;
+        for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++)
+        {
+            auto begin = s.sequence.load(std::memory_order_acquire);
+            if (begin == 0)
+            {
+                return std::nullopt;
+            }
+            if (begin & 1)
+            {
+                continue;
+            }
+
+            std::array<Value, N> values;
+            std::memcpy(values.data(), s.values.data(), sizeof(values));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.sequence.load(std::memory_order_relaxed) != begin)
+            {
+                continue;
+            }
+
+            std::array<std::string, N> strings;
+            for (std::size_t i = 0; i < N; i++)
+            {
+                strings[i].assign(values[i].data(),
+                                  strnlen(values[i].data(), VALUE_MAX));
+            }
+            return strings;
+        }
+        return std::nullopt;
+    }
+
+    /** @brief Read a single value
+     *
+     * @param[in] section - The section, e.g. &Snapshot::host
+     * @param[in] index   - The value, e.g. BootProgress
+     *
+     * @return The value, std::nullopt if it isn't available
+     */
+    template <std::size_t N>
+    std::optional<std::string> value(Section<N> Snapshot::*section,
+                                     std::size_t index) const
+    {
+        auto values = read(section);
+        if (!values || (index >= N) || (*values)[index].empty())
+        {
+            return std::nullopt;
+        }
+        return std::move((*values)[index]);
+    }
+
+  private:
+    /** @brief Give up after this many torn reads */
+    static constexpr int READ_ATTEMPTS = 100;
+
+    /** @brief The mapped snapshot, nullptr if it couldn't be mapped */
+    const Snapshot* snapshot = nullptr;
+};
+
+/** @class Writer
+ *  @brief Publishes one manager's section of the state snapshot
+ *  @details Creates the file if needed, replacing one of another version.
+ *  Publishing is best effort, a manager that can't map the file carries on
+ *  without it and readers fall back to D-Bus.
+ */
+class Writer
+{
+  public:
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    Writer(Writer&&) = delete;
+    Writer& operator=(Writer&&) = delete;
+
+    /** @brief Map the snapshot, creating it if needed
+     *
+     * @param[in] path - The snapshot file, usually STATE_SNAPSHOT_FILE
+     */
+    explicit Writer(const char* path);
+
+    ~Writer();
+
+    /** @brief Publish new values for a section
+     *
+     * @param[in] section - The section this manager owns
+     * @param[in] values  - Its values, truncated to VALUE_MAX - 1
+     */
+    template <std::size_t N>
+    void publish(Section<N> Snapshot::*section,
+                 const std::array<std::string_view, N>& values)
+    {
+        if (snapshot == nullptr)
+        {
+            return;
+        }
+
+        auto& s = snapshot->*section;
+
+        // Left odd if the last owner died mid write
+        auto sequence = s.sequence.load(std::memory_order_relaxed);
+        sequence += sequence & 1;
+
+        s.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (std::size_t i = 0; i < N; i++)
+        {
+            auto size = std::min(values[i].size(), VALUE_MAX - 1);
+            std::memcpy(s.values[i].data(), values[i].data(), size);
+            std::memset(s.values[i].data() + size, 0, VALUE_MAX - size);
+        }
+
+        s.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+  private:
+    /** @brief The mapped snapshot, nullptr if it couldn't be mapped */
+    Snapshot* snapshot = nullptr;
+};
+
+} // namespace snapshot
+} // namespace manager
+} // namespace state
+} // namespace phosphor
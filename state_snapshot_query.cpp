@@ -0,0 +1,68 @@
+#include "config.h"
+
+#include "state_snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+
+/* Prints one value from the state snapshot, for scripts like obmcutil that
+ * would otherwise ask D-Bus. Exits non-zero if the value isn't available,
+ * and the caller should fall back to D-Bus.
+ */
+int main(int argc, char** argv)
+{
+    namespace snapshot = phosphor::state::manager::snapshot;
+
+    if (argc != 2)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s bmcstate|chassisstate|hoststate|"
+                     "bootprogress|osstate\n",
+                     argv[0]);
+        return 2;
+    }
+
+    snapshot::Reader reader{STATE_SNAPSHOT_FILE};
+    std::optional<std::string> value;
+
+    if (std::strcmp(argv[1], "bmcstate") == 0)
+    {
+        value = reader.value(&snapshot::Snapshot::bmc,
+                             snapshot::CurrentBMCState);
+    }
+    else if (std::strcmp(argv[1], "chassisstate") == 0)
+    {
+        value = reader.value(&snapshot::Snapshot::chassis,
+                             snapshot::CurrentPowerState);
+    }
+    else if (std::strcmp(argv[1], "hoststate") == 0)
+    {
+        value = reader.value(&snapshot::Snapshot::host,
+                             snapshot::CurrentHostState);
+    }
+    else if (std::strcmp(argv[1], "bootprogress") == 0)
+    {
+        value = reader.value(&snapshot::Snapshot::host,
+                             snapshot::BootProgress);
+    }
+    else if (std::strcmp(argv[1], "osstate") == 0)
+    {
+        value = reader.value(&snapshot::Snapshot::host,
+                             snapshot::OperatingSystemState);
+    }
+    else
+    {
+        std::fprintf(stderr, "Unknown value %s\n", argv[1]);
+        return 2;
+    }
+
+    if (!value)
+    {
+        return 1;
+    }
+
+    std::printf("%s\n", value->c_str());
+    return 0;
+}
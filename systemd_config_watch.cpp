@@ -0,0 +1,157 @@
+#include "systemd_config_watch.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <array>
+#include <chrono>
+#include <system_error>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+PHOSPHOR_LOG2_USING;
+
+// Editors and package managers usually replace a file by writing a temporary
+// one and renaming it over the original, so watch the directory rather than
+// the file itself
+constexpr uint32_t WATCH_MASK =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM;
+
+SystemdConfigWatch::SystemdConfigWatch(
+    const sdeventplus::Event& event,
+    const std::vector<std::string>& targetFilePaths,
+    const std::vector<std::string>& serviceFilePaths,
+    SystemdTargetLogging& targetMon) :
+    targetFilePaths(targetFilePaths),
+    serviceFilePaths(serviceFilePaths), targetMon(targetMon)
+{
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd == -1)
+    {
+        auto eno = errno;
+        error("Failed to create inotify fd, errno: {ERRNO}", "ERRNO", eno);
+        throw std::system_error(eno, std::system_category());
+    }
+
+    std::vector<std::string> allFiles{targetFilePaths};
+    allFiles.insert(allFiles.end(), serviceFilePaths.begin(),
+                    serviceFilePaths.end());
+
+    for (const auto& file : allFiles)
+    {
+        auto path = fs::absolute(file).lexically_normal();
+        watchedFiles.insert(path);
+
+        auto dir = path.parent_path();
+        auto wd = inotify_add_watch(inotifyFd, dir.c_str(), WATCH_MASK);
+        if (wd == -1)
+        {
+            // Not fatal, the files were already parsed. They just won't be
+            // reloaded on change.
+            auto eno = errno;
+            error("Failed to watch {DIR} for changes, errno: {ERRNO}", "DIR",
+                  dir.string(), "ERRNO", eno);
+            continue;
+        }
+        watchedDirs.emplace(wd, dir);
+    }
+
+    ioSource = std::make_unique<sdeventplus::source::IO>(
+        event, inotifyFd, EPOLLIN,
+        [this](sdeventplus::source::IO&, int fd, uint32_t) {
+            processEvents(fd);
+        });
+}
+
+SystemdConfigWatch::~SystemdConfigWatch()
+{
+    ioSource.reset();
+    close(inotifyFd);
+}
+
+void SystemdConfigWatch::processEvents(int fd)
+{
+    alignas(inotify_event) std::array<char, 4096> buf;
+    bool changed = false;
+
+    while (true)
+    {
+        auto len = read(fd, buf.data(), buf.size());
+        if (len <= 0)
+        {
+            break;
+        }
+
+        for (auto ptr = buf.data(); ptr < buf.data() + len;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            auto dir = watchedDirs.find(event->wd);
+            if ((dir == watchedDirs.end()) || (event->len == 0))
+            {
+                continue;
+            }
+
+            if (watchedFiles.contains(dir->second / event->name))
+            {
+                changed = true;
+            }
+        }
+    }
+
+    if (changed)
+    {
+        reload();
+    }
+}
+
+void SystemdConfigWatch::reload()
+{
+    using namespace std::chrono;
+
+    auto start = steady_clock::now();
+
+    std::shared_ptr<const TargetErrorData> targetData;
+    std::shared_ptr<const ServiceMonitorData> serviceData;
+    try
+    {
+        targetData =
+            std::make_shared<const TargetErrorData>(parseFiles(targetFilePaths));
+        serviceData = std::make_shared<const ServiceMonitorData>(
+            serviceFilePaths.empty() ? ServiceMonitorData{}
+                                     : parseServiceFiles(serviceFilePaths));
+    }
+    catch (const std::exception& e)
+    {
+        // A file may be caught halfway through being replaced, another event
+        // will follow once it is complete
+        error("Failed to reload monitor config, keeping current: {ERROR}",
+              "ERROR", e);
+        return;
+    }
+
+    if (targetData->empty())
+    {
+        error("Reloaded monitor config has no targets, keeping current");
+        return;
+    }
+
+    targetMon.updateMonitorData(std::move(targetData), std::move(serviceData));
+    reloadCount++;
+
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+    info("Reloaded monitor config, reload count:{COUNT}, took {DURATION_US}us",
+         "COUNT", reloadCount, "DURATION_US", elapsed.count());
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "systemd_target_signal.hpp"
+
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/io.hpp>
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+namespace fs = std::filesystem;
+
+/** @class SystemdConfigWatch
+ *  @brief Reload the target and service monitor json files on change
+ *  @details Watches the directories holding the input json files with
+ *  inotify. When one of the files is written, moved into place or removed,
+ *  all of the files are parsed again and the resulting tables are handed
+ *  to SystemdTargetLogging. If the files fail to parse, the tables that are
+ *  currently in use are kept.
+ */
+class SystemdConfigWatch
+{
+  public:
+    SystemdConfigWatch() = delete;
+    SystemdConfigWatch(const SystemdConfigWatch&) = delete;
+    SystemdConfigWatch& operator=(const SystemdConfigWatch&) = delete;
+    SystemdConfigWatch(SystemdConfigWatch&&) = delete;
+    SystemdConfigWatch& operator=(SystemdConfigWatch&&) = delete;
+    ~SystemdConfigWatch();
+
+    /** @brief Constructs the configuration watcher
+     *
+     * @param[in] event            - The sd_event loop to watch from
+     * @param[in] targetFilePaths  - The json files with target/error mappings
+     * @param[in] serviceFilePaths - The json files with services to monitor
+     * @param[in] targetMon        - The monitor to hand new tables to
+     */
+    SystemdConfigWatch(const sdeventplus::Event& event,
+                       const std::vector<std::string>& targetFilePaths,
+                       const std::vector<std::string>& serviceFilePaths,
+                       SystemdTargetLogging& targetMon);
+
+  private:
+    /** @brief Read the pending inotify events and reload if needed
+     *
+     * @param[in] fd - The inotify file descriptor
+     */
+    void processEvents(int fd);
+
+    /** @brief Parse all input files and update the monitor tables */
+    void reload();
+
+    /** @brief The json files with target/error mappings */
+    const std::vector<std::string> targetFilePaths;
+
+    /** @brief The json files with services to monitor */
+    const std::vector<std::string> serviceFilePaths;
+
+    /** @brief The monitor using the parsed tables */
+    SystemdTargetLogging& targetMon;
+
+    /** @brief All input files, used to filter directory events */
+    std::set<fs::path> watchedFiles;
+
+    /** @brief Map of inotify watch descriptor to the directory it watches */
+    std::map<int, fs::path> watchedDirs;
+
+    /** @brief The inotify file descriptor */
+    int inotifyFd = -1;
+
+    /** @brief Event source for the inotify file descriptor */
+    std::unique_ptr<sdeventplus::source::IO> ioSource;
+
+    /** @brief Number of successful reloads since startup */
+    uint32_t reloadCount = 0;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -1,3 +1,6 @@
+#include "config.h"
+
+#include "systemd_config_watch.hpp"
 #include "systemd_service_parser.hpp"
 #include "systemd_target_parser.hpp"
 #include "systemd_target_signal.hpp"
@@ -5,6 +8,7 @@
 #include <CLI/CLI.hpp>
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/manager.hpp>
 #include <sdeventplus/event.hpp>
 
 #include <iostream>
@@ -19,7 +23,12 @@ void dump_targets(const TargetErrorData& targetData)
     std::cout << "## Data Structure of Json ##" << std::endl;
     for (const auto& [target, value] : targetData)
     {
-        std::cout << target << " " << value.errorToLog << std::endl;
+        std::cout << target << " " << value.errorToLog;
+        if (value.maxDurationMs)
+        {
+            std::cout << " maxDurationMs:" << value.maxDurationMs;
+        }
+        std::cout << std::endl;
         std::cout << "    ";
         for (auto& eToMonitor : value.errorsToMonitor)
         {
@@ -85,11 +94,21 @@ int main(int argc, char* argv[])
         dump_targets(targetData);
     }
 
+    // Add sdbusplus ObjectManager for the per-unit statistics objects
+    sdbusplus::server::manager::manager objManager(bus, TARGET_MONITOR_OBJPATH);
+
     phosphor::state::manager::SystemdTargetLogging targetMon(targetData,
                                                              serviceData, bus);
 
     // Subscribe to systemd D-bus signals indicating target completions
     targetMon.subscribeToSystemdSignals();
 
+    // Pick up changes to the input files without restarting, which would
+    // otherwise miss any failures that happen while we're down
+    phosphor::state::manager::SystemdConfigWatch configWatch(
+        event, targetFilePaths, serviceFilePaths, targetMon);
+
+    bus.request_name(TARGET_MONITOR_BUSNAME);
+
     return event.loop();
 }
@@ -1,12 +1,28 @@
 #include "systemd_target_parser.hpp"
 
-#include <cassert>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+
+// Return a field every target must have, a reload must not be able to take
+// the monitor down so anything missing is thrown like any other bad input
+static const json& getRequired(const json& target, const std::string& name,
+                               const char* field)
+{
+    auto value = target.find(field);
+    if (value == target.end())
+    {
+        throw std::invalid_argument(name + " is missing " + field);
+    }
+    return *value;
+}
 
 void validateErrorsToMonitor(std::vector<std::string>& errorsToMonitor)
 {
-    assert(errorsToMonitor.size());
+    if (errorsToMonitor.empty())
+    {
+        throw std::invalid_argument("No errors to monitor");
+    }
 
     const std::vector<std::string> validErrorsToMonitor = {
         "default", "timeout", "failed", "dependency"};
@@ -49,7 +65,13 @@ TargetErrorData parseFiles(const std::vector<std::string>& filePaths)
         std::ifstream fileStream(jsonFile);
         auto j = json::parse(fileStream);
 
-        for (auto it = j["targets"].begin(); it != j["targets"].end(); ++it)
+        const auto& targets = j.at("targets");
+        if (!targets.is_object())
+        {
+            throw std::invalid_argument("targets must be an object");
+        }
+
+        for (auto it = targets.begin(); it != targets.end(); ++it)
         {
             targetEntry entry;
             if (gVerbose)
@@ -60,14 +82,33 @@ TargetErrorData parseFiles(const std::vector<std::string>& filePaths)
 
             // Be unforgiving on invalid json files. Just throw or allow
             // nlohmann to throw an exception if something is off
-            auto errorsToMonitor = it.value().find("errorsToMonitor");
+            if (!it.value().is_object())
+            {
+                throw std::invalid_argument(it.key() + " must be an object");
+            }
+
             entry.errorsToMonitor =
-                errorsToMonitor->get<std::vector<std::string>>();
+                getRequired(it.value(), it.key(), "errorsToMonitor")
+                    .get<std::vector<std::string>>();
 
             validateErrorsToMonitor(entry.errorsToMonitor);
 
-            auto errorToLog = it.value().find("errorToLog");
-            entry.errorToLog = errorToLog->get<std::string>();
+            entry.errorToLog = getRequired(it.value(), it.key(), "errorToLog")
+                                   .get<std::string>();
+
+            // The activation time budget is optional
+            auto maxDuration = it.value().find("maxDurationMs");
+            if (maxDuration != it.value().end())
+            {
+                entry.maxDurationMs = maxDuration->get<uint64_t>();
+            }
+
+            auto durationErrorToLog = it.value().find("durationErrorToLog");
+            if (durationErrorToLog != it.value().end())
+            {
+                entry.durationErrorToLog =
+                    durationErrorToLog->get<std::string>();
+            }
 
             systemdTargetMap[it.key()] = entry;
         }
@@ -11,6 +11,10 @@ struct targetEntry
 {
     std::string errorToLog;
     std::vector<std::string> errorsToMonitor;
+    /** @brief Activation time budget, 0 if the target has none */
+    uint64_t maxDurationMs = 0;
+    /** @brief Error to log when the budget is exceeded, if different */
+    std::string durationErrorToLog;
 };
 
 /** @brief A map of the systemd target to its corresponding targetEntry*/
@@ -63,19 +63,21 @@ void SystemdTargetLogging::startBmcQuiesceTarget()
     return;
 }
 
-void SystemdTargetLogging::logError(const std::string& errorLog,
-                                    const std::string& result,
-                                    const std::string& unit)
+void SystemdTargetLogging::logError(
+    const std::string& errorLog, const std::string& result,
+    const std::string& unit,
+    const std::map<std::string, std::string>& extraData)
 {
     auto method = this->bus.new_method_call(
         "xyz.openbmc_project.Logging", "/xyz/openbmc_project/logging",
         "xyz.openbmc_project.Logging.Create", "Create");
     // Signature is ssa{ss}
+    std::map<std::string, std::string> additionalData{extraData};
+    additionalData.emplace("SYSTEMD_RESULT", result);
+    additionalData.emplace("SYSTEMD_UNIT", unit);
     method.append(errorLog);
     method.append("xyz.openbmc_project.Logging.Entry.Level.Critical");
-    method.append(std::array<std::pair<std::string, std::string>, 2>(
-        {std::pair<std::string, std::string>({"SYSTEMD_RESULT", result}),
-         std::pair<std::string, std::string>({"SYSTEMD_UNIT", unit})}));
+    method.append(additionalData);
     try
     {
         this->bus.call_noreply(method);
@@ -91,8 +93,13 @@ void SystemdTargetLogging::logError(const std::string& errorLog,
 const std::string SystemdTargetLogging::processError(const std::string& unit,
                                                      const std::string& result)
 {
-    auto targetEntry = this->targetData.find(unit);
-    if (targetEntry != this->targetData.end())
+    // Hold a reference to the current tables so a configuration reload
+    // while processing this unit can't free them underneath us
+    auto targets = this->targetData;
+    auto services = this->serviceData;
+
+    auto targetEntry = targets->find(unit);
+    if (targetEntry != targets->end())
     {
         // Check if its result matches any of our monitored errors
         if (std::find(targetEntry->second.errorsToMonitor.begin(),
@@ -110,8 +117,7 @@ const std::string SystemdTargetLogging::processError(const std::string& unit,
     }
 
     // Check if it's in our list of services to monitor
-    if (std::find(this->serviceData.begin(), this->serviceData.end(), unit) !=
-        this->serviceData.end())
+    if (std::find(services->begin(), services->end(), unit) != services->end())
     {
         if (result == "failed")
         {
@@ -131,6 +137,94 @@ const std::string SystemdTargetLogging::processError(const std::string& unit,
     return (std::string{});
 }
 
+void SystemdTargetLogging::updateMonitorData(
+    std::shared_ptr<const TargetErrorData> newTargetData,
+    std::shared_ptr<const ServiceMonitorData> newServiceData)
+{
+    this->targetData = std::move(newTargetData);
+    this->serviceData = std::move(newServiceData);
+}
+
+bool SystemdTargetLogging::isMonitored(const std::string& unit)
+{
+    auto services = this->serviceData;
+    return this->targetData->contains(unit) ||
+           (std::find(services->begin(), services->end(), unit) !=
+            services->end());
+}
+
+UnitStats& SystemdTargetLogging::getUnitStats(const std::string& unit)
+{
+    auto& stats = this->unitStats[unit];
+    if (!stats)
+    {
+        stats = std::make_unique<UnitStats>(this->bus, unit);
+    }
+    return *stats;
+}
+
+void SystemdTargetLogging::processJobDuration(uint32_t id,
+                                              const std::string& unit,
+                                              const std::string& result)
+{
+    using namespace std::chrono;
+
+    auto job = this->pendingJobs.find(unit);
+    if ((job == this->pendingJobs.end()) || (job->second.first != id))
+    {
+        return;
+    }
+
+    auto durationMs = static_cast<uint64_t>(
+        duration_cast<milliseconds>(steady_clock::now() - job->second.second)
+            .count());
+    this->pendingJobs.erase(job);
+
+    // Only successful activations count, failures are handled on their own
+    if (result != "done")
+    {
+        return;
+    }
+
+    uint64_t maxDurationMs = 0;
+    std::string errorToLog;
+    auto targets = this->targetData;
+    auto targetEntry = targets->find(unit);
+    if (targetEntry != targets->end())
+    {
+        maxDurationMs = targetEntry->second.maxDurationMs;
+        errorToLog = targetEntry->second.durationErrorToLog.empty()
+                         ? targetEntry->second.errorToLog
+                         : targetEntry->second.durationErrorToLog;
+    }
+
+    if (getUnitStats(unit).addActivation(durationMs, maxDurationMs))
+    {
+        info("Monitored systemd unit exceeded its activation time, "
+             "unit:{UNIT}, duration:{DURATION_MS}ms, max:{MAX_DURATION_MS}ms",
+             "UNIT", unit, "DURATION_MS", durationMs, "MAX_DURATION_MS",
+             maxDurationMs);
+        logError(errorToLog, result, unit,
+                 {{"DURATION_MS", std::to_string(durationMs)},
+                  {"MAX_DURATION_MS", std::to_string(maxDurationMs)}});
+    }
+}
+
+void SystemdTargetLogging::systemdJobNew(sdbusplus::message::message& msg)
+{
+    uint32_t id;
+    sdbusplus::message::object_path objPath;
+    std::string unit{};
+
+    msg.read(id, objPath, unit);
+
+    if (isMonitored(unit))
+    {
+        // A new job for the unit replaces any we didn't see complete
+        this->pendingJobs[unit] = {id, std::chrono::steady_clock::now()};
+    }
+}
+
 void SystemdTargetLogging::systemdUnitChange(sdbusplus::message::message& msg)
 {
     uint32_t id;
@@ -140,6 +234,13 @@ void SystemdTargetLogging::systemdUnitChange(sdbusplus::message::message& msg)
 
     msg.read(id, objPath, unit, result);
 
+    if (isMonitored(unit))
+    {
+        getUnitStats(unit).addResult(result);
+    }
+
+    processJobDuration(id, unit, result);
+
     // In most cases it will just be success, in which case just return
     if (result != "done")
     {
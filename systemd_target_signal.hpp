@@ -2,10 +2,15 @@
 
 #include "systemd_service_parser.hpp"
 #include "systemd_target_parser.hpp"
+#include "systemd_target_stats.hpp"
 
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/bus/match.hpp>
 
+#include <chrono>
+#include <map>
+#include <memory>
+
 extern bool gVerbose;
 
 namespace phosphor
@@ -31,8 +36,9 @@ class SystemdTargetLogging
     SystemdTargetLogging(const TargetErrorData& targetData,
                          const ServiceMonitorData& serviceData,
                          sdbusplus::bus::bus& bus) :
-        targetData(targetData),
-        serviceData(serviceData), bus(bus),
+        targetData(std::make_shared<const TargetErrorData>(targetData)),
+        serviceData(std::make_shared<const ServiceMonitorData>(serviceData)),
+        bus(bus),
         systemdJobRemovedSignal(
             bus,
             sdbusplus::bus::match::rules::type::signal() +
@@ -43,6 +49,16 @@ class SystemdTargetLogging
                     "org.freedesktop.systemd1.Manager"),
             std::bind(std::mem_fn(&SystemdTargetLogging::systemdUnitChange),
                       this, std::placeholders::_1)),
+        systemdJobNewSignal(
+            bus,
+            sdbusplus::bus::match::rules::type::signal() +
+                sdbusplus::bus::match::rules::member("JobNew") +
+                sdbusplus::bus::match::rules::path(
+                    "/org/freedesktop/systemd1") +
+                sdbusplus::bus::match::rules::interface(
+                    "org.freedesktop.systemd1.Manager"),
+            std::bind(std::mem_fn(&SystemdTargetLogging::systemdJobNew), this,
+                      std::placeholders::_1)),
         systemdNameOwnedChangedSignal(
             bus, sdbusplus::bus::match::rules::nameOwnerChanged(),
             std::bind(
@@ -71,6 +87,19 @@ class SystemdTargetLogging
     const std::string processError(const std::string& unit,
                                    const std::string& result);
 
+    /** @brief Replace the targets and services being monitored
+     *
+     * The new tables are used for every signal processed after this call.
+     * The systemd subscription and the signal matches are left untouched so
+     * no JobRemoved signal is missed while the configuration changes.
+     *
+     * @param[in]  newTargetData  - Newly parsed target/error mappings
+     * @param[in]  newServiceData - Newly parsed services to monitor
+     */
+    void updateMonitorData(
+        std::shared_ptr<const TargetErrorData> newTargetData,
+        std::shared_ptr<const ServiceMonitorData> newServiceData);
+
   private:
     /** @brief Call phosphor-dump-manager to create BMC dump */
     void createBmcDump();
@@ -83,9 +112,46 @@ class SystemdTargetLogging
      * @param[in]  error      - The error to log
      * @param[in]  result     - The failure code from the systemd unit
      * @param[in]  unit       - The name of the failed unit
+     * @param[in]  extraData  - Additional data to add to the log
      */
     void logError(const std::string& error, const std::string& result,
-                  const std::string& unit);
+                  const std::string& unit,
+                  const std::map<std::string, std::string>& extraData = {});
+
+    /** @brief Check if unit is one to monitor
+     *
+     * @param[in]  unit       - The systemd unit
+     *
+     * @return true if the unit is a monitored target or service
+     */
+    bool isMonitored(const std::string& unit);
+
+    /** @brief Return the statistics of a unit, creating them if needed
+     *
+     * @param[in]  unit       - The systemd unit
+     *
+     * @return The unit's statistics object
+     */
+    UnitStats& getUnitStats(const std::string& unit);
+
+    /** @brief Record the activation time of a completed job
+     *
+     * Logs an error if the unit has an activation time budget and the job
+     * took longer than it.
+     *
+     * @param[in]  id         - The systemd job id
+     * @param[in]  unit       - The systemd unit
+     * @param[in]  result     - The result of the job
+     */
+    void processJobDuration(uint32_t id, const std::string& unit,
+                            const std::string& result);
+
+    /** @brief Note the start of a job for a monitored unit
+     *
+     * @param[in]  msg       - Data associated with subscribed signal
+     *
+     */
+    void systemdJobNew(sdbusplus::message::message& msg);
 
     /** @brief Check if systemd state change is one to monitor
      *
@@ -108,10 +174,10 @@ class SystemdTargetLogging
     void processNameChangeSignal(sdbusplus::message::message& msg);
 
     /** @brief Systemd targets to monitor and error logs to create */
-    const TargetErrorData& targetData;
+    std::shared_ptr<const TargetErrorData> targetData;
 
-    /** @brief Systemd targets to monitor and error logs to create */
-    const ServiceMonitorData& serviceData;
+    /** @brief Systemd services to monitor for failures */
+    std::shared_ptr<const ServiceMonitorData> serviceData;
 
     /** @brief Persistent sdbusplus DBus bus connection. */
     sdbusplus::bus::bus& bus;
@@ -119,6 +185,17 @@ class SystemdTargetLogging
     /** @brief Used to subscribe to dbus systemd JobRemoved signals **/
     sdbusplus::bus::match_t systemdJobRemovedSignal;
 
+    /** @brief Used to subscribe to dbus systemd JobNew signals **/
+    sdbusplus::bus::match_t systemdJobNewSignal;
+
+    /** @brief Map of unit to its pending job id and when it was queued */
+    std::map<std::string,
+             std::pair<uint32_t, std::chrono::steady_clock::time_point>>
+        pendingJobs;
+
+    /** @brief Statistics of the monitored units which have run a job */
+    std::map<std::string, std::unique_ptr<UnitStats>> unitStats;
+
     /** @brief Used to know when systemd has registered on dbus **/
     sdbusplus::bus::match_t systemdNameOwnedChangedSignal;
 };
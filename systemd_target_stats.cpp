@@ -0,0 +1,177 @@
+#include "config.h"
+
+#include "systemd_target_stats.hpp"
+
+#include <sdbusplus/message/native_types.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+constexpr auto ACTIVATION_INTERFACE =
+    "xyz.openbmc_project.State.Monitor.UnitActivation";
+constexpr auto RESULTS_INTERFACE =
+    "xyz.openbmc_project.State.Monitor.UnitResults";
+
+void DurationWindow::add(uint64_t durationMs)
+{
+    samples[total % maxSamples] = durationMs;
+    total++;
+}
+
+uint64_t DurationWindow::percentile(unsigned pct) const
+{
+    auto valid = static_cast<size_t>(std::min<uint64_t>(total, maxSamples));
+    if (valid == 0)
+    {
+        return 0;
+    }
+
+    std::vector<uint64_t> sorted(samples.begin(), samples.begin() + valid);
+
+    // Nearest-rank: the smallest sample with at least pct% of the samples
+    // less than or equal to it
+    auto rank = (std::min(pct, 100u) * valid + 99) / 100;
+    auto index = (rank == 0) ? 0 : rank - 1;
+
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+uint64_t DurationWindow::last() const
+{
+    if (total == 0)
+    {
+        return 0;
+    }
+    return samples[(total - 1) % maxSamples];
+}
+
+UnitStats::UnitStats(sdbusplus::bus::bus& bus, const std::string& unit) :
+    activationIntf(
+        bus,
+        (sdbusplus::message::object_path(TARGET_MONITOR_OBJPATH) / unit).str,
+        ACTIVATION_INTERFACE),
+    resultsIntf(
+        bus,
+        (sdbusplus::message::object_path(TARGET_MONITOR_OBJPATH) / unit).str,
+        RESULTS_INTERFACE)
+{
+    activationIntf.addProperty<uint64_t>(
+        "LastDurationMs", [this]() { return durations.last(); });
+    activationIntf.addProperty<uint64_t>(
+        "P50DurationMs", [this]() { return durations.percentile(50); });
+    activationIntf.addProperty<uint64_t>(
+        "P99DurationMs", [this]() { return durations.percentile(99); });
+    activationIntf.addProperty<uint64_t>("MaxDurationMs",
+                                         [this]() { return maxDurationMs; });
+    activationIntf.addProperty<uint64_t>(
+        "Activations", [this]() { return durations.count(); });
+    activationIntf.addProperty<uint64_t>("ExceededCount",
+                                         [this]() { return exceededCount; });
+    activationIntf.emitAdded();
+
+    for (size_t i = 0; i < countedResults.size(); i++)
+    {
+        std::string name{countedResults[i].name};
+        auto& counter = results[i];
+
+        resultsIntf.addProperty<uint64_t>(name + "Count", [&counter]() {
+            return counter.count.load(std::memory_order_relaxed);
+        });
+        resultsIntf.addProperty<uint64_t>("Last" + name + "Time", [&counter]() {
+            return counter.lastTime.load(std::memory_order_relaxed);
+        });
+    }
+    resultsIntf.addProperty<uint64_t>("OtherCount", [this]() {
+        return otherCount.load(std::memory_order_relaxed);
+    });
+    resultsIntf.addProperty<double>("FailureRate",
+                                    [this]() { return failureRate(); });
+    resultsIntf.emitAdded();
+}
+
+void UnitStats::addResult(const std::string& result)
+{
+    using namespace std::chrono;
+
+    auto it = std::find_if(
+        countedResults.begin(), countedResults.end(),
+        [&result](const auto& entry) { return entry.result == result; });
+    if (it == countedResults.end())
+    {
+        otherCount.fetch_add(1, std::memory_order_relaxed);
+        resultsIntf.propertyChanged("OtherCount");
+        resultsIntf.propertyChanged("FailureRate");
+        return;
+    }
+
+    auto now = duration_cast<milliseconds>(
+                   system_clock::now().time_since_epoch())
+                   .count();
+
+    auto& counter = results[std::distance(countedResults.begin(), it)];
+    counter.count.fetch_add(1, std::memory_order_relaxed);
+    counter.lastTime.store(now, std::memory_order_relaxed);
+
+    std::string name{it->name};
+    resultsIntf.propertyChanged(name + "Count");
+    resultsIntf.propertyChanged("Last" + name + "Time");
+    resultsIntf.propertyChanged("FailureRate");
+}
+
+double UnitStats::failureRate() const
+{
+    uint64_t total = otherCount.load(std::memory_order_relaxed);
+    uint64_t failures = 0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        auto count = results[i].count.load(std::memory_order_relaxed);
+        total += count;
+        if (countedResults[i].failure)
+        {
+            failures += count;
+        }
+    }
+
+    if (total == 0)
+    {
+        return 0.0;
+    }
+
+    return static_cast<double>(failures) / static_cast<double>(total);
+}
+
+bool UnitStats::addActivation(uint64_t durationMs, uint64_t maxDurationMs)
+{
+    durations.add(durationMs);
+    if (this->maxDurationMs != maxDurationMs)
+    {
+        this->maxDurationMs = maxDurationMs;
+        activationIntf.propertyChanged("MaxDurationMs");
+    }
+
+    bool exceeded = (maxDurationMs != 0) && (durationMs > maxDurationMs);
+    if (exceeded)
+    {
+        exceededCount++;
+        activationIntf.propertyChanged("ExceededCount");
+    }
+
+    activationIntf.propertyChanged("LastDurationMs");
+    activationIntf.propertyChanged("P50DurationMs");
+    activationIntf.propertyChanged("P99DurationMs");
+    activationIntf.propertyChanged("Activations");
+    return exceeded;
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
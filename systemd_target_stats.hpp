@@ -0,0 +1,160 @@
+#pragma once
+
+#include "property_interface.hpp"
+
+#include <sdbusplus/bus.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @class DurationWindow
+ *  @brief Rolling window of the most recent unit activation durations
+ */
+class DurationWindow
+{
+  public:
+    /** @brief Number of samples kept for the percentile calculations */
+    static constexpr size_t maxSamples = 64;
+
+    /** @brief Add a sample, dropping the oldest once the window is full
+     *
+     * @param[in] durationMs - The activation duration in milliseconds
+     */
+    void add(uint64_t durationMs);
+
+    /** @brief Return the nearest-rank percentile of the samples
+     *
+     * @param[in] pct - The percentile to return, 0 to 100
+     *
+     * @return The percentile in milliseconds, 0 if there are no samples
+     */
+    uint64_t percentile(unsigned pct) const;
+
+    /** @brief Return the most recent sample, 0 if there are none */
+    uint64_t last() const;
+
+    /** @brief Return the total number of samples ever added */
+    uint64_t count() const
+    {
+        return total;
+    }
+
+  private:
+    /** @brief Ring buffer of samples */
+    std::array<uint64_t, maxSamples> samples{};
+
+    /** @brief Total number of samples added */
+    uint64_t total = 0;
+};
+
+/** @brief A job result counted per unit */
+struct CountedResult
+{
+    /** @brief The JobRemoved result string */
+    std::string_view result;
+    /** @brief The name used on D-Bus */
+    std::string_view name;
+    /** @brief Whether it counts towards the failure rate */
+    bool failure;
+};
+
+/** @brief Job results counted per unit */
+constexpr std::array<CountedResult, 5> countedResults = {
+    {{"done", "Done", false},
+     {"failed", "Failed", true},
+     {"timeout", "Timeout", true},
+     {"dependency", "Dependency", true},
+     {"canceled", "Canceled", false}}};
+
+/** @brief Count of one job result and when it last happened
+ *
+ *  Relaxed atomics so readers never need to take a lock, the counters are
+ *  independent of each other and of the rest of the state.
+ */
+struct ResultCounter
+{
+    std::atomic<uint64_t> count{0};
+    /** @brief Epoch time, in milliseconds, of the last occurrence */
+    std::atomic<uint64_t> lastTime{0};
+};
+
+/** @class UnitStats
+ *  @brief Statistics kept for a single monitored systemd unit
+ *  @details Published on D-Bus under the target monitor's object path
+ *  with the unit name as the leaf.
+ */
+class UnitStats
+{
+  public:
+    UnitStats() = delete;
+    UnitStats(const UnitStats&) = delete;
+    UnitStats& operator=(const UnitStats&) = delete;
+    UnitStats(UnitStats&&) = delete;
+    UnitStats& operator=(UnitStats&&) = delete;
+    ~UnitStats() = default;
+
+    /** @brief Constructs the statistics object and puts it on D-Bus
+     *
+     * @param[in] bus   - The Dbus bus object
+     * @param[in] unit  - The systemd unit name
+     */
+    UnitStats(sdbusplus::bus::bus& bus, const std::string& unit);
+
+    /** @brief Record a successful activation
+     *
+     * @param[in] durationMs    - Time from JobNew to JobRemoved
+     * @param[in] maxDurationMs - The configured budget, 0 if none
+     *
+     * @return true if the duration exceeded the budget
+     */
+    bool addActivation(uint64_t durationMs, uint64_t maxDurationMs);
+
+    /** @brief Count a job result for the unit
+     *
+     * @param[in] result - The JobRemoved result string
+     */
+    void addResult(const std::string& result);
+
+    /** @brief Return the fraction of jobs that ended in a failure result
+     *
+     *  Canceled, skipped and other results count towards the jobs, but
+     *  aren't failures.
+     */
+    double failureRate() const;
+
+  private:
+    /** @brief Counters, indexed the same as countedResults */
+    std::array<ResultCounter, countedResults.size()> results;
+
+    /** @brief Count of results not in countedResults (skipped, etc.) */
+    std::atomic<uint64_t> otherCount{0};
+
+    /** @brief Recent activation durations */
+    DurationWindow durations;
+
+    /** @brief The budget in effect for the last activation */
+    uint64_t maxDurationMs = 0;
+
+    /** @brief Number of activations which exceeded the budget */
+    uint64_t exceededCount = 0;
+
+    /** @brief The activation time D-Bus interface */
+    PropertyInterface activationIntf;
+
+    /** @brief The job result counters D-Bus interface */
+    PropertyInterface resultsIntf;
+};
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
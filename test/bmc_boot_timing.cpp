@@ -0,0 +1,88 @@
+#include "bmc_boot_timing.hpp"
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+using UnitTimes = BootTiming::UnitTimes;
+
+class TestBootTiming : public testing::Test
+{
+  public:
+    BootTiming::UnitTimesMap units;
+
+    std::vector<std::string> chainFrom(const std::string& target)
+    {
+        return BootTiming::findCriticalChain(
+            target,
+            [this](const std::string& unit) -> const std::optional<UnitTimes>& {
+                // Anything not set up is as if systemd didn't have it loaded
+                return units[unit];
+            });
+    }
+};
+
+TEST_F(TestBootTiming, chainFollowsLastActiveDependency)
+{
+    units["multi-user.target"] = UnitTimes{9000, 9000, {"b.service"}};
+    units["b.service"] = UnitTimes{5000, 8000, {"a.service", "c.service"}};
+    units["a.service"] = UnitTimes{1000, 4000, {}};
+    units["c.service"] = UnitTimes{1000, 3000, {}};
+
+    // a became active last of what b waited on
+    EXPECT_EQ(chainFrom("multi-user.target"),
+              (std::vector<std::string>{"multi-user.target", "b.service",
+                                        "a.service"}));
+}
+
+TEST_F(TestBootTiming, chainSkipsWhatWasntWaitedOn)
+{
+    units["target"] = UnitTimes{5000, 6000, {"late.service", "early.service",
+                                             "never.service",
+                                             "unloaded.service"}};
+    // Active after the target started activating, so not waited on
+    units["late.service"] = UnitTimes{4000, 5500, {}};
+    units["early.service"] = UnitTimes{1000, 2000, {}};
+    // Loaded but never active
+    units["never.service"] = UnitTimes{0, 0, {}};
+
+    EXPECT_EQ(chainFrom("target"),
+              (std::vector<std::string>{"target", "early.service"}));
+}
+
+TEST_F(TestBootTiming, chainStopsOnLoopsAndUnloadedTargets)
+{
+    // Dependency loops don't walk forever
+    units["a"] = UnitTimes{3000, 3000, {"b"}};
+    units["b"] = UnitTimes{2000, 2000, {"a"}};
+    EXPECT_EQ(chainFrom("a"), (std::vector<std::string>{"a", "b"}));
+
+    EXPECT_EQ(chainFrom("missing.target"),
+              (std::vector<std::string>{"missing.target"}));
+}
+
+TEST_F(TestBootTiming, slowestUnitsSortedAndLimited)
+{
+    units["fast.service"] = UnitTimes{1000, 2000, {}};
+    units["slow.service"] = UnitTimes{1000, 501000, {}};
+    units["medium.service"] = UnitTimes{1000, 101000, {}};
+    // Skipped, no activation time to go on
+    units["unloaded.service"] = std::nullopt;
+    units["never.service"] = UnitTimes{0, 0, {}};
+
+    auto slowest = BootTiming::findSlowestUnits(units, 2);
+    ASSERT_EQ(slowest.size(), 2);
+    EXPECT_EQ(slowest[0], std::make_tuple(std::string{"slow.service"}, 500));
+    EXPECT_EQ(slowest[1], std::make_tuple(std::string{"medium.service"}, 100));
+
+    EXPECT_EQ(BootTiming::findSlowestUnits(units, 10).size(), 3);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,118 @@
+#include "event_loop_stats.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace eventloop
+{
+
+using namespace std::chrono_literals;
+
+TEST(TestEventLoopStats, histogramBuckets)
+{
+    Histogram histogram;
+    auto now = Clock::time_point{} + 1h;
+
+    histogram.add(now, 0);
+    histogram.add(now, 8);
+    histogram.add(now, 9);
+    histogram.add(now, 16);
+    histogram.add(now, 17);
+    histogram.add(now, 10000000);
+
+    auto buckets = histogram.buckets(now);
+    ASSERT_EQ(buckets.size(), BUCKETS);
+    EXPECT_EQ(buckets[0], Bucket(8, 2));
+    EXPECT_EQ(buckets[1], Bucket(16, 2));
+    EXPECT_EQ(buckets[2], Bucket(32, 1));
+    EXPECT_EQ(buckets.back(), Bucket(0, 1));
+
+    EXPECT_EQ(histogram.count(now), 6);
+    EXPECT_EQ(histogram.max(now), 10000000);
+    EXPECT_EQ(histogram.percentile(now, 50), 16);
+    EXPECT_EQ(histogram.percentile(now, 99), 0);
+}
+
+TEST(TestEventLoopStats, histogramRolls)
+{
+    Histogram histogram;
+    auto now = Clock::time_point{} + 1h;
+
+    histogram.add(now, 1000);
+    histogram.add(now + WINDOW / 2, 10);
+    EXPECT_EQ(histogram.count(now + WINDOW / 2), 2);
+    EXPECT_EQ(histogram.max(now + WINDOW / 2), 1000);
+
+    // The first sample has aged out, the second hasn't
+    EXPECT_EQ(histogram.count(now + WINDOW), 1);
+    EXPECT_EQ(histogram.max(now + WINDOW), 10);
+
+    // A sample reusing the first one's slot replaces it
+    histogram.add(now + WINDOW, 20);
+    EXPECT_EQ(histogram.count(now + WINDOW), 2);
+
+    EXPECT_EQ(histogram.count(now + (3 * WINDOW)), 0);
+    EXPECT_EQ(histogram.percentile(now + (3 * WINDOW), 99), 0);
+}
+
+TEST(TestEventLoopStats, slowestHandlers)
+{
+    Stats stats;
+    auto now = Clock::time_point{} + 1h;
+
+    stats.handled("host.JobRemoved", 100, now);
+    stats.handled("host.JobRemoved", 300, now);
+    stats.handled("chassis.JobRemoved", 5000, now);
+    for (std::size_t i = 0; i < REPORT_HANDLERS + 5; i++)
+    {
+        stats.handled("handler" + std::to_string(i), 1, now);
+    }
+
+    auto slowest = stats.slowest();
+    ASSERT_EQ(slowest.size(), REPORT_HANDLERS);
+    EXPECT_EQ(slowest[0], HandlerSummary("chassis.JobRemoved", 5000, 1, 5000));
+    EXPECT_EQ(slowest[1], HandlerSummary("host.JobRemoved", 300, 2, 200));
+
+    stats.lagged(40, now);
+    EXPECT_EQ(stats.lagMax(now), 40);
+
+    auto report = stats.report(now);
+    EXPECT_NE(report.find("chassis.JobRemoved max 5000us"), std::string::npos);
+    EXPECT_NE(report.find("Timer lag, last 60s: 1 samples"),
+              std::string::npos);
+
+    stats.reset();
+    EXPECT_TRUE(stats.slowest().empty());
+    EXPECT_EQ(stats.lagMax(now), 0);
+}
+
+TEST(TestEventLoopStats, nestedHandlersCountOnce)
+{
+    stats().reset();
+
+    auto inner = timed("inner", []() { return 1; });
+    auto outer = timed("outer",
+                       [&inner](int value) { return inner() + value; });
+    EXPECT_EQ(outer(1), 2);
+    EXPECT_EQ(inner(), 1);
+
+    auto slowest = stats().slowest();
+    ASSERT_EQ(slowest.size(), 2);
+    for (const auto& [name, maxUs, count, meanUs] : slowest)
+    {
+        EXPECT_EQ(count, 1) << name;
+    }
+}
+
+} // namespace eventloop
+} // namespace manager
+} // namespace state
+} // namespace phosphor
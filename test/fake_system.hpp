@@ -0,0 +1,422 @@
+#pragma once
+
+/* Stand-ins for the services the managers talk to, and a private bus to run
+ * them on, for the benchmarks that run the real managers.
+ */
+#include "property_interface.hpp"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/server/manager.hpp>
+#include <sdeventplus/event.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
+constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
+constexpr auto SYSTEMD_INTERFACE = "org.freedesktop.systemd1.Manager";
+constexpr auto SYSTEMD_INTERFACE_UNIT = "org.freedesktop.systemd1.Unit";
+
+constexpr auto MAPPER_BUSNAME = "xyz.openbmc_project.ObjectMapper";
+constexpr auto MAPPER_PATH = "/xyz/openbmc_project/object_mapper";
+constexpr auto MAPPER_INTERFACE = "xyz.openbmc_project.ObjectMapper";
+
+constexpr auto SETTINGS_BUSNAME = "xyz.openbmc_project.Settings";
+
+constexpr auto HOST_START_TGT = "obmc-host-start@0.target";
+constexpr auto HOST_STARTMIN_TGT = "obmc-host-startmin@0.target";
+constexpr auto HOST_SHUTDOWN_TGT = "obmc-host-shutdown@0.target";
+constexpr auto HOST_STOP_TGT = "obmc-host-stop@0.target";
+constexpr auto HOST_REBOOT_TGT = "obmc-host-reboot@0.target";
+constexpr auto CHASSIS_POWERON_TGT = "obmc-chassis-poweron@0.target";
+constexpr auto CHASSIS_POWEROFF_TGT = "obmc-chassis-poweroff@0.target";
+constexpr auto CHASSIS_HARD_POWEROFF_TGT =
+    "obmc-chassis-hard-poweroff@0.target";
+constexpr auto BMC_STANDBY_TGT = "multi-user.target";
+constexpr auto BMC_REBOOT_TGT = "reboot.target";
+
+/** @brief How often the threads look for the stop flag */
+constexpr auto POLL_INTERVAL = std::chrono::milliseconds{100};
+
+/** @brief A unit a job leaves active or inactive, in the order it happens */
+using UnitChange = std::pair<std::string, bool>;
+
+/** @brief What starting a target does, roughly as the OpenBMC units have
+ *  it. Any other unit just becomes active.
+ */
+inline const std::map<std::string, std::vector<UnitChange>> JOB_TABLE = {
+    {HOST_START_TGT,
+     {{CHASSIS_POWEROFF_TGT, false},
+      {CHASSIS_HARD_POWEROFF_TGT, false},
+      {HOST_STOP_TGT, false},
+      {CHASSIS_POWERON_TGT, true},
+      {HOST_STARTMIN_TGT, true},
+      {HOST_START_TGT, true}}},
+    {HOST_SHUTDOWN_TGT,
+     {{HOST_START_TGT, false},
+      {HOST_STARTMIN_TGT, false},
+      {CHASSIS_POWERON_TGT, false},
+      {HOST_STOP_TGT, true},
+      {CHASSIS_POWEROFF_TGT, true},
+      {HOST_SHUTDOWN_TGT, true}}},
+    {HOST_REBOOT_TGT,
+     {{HOST_START_TGT, false},
+      {HOST_STARTMIN_TGT, false},
+      {CHASSIS_POWERON_TGT, false},
+      {HOST_STOP_TGT, true},
+      {CHASSIS_POWEROFF_TGT, true},
+      {HOST_STOP_TGT, false},
+      {CHASSIS_POWEROFF_TGT, false},
+      {CHASSIS_POWERON_TGT, true},
+      {HOST_STARTMIN_TGT, true},
+      {HOST_START_TGT, true},
+      {HOST_REBOOT_TGT, true}}},
+    {CHASSIS_POWERON_TGT,
+     {{CHASSIS_POWEROFF_TGT, false},
+      {CHASSIS_HARD_POWEROFF_TGT, false},
+      {CHASSIS_POWERON_TGT, true}}},
+    {CHASSIS_HARD_POWEROFF_TGT,
+     {{HOST_START_TGT, false},
+      {HOST_STARTMIN_TGT, false},
+      {CHASSIS_POWERON_TGT, false},
+      {HOST_STOP_TGT, true},
+      {CHASSIS_POWEROFF_TGT, true},
+      {CHASSIS_HARD_POWEROFF_TGT, true}}}};
+
+/** @brief Return the object path systemd gives a unit */
+inline std::string unitPath(const std::string& unit)
+{
+    std::string path{"/org/freedesktop/systemd1/unit/"};
+    for (unsigned char c : unit)
+    {
+        if (std::isalnum(c))
+        {
+            path += static_cast<char>(c);
+        }
+        else
+        {
+            char escaped[4];
+            std::snprintf(escaped, sizeof(escaped), "_%02x", c);
+            path += escaped;
+        }
+    }
+    return path;
+}
+
+/** @brief Return the object path of a job */
+inline std::string jobPath(uint32_t id)
+{
+    return "/org/freedesktop/systemd1/job/" + std::to_string(id);
+}
+
+/** @class FakeSystem
+ *  @brief The parts of systemd, the ObjectMapper and the settings daemon
+ *  the managers use
+ *  @details StartUnit queues the job and runJobs() finishes it after the
+ *  reply has gone out, with a JobRemoved for every unit it activates.
+ */
+class FakeSystem
+{
+  public:
+    FakeSystem(const FakeSystem&) = delete;
+    FakeSystem& operator=(const FakeSystem&) = delete;
+    FakeSystem(FakeSystem&&) = delete;
+    FakeSystem& operator=(FakeSystem&&) = delete;
+
+    explicit FakeSystem(sdbusplus::bus::bus& bus) :
+        bus(bus), systemd(bus, SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE),
+        mapper(bus, MAPPER_PATH, MAPPER_INTERFACE)
+    {
+        systemd.addMethod("Subscribe", "", "", [](auto&, auto&) {});
+        systemd.addMethod("Unsubscribe", "", "", [](auto&, auto&) {});
+        systemd.addMethod("GetUnit", "s", "o", [this](auto& call, auto& reply) {
+            std::string unit;
+            call.read(unit);
+            reply.append(getUnit(unit));
+        });
+        systemd.addMethod("StartUnit", "ss", "o",
+                          [this](auto& call, auto& reply) {
+                              std::string unit;
+                              std::string mode;
+                              call.read(unit, mode);
+                              reply.append(startUnit(unit));
+                          });
+        systemd.emitAdded();
+
+        mapper.addMethod("GetSubTree", "sias", "a{sa{sas}}",
+                         [this](auto& call, auto& reply) {
+                             std::string root;
+                             int32_t depth;
+                             std::vector<std::string> interfaces;
+                             call.read(root, depth, interfaces);
+                             reply.append(getSubTree(interfaces));
+                         });
+        mapper.addMethod("GetObject", "sas", "a{sas}",
+                         [this](auto& call, auto& reply) {
+                             std::string path;
+                             std::vector<std::string> interfaces;
+                             call.read(path, interfaces);
+                             reply.append(getObject(path));
+                         });
+        mapper.emitAdded();
+
+        addSetting("/xyz/openbmc_project/control/host0/auto_reboot",
+                   "xyz.openbmc_project.Control.Boot.RebootPolicy",
+                   "AutoReboot", false);
+        addSetting("/xyz/openbmc_project/control/host0/auto_reboot/one_time",
+                   "xyz.openbmc_project.Control.Boot.RebootPolicy",
+                   "AutoReboot", false);
+        addSetting(
+            "/xyz/openbmc_project/control/host0/power_restore_policy",
+            "xyz.openbmc_project.Control.Power.RestorePolicy",
+            "PowerRestorePolicy",
+            std::string{
+                "xyz.openbmc_project.Control.Power.RestorePolicy.Policy.None"});
+    }
+
+    /** @brief Finish the jobs started since the last call */
+    void runJobs()
+    {
+        while (!pending.empty())
+        {
+            auto [id, unit] = pending.front();
+            pending.pop_front();
+
+            auto changes = std::vector<UnitChange>{{unit, true}};
+            if (auto it = JOB_TABLE.find(unit); it != JOB_TABLE.end())
+            {
+                changes = it->second;
+            }
+
+            for (const auto& [changed, active] : changes)
+            {
+                units[changed].active = active;
+                if (active)
+                {
+                    jobSignal("JobRemoved", (changed == unit) ? id : ++lastJob,
+                              changed, "done");
+                }
+            }
+        }
+    }
+
+  private:
+    /** @brief A unit, its object is only added once someone asks for it */
+    struct Unit
+    {
+        bool active = false;
+        std::unique_ptr<PropertyInterface> intf;
+    };
+
+    using Interfaces = std::vector<std::string>;
+
+    /** @brief Add a settings object with one property */
+    template <typename T>
+    void addSetting(const std::string& path, const std::string& interface,
+                    const std::string& property, T value)
+    {
+        auto& intf = settings.emplace_back(
+            std::make_unique<PropertyInterface>(bus, path, interface));
+        intf->addProperty<T>(property, [value]() { return value; });
+        intf->emitAdded();
+        objects[path].push_back(interface);
+    }
+
+    sdbusplus::message::object_path getUnit(const std::string& unit)
+    {
+        auto& entry = units[unit];
+        if (!entry.intf)
+        {
+            entry.intf = std::make_unique<PropertyInterface>(
+                bus, unitPath(unit), SYSTEMD_INTERFACE_UNIT);
+            entry.intf->addProperty<std::string>("ActiveState", [this, unit]() {
+                return std::string{units[unit].active ? "active" : "inactive"};
+            });
+            entry.intf->emitAdded();
+        }
+        return sdbusplus::message::object_path{unitPath(unit)};
+    }
+
+    sdbusplus::message::object_path startUnit(const std::string& unit)
+    {
+        auto id = ++lastJob;
+        jobSignal("JobNew", id, unit, nullptr);
+        pending.emplace_back(id, unit);
+        return sdbusplus::message::object_path{jobPath(id)};
+    }
+
+    std::map<std::string, std::map<std::string, Interfaces>>
+        getSubTree(const Interfaces& interfaces)
+    {
+        std::map<std::string, std::map<std::string, Interfaces>> result;
+        for (const auto& [path, implemented] : objects)
+        {
+            for (const auto& interface : implemented)
+            {
+                if (std::find(interfaces.begin(), interfaces.end(),
+                              interface) != interfaces.end())
+                {
+                    result[path][SETTINGS_BUSNAME].push_back(interface);
+                }
+            }
+        }
+        return result;
+    }
+
+    std::map<std::string, Interfaces> getObject(const std::string& path)
+    {
+        auto it = objects.find(path);
+        if (it == objects.end())
+        {
+            throw sdbusplus::exception::SdBusError(ENOENT, "GetObject");
+        }
+        return {{SETTINGS_BUSNAME, it->second}};
+    }
+
+    void jobSignal(const char* member, uint32_t id, const std::string& unit,
+                   const char* result)
+    {
+        auto signal =
+            bus.new_signal(SYSTEMD_OBJ_PATH, SYSTEMD_INTERFACE, member);
+        signal.append(id, sdbusplus::message::object_path{jobPath(id)}, unit);
+        if (result != nullptr)
+        {
+            signal.append(std::string{result});
+        }
+        signal.signal_send();
+    }
+
+    sdbusplus::bus::bus& bus;
+    PropertyInterface systemd;
+    PropertyInterface mapper;
+    std::vector<std::unique_ptr<PropertyInterface>> settings;
+
+    /** @brief The interfaces of each settings object */
+    std::map<std::string, Interfaces> objects;
+
+    std::map<std::string, Unit> units;
+    std::deque<std::pair<uint32_t, std::string>> pending;
+    uint32_t lastJob = 0;
+};
+
+/** @brief Run the stand-ins on their own connection until stop is set */
+inline void runFakeSystem(std::promise<void> ready,
+                          const std::atomic<bool>& stop)
+{
+    auto event = sdeventplus::Event::get_default();
+    auto bus = sdbusplus::bus::new_default();
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    sdbusplus::server::manager::manager objManager(bus, "/");
+
+    std::unique_ptr<FakeSystem> fakes;
+    try
+    {
+        fakes = std::make_unique<FakeSystem>(bus);
+        bus.request_name(SYSTEMD_SERVICE);
+        bus.request_name(MAPPER_BUSNAME);
+        bus.request_name(SETTINGS_BUSNAME);
+    }
+    catch (...)
+    {
+        ready.set_exception(std::current_exception());
+        return;
+    }
+    ready.set_value();
+
+    while (!stop)
+    {
+        event.run(POLL_INTERVAL);
+        fakes->runJobs();
+    }
+}
+
+/** @brief Start a private dbus-daemon listening in dir
+ *
+ * @return The daemon and its address, a pid of -1 if it couldn't be run
+ */
+inline std::pair<pid_t, std::string> startBus(const std::filesystem::path& dir)
+{
+    auto config = (dir / "bus.conf").string();
+    std::ofstream{config}
+        << "<!DOCTYPE busconfig PUBLIC "
+           "\"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\" "
+           "\"http://www.freedesktop.org/standards/dbus/1.0/"
+           "busconfig.dtd\">\n"
+           "<busconfig>\n"
+           "  <type>session</type>\n"
+           "  <listen>unix:path="
+        << (dir / "bus").string()
+        << "</listen>\n"
+           "  <auth>EXTERNAL</auth>\n"
+           "  <policy context=\"default\">\n"
+           "    <allow user=\"*\"/>\n"
+           "    <allow own=\"*\"/>\n"
+           "    <allow send_destination=\"*\" eavesdrop=\"true\"/>\n"
+           "    <allow eavesdrop=\"true\"/>\n"
+           "  </policy>\n"
+           "</busconfig>\n";
+
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return {-1, {}};
+    }
+
+    auto pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        auto configArg = "--config-file=" + config;
+        auto addressArg = "--print-address=" + std::to_string(fds[1]);
+        execlp("dbus-daemon", "dbus-daemon", "--nofork", configArg.c_str(),
+               addressArg.c_str(), nullptr);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    // The address is printed once the daemon is listening
+    std::string address;
+    char c;
+    while ((pid > 0) && (read(fds[0], &c, 1) == 1) && (c != '\n'))
+    {
+        address += c;
+    }
+    close(fds[0]);
+
+    if ((pid > 0) && address.empty())
+    {
+        waitpid(pid, nullptr, 0);
+        pid = -1;
+    }
+    return {pid, address};
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,126 @@
+#include "gpio_event_monitor.hpp"
+
+#include <sdeventplus/event.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+namespace fs = std::filesystem;
+using namespace std::chrono;
+
+// Simulated chip with a single named line, needs the gpio-sim module and
+// a writable configfs so the test is skipped elsewhere
+class TestGpioEventMonitor : public testing::Test
+{
+  public:
+    static constexpr auto lineName = "psm-test-power-good";
+
+    const fs::path simDir{"/sys/kernel/config/gpio-sim/psm-test"};
+    fs::path pullFile;
+
+    void SetUp() override
+    {
+        std::error_code ec;
+        if (!fs::create_directory(simDir, ec) ||
+            !fs::create_directory(simDir / "bank0", ec) ||
+            !fs::create_directory(simDir / "bank0" / "line0", ec))
+        {
+            GTEST_SKIP() << "gpio-sim not available";
+        }
+
+        write(simDir / "bank0" / "num_lines", "1");
+        write(simDir / "bank0" / "line0" / "name", lineName);
+        write(simDir / "live", "1");
+
+        pullFile = fs::path("/sys/devices/platform") /
+                   read(simDir / "dev_name") /
+                   read(simDir / "bank0" / "chip_name") / "sim_gpio0" /
+                   "pull";
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        if (fs::exists(simDir / "live", ec))
+        {
+            write(simDir / "live", "0");
+        }
+        fs::remove(simDir / "bank0" / "line0", ec);
+        fs::remove(simDir / "bank0", ec);
+        fs::remove(simDir, ec);
+    }
+
+    static void write(const fs::path& path, const std::string& value)
+    {
+        std::ofstream f(path);
+        f << value;
+    }
+
+    static std::string read(const fs::path& path)
+    {
+        std::ifstream f(path);
+        std::string value;
+        f >> value;
+        return value;
+    }
+};
+
+TEST_F(TestGpioEventMonitor, reportsEdgesWithKernelTime)
+{
+    auto event = sdeventplus::Event::get_new();
+    std::optional<bool> lastValue;
+    uint64_t lastTime = 0;
+
+    GpioEventMonitor monitor(event, lineName,
+                             [&](bool value, uint64_t timeMs) {
+                                 lastValue = value;
+                                 lastTime = timeMs;
+                             });
+    EXPECT_EQ(monitor.value(), 0);
+
+    auto before = duration_cast<milliseconds>(
+                      system_clock::now().time_since_epoch())
+                      .count();
+    write(pullFile, "pull-up");
+    event.run(milliseconds(500));
+    auto after = duration_cast<milliseconds>(
+                     system_clock::now().time_since_epoch())
+                     .count();
+
+    ASSERT_TRUE(lastValue.has_value());
+    EXPECT_TRUE(*lastValue);
+    EXPECT_GE(lastTime, static_cast<uint64_t>(before));
+    EXPECT_LE(lastTime, static_cast<uint64_t>(after));
+    EXPECT_EQ(monitor.value(), 1);
+
+    lastValue.reset();
+    write(pullFile, "pull-down");
+    event.run(milliseconds(500));
+
+    ASSERT_TRUE(lastValue.has_value());
+    EXPECT_FALSE(*lastValue);
+}
+
+TEST(GpioEventMonitorMissing, throwsForUnknownLine)
+{
+    auto event = sdeventplus::Event::get_new();
+    EXPECT_THROW(GpioEventMonitor(event, "psm-test-no-such-line",
+                                  [](bool, uint64_t) {}),
+                 std::runtime_error);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,137 @@
+#include "io_worker.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace io
+{
+
+using namespace std::chrono_literals;
+
+TEST(TestIoWorker, queueFillsAndEmpties)
+{
+    SpscQueue<int, 4> queue;
+
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(queue.push(i));
+    }
+    int extra = 4;
+    EXPECT_FALSE(queue.push(extra));
+    EXPECT_EQ(queue.size(), 4);
+
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(queue.pop(), i);
+    }
+    EXPECT_EQ(queue.pop(), std::nullopt);
+
+    // Wrapping round keeps the order
+    EXPECT_TRUE(queue.push(extra));
+    EXPECT_EQ(queue.pop(), 4);
+    EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(TestIoWorker, queueAcrossThreads)
+{
+    constexpr int count = 10000;
+    SpscQueue<int, 8> queue;
+
+    std::thread consumer{[&queue]() {
+        int expected = 0;
+        while (expected < count)
+        {
+            if (auto item = queue.pop())
+            {
+                EXPECT_EQ(*item, expected);
+                expected++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    for (int i = 0; i < count; i++)
+    {
+        int item = i;
+        while (!queue.push(item))
+        {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(TestIoWorker, jobsRunInOrder)
+{
+    Worker worker;
+    std::vector<int> ran;
+
+    // More than the queue holds, so some wait for room
+    for (int i = 0; i < static_cast<int>(QUEUE_SIZE) * 4; i++)
+    {
+        worker.queue([&ran, i]() { ran.push_back(i); });
+    }
+    worker.drain();
+
+    ASSERT_EQ(ran.size(), QUEUE_SIZE * 4);
+    for (std::size_t i = 0; i < ran.size(); i++)
+    {
+        EXPECT_EQ(ran[i], static_cast<int>(i));
+    }
+    EXPECT_EQ(worker.depth(), 0);
+}
+
+TEST(TestIoWorker, latencyAndFailures)
+{
+    Worker worker;
+    std::atomic<bool> ran = false;
+
+    worker.queue([]() { std::this_thread::sleep_for(20ms); });
+    worker.queue([]() { throw std::runtime_error("write failed"); });
+    worker.queue([&ran]() { ran = true; });
+    EXPECT_GE(worker.depth(), 1);
+    worker.drain();
+
+    EXPECT_TRUE(ran);
+    EXPECT_EQ(worker.depth(), 0);
+    EXPECT_GE(worker.maxLatencyUs(), 20000);
+
+    worker.reset();
+    EXPECT_EQ(worker.maxLatencyUs(), 0);
+}
+
+TEST(TestIoWorker, destructionRunsWhatsLeft)
+{
+    std::atomic<int> ran = 0;
+    {
+        Worker worker;
+        for (int i = 0; i < 10; i++)
+        {
+            worker.queue([&ran]() {
+                std::this_thread::sleep_for(1ms);
+                ran++;
+            });
+        }
+    }
+    EXPECT_EQ(ran, 10);
+}
+
+} // namespace io
+} // namespace manager
+} // namespace state
+} // namespace phosphor
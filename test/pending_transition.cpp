@@ -0,0 +1,76 @@
+#include "pending_transition.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+class TestPendingTransition : public testing::Test
+{
+  public:
+    sdbusplus::SdBusMock sdbusMock;
+    sdbusplus::bus::bus mockedBus = sdbusplus::get_mocked_new(&sdbusMock);
+    PendingTransition pending;
+
+    TestPendingTransition() :
+        pending(mockedBus, "/xyz/openbmc_project/state/host0",
+                "xyz.openbmc_project.State.Host.Pending")
+    {
+        pending.emitAdded();
+    }
+};
+
+TEST_F(TestPendingTransition, coalesceUntilJobRemoved)
+{
+    const std::string on = "xyz.openbmc_project.State.Host.Transition.On";
+    const std::string off = "xyz.openbmc_project.State.Host.Transition.Off";
+
+    EXPECT_FALSE(pending.active());
+    EXPECT_FALSE(pending.matches(on));
+
+    pending.start(on, sdbusplus::message::object_path{
+                          "/org/freedesktop/systemd1/job/100"});
+    EXPECT_TRUE(pending.active());
+    EXPECT_TRUE(pending.matches(on));
+    EXPECT_FALSE(pending.matches(off));
+
+    // Some other job finishing leaves it pending
+    EXPECT_FALSE(pending.jobRemoved(sdbusplus::message::object_path{
+        "/org/freedesktop/systemd1/job/99"}));
+    EXPECT_TRUE(pending.matches(on));
+
+    EXPECT_TRUE(pending.jobRemoved(sdbusplus::message::object_path{
+        "/org/freedesktop/systemd1/job/100"}));
+    EXPECT_FALSE(pending.active());
+}
+
+TEST_F(TestPendingTransition, replacedJob)
+{
+    const std::string on = "xyz.openbmc_project.State.Host.Transition.On";
+    const std::string off = "xyz.openbmc_project.State.Host.Transition.Off";
+
+    pending.start(on, sdbusplus::message::object_path{
+                          "/org/freedesktop/systemd1/job/100"});
+    pending.start(off, sdbusplus::message::object_path{
+                           "/org/freedesktop/systemd1/job/101"});
+
+    // The replaced job being removed doesn't clear its replacement
+    EXPECT_FALSE(pending.jobRemoved(sdbusplus::message::object_path{
+        "/org/freedesktop/systemd1/job/100"}));
+    EXPECT_TRUE(pending.matches(off));
+
+    pending.clear();
+    EXPECT_FALSE(pending.active());
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
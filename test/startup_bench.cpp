@@ -0,0 +1,449 @@
+/* Time and bus calls of each daemon's startup, from exec to owning its bus
+ * names, split at the milestones it records (see startup_timing.hpp). The
+ * daemons are started one after another against a private dbus-daemon and
+ * the stand-ins in fake_system.hpp, in the order they come up at boot, and
+ * are left running until the round is over. A monitor connection sees
+ * every method call on the bus, those from the daemon being started are
+ * counted in the phase they were seen in.
+ *
+ * The daemons still persist to their usual paths, so run this where those
+ * are writable or don't matter.
+ *
+ * Usage: bench_startup [-r ROUNDS] DAEMON...
+ */
+#include "fake_system.hpp"
+#include "startup_timing.hpp"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <systemd/sd-bus.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+extern char** environ;
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @brief Longest a daemon may take to start before the run is abandoned */
+constexpr auto STARTUP_TIMEOUT = std::chrono::seconds{30};
+
+/** @brief How often to look for the daemon's last milestone */
+constexpr auto TRACE_POLL = std::chrono::milliseconds{1};
+
+/** @brief Return CLOCK_MONOTONIC in nanoseconds, as the milestones have it */
+static uint64_t monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/** @class CallMonitor
+ *  @brief Records when each method call on the bus was seen, and who made
+ *  it
+ */
+class CallMonitor
+{
+  public:
+    CallMonitor(const CallMonitor&) = delete;
+    CallMonitor& operator=(const CallMonitor&) = delete;
+    CallMonitor(CallMonitor&&) = delete;
+    CallMonitor& operator=(CallMonitor&&) = delete;
+
+    struct Call
+    {
+        uint64_t timeNs;
+        std::string sender;
+    };
+
+    explicit CallMonitor(const std::string& address)
+    {
+        if ((sd_bus_new(&bus) < 0) ||
+            (sd_bus_set_address(bus, address.c_str()) < 0) ||
+            (sd_bus_set_bus_client(bus, 1) < 0) ||
+            (sd_bus_set_monitor(bus, 1) < 0) || (sd_bus_start(bus) < 0))
+        {
+            sd_bus_unref(bus);
+            throw std::runtime_error("Failed to connect the monitor");
+        }
+
+        sd_bus_error error = SD_BUS_ERROR_NULL;
+        if (sd_bus_call_method(bus, "org.freedesktop.DBus",
+                               "/org/freedesktop/DBus",
+                               "org.freedesktop.DBus.Monitoring",
+                               "BecomeMonitor", &error, nullptr, "asu", 1,
+                               "type='method_call'", 0u) < 0)
+        {
+            std::string message = "BecomeMonitor failed: ";
+            message += error.message ? error.message : "unknown error";
+            sd_bus_error_free(&error);
+            sd_bus_unref(bus);
+            throw std::runtime_error(message);
+        }
+
+        thread = std::thread(&CallMonitor::run, this);
+    }
+
+    ~CallMonitor()
+    {
+        stop = true;
+        thread.join();
+        sd_bus_flush_close_unref(bus);
+    }
+
+    /** @brief Return the calls seen so far */
+    std::vector<Call> calls() const
+    {
+        std::lock_guard lock{mutex};
+        return seen;
+    }
+
+  private:
+    void run()
+    {
+        while (!stop)
+        {
+            sd_bus_message* msg = nullptr;
+            auto r = sd_bus_process(bus, &msg);
+            if (r < 0)
+            {
+                break;
+            }
+
+            if (msg != nullptr)
+            {
+                if (sd_bus_message_is_method_call(msg, nullptr, nullptr) > 0)
+                {
+                    auto sender = sd_bus_message_get_sender(msg);
+                    std::lock_guard lock{mutex};
+                    seen.push_back(
+                        {monotonicNs(), (sender != nullptr) ? sender : ""});
+                }
+                sd_bus_message_unref(msg);
+            }
+
+            if (r == 0)
+            {
+                sd_bus_wait(bus, std::chrono::duration_cast<
+                                     std::chrono::microseconds>(POLL_INTERVAL)
+                                     .count());
+            }
+        }
+    }
+
+    sd_bus* bus = nullptr;
+    std::atomic<bool> stop = false;
+    mutable std::mutex mutex;
+    std::vector<Call> seen;
+    std::thread thread;
+};
+
+/** @brief A milestone and when the daemon reached it */
+using Milestone = std::pair<std::string, uint64_t>;
+
+/** @brief Read the milestones a daemon has traced so far */
+static std::vector<Milestone> readTrace(const std::filesystem::path& path)
+{
+    std::vector<Milestone> milestones;
+    std::ifstream trace{path};
+    std::string line;
+    while (std::getline(trace, line))
+    {
+        std::istringstream fields{line};
+        Milestone milestone;
+        if (fields >> milestone.first >> milestone.second)
+        {
+            milestones.push_back(std::move(milestone));
+        }
+    }
+    return milestones;
+}
+
+/** @class Daemon
+ *  @brief One started daemon
+ */
+class Daemon
+{
+  public:
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+    Daemon(Daemon&&) = delete;
+    Daemon& operator=(Daemon&&) = delete;
+
+    /** @brief Start the daemon and wait for it to reach startup::READY
+     *
+     * @param[in] path - The daemon
+     * @param[in] dir  - Where to put its trace and output
+     */
+    Daemon(const std::string& path, const std::filesystem::path& dir) :
+        trace(dir / std::filesystem::path(path).filename()
+                        .replace_extension(".trace")),
+        log(dir / std::filesystem::path(path).filename()
+                      .replace_extension(".log"))
+    {
+        std::filesystem::remove(trace);
+
+        // Built up front, only async-signal-safe calls are allowed between
+        // fork and exec in a threaded process
+        std::vector<std::string> env;
+        for (auto var = environ; *var != nullptr; var++)
+        {
+            env.emplace_back(*var);
+        }
+        env.push_back(std::string{startup::TRACE_ENV} + '=' + trace.string());
+        std::vector<char*> envp;
+        for (auto& var : env)
+        {
+            envp.push_back(var.data());
+        }
+        envp.push_back(nullptr);
+
+        std::string arg0 = path;
+        char* argv[] = {arg0.data(), nullptr};
+
+        int out = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644);
+        if (out < 0)
+        {
+            throw std::runtime_error("Failed to create " + log.string());
+        }
+
+        startNs = monotonicNs();
+        pid = fork();
+        if (pid == 0)
+        {
+            dup2(out, STDOUT_FILENO);
+            dup2(out, STDERR_FILENO);
+            execve(path.c_str(), argv, envp.data());
+            _exit(127);
+        }
+        close(out);
+        if (pid < 0)
+        {
+            throw std::runtime_error("Failed to fork " + path);
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + STARTUP_TIMEOUT;
+        while (true)
+        {
+            milestones = readTrace(trace);
+            if (!milestones.empty() &&
+                (milestones.back().first == startup::READY))
+            {
+                return;
+            }
+
+            if ((waitpid(pid, nullptr, WNOHANG) == pid) ||
+                (std::chrono::steady_clock::now() > deadline))
+            {
+                std::ifstream output{log};
+                std::string message = path + " did not start:\n";
+                message.append(std::istreambuf_iterator<char>(output), {});
+                stopDaemon();
+                throw std::runtime_error(message);
+            }
+            std::this_thread::sleep_for(TRACE_POLL);
+        }
+    }
+
+    ~Daemon()
+    {
+        stopDaemon();
+    }
+
+    /** @brief When the daemon was started */
+    uint64_t startNs = 0;
+
+    /** @brief The milestones it went through */
+    std::vector<Milestone> milestones;
+
+  private:
+    void stopDaemon()
+    {
+        if (pid > 0)
+        {
+            kill(pid, SIGTERM);
+            waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+
+    std::filesystem::path trace;
+    std::filesystem::path log;
+    pid_t pid = -1;
+};
+
+/** @brief A startup phase's samples, named for the milestone it ends at */
+struct Phase
+{
+    std::string name;
+    std::vector<double> ms;
+    std::vector<uint64_t> calls;
+};
+
+/** @brief Return the median of some samples */
+template <typename T>
+static T median(std::vector<T> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
+
+using namespace phosphor::state::manager;
+
+int main(int argc, char** argv)
+{
+    namespace fs = std::filesystem;
+
+    uint64_t rounds = 20;
+    int arg;
+    while ((arg = getopt(argc, argv, "r:")) != -1)
+    {
+        if (arg != 'r')
+        {
+            std::fprintf(stderr, "Usage: %s [-r ROUNDS] DAEMON...\n",
+                         argv[0]);
+            return 2;
+        }
+        rounds = std::stoull(optarg);
+    }
+    std::vector<std::string> daemons(argv + optind, argv + argc);
+
+    char tmpl[] = "/tmp/startup_bench.XXXXXX";
+    fs::path dir = mkdtemp(tmpl);
+
+    auto [busDaemon, address] = startBus(dir);
+    if (busDaemon < 0)
+    {
+        std::fprintf(stderr, "Could not start dbus-daemon, skipping\n");
+        fs::remove_all(dir);
+        return 77;
+    }
+
+    setenv("DBUS_STARTER_BUS_TYPE", "system", 1);
+    setenv("DBUS_SYSTEM_BUS_ADDRESS", address.c_str(), 1);
+    setenv("DBUS_SESSION_BUS_ADDRESS", address.c_str(), 1);
+
+    std::atomic<bool> stop = false;
+    std::promise<void> ready;
+    auto started = ready.get_future();
+    std::thread fakes{runFakeSystem, std::move(ready), std::cref(stop)};
+
+    int rc = 0;
+    try
+    {
+        started.get();
+        CallMonitor monitor{address};
+
+        std::vector<std::vector<Phase>> results(daemons.size());
+        for (uint64_t round = 0; round < rounds; round++)
+        {
+            // Earlier daemons stay up, later ones may depend on them
+            std::vector<std::unique_ptr<Daemon>> running;
+            for (std::size_t i = 0; i < daemons.size(); i++)
+            {
+                std::set<std::string> others;
+                for (const auto& call : monitor.calls())
+                {
+                    others.insert(call.sender);
+                }
+
+                auto& daemon = running.emplace_back(
+                    std::make_unique<Daemon>(daemons[i], dir));
+                auto calls = monitor.calls();
+
+                // Phases run from exec or the previous milestone
+                auto& phases = results[i];
+                auto from = daemon->startNs;
+                for (std::size_t m = 0; m < daemon->milestones.size(); m++)
+                {
+                    const auto& [name, to] = daemon->milestones[m];
+                    if (phases.size() <= m)
+                    {
+                        phases.push_back({name, {}, {}});
+                    }
+
+                    uint64_t count = 0;
+                    for (const auto& call : calls)
+                    {
+                        if ((call.timeNs > from) && (call.timeNs <= to) &&
+                            !others.contains(call.sender))
+                        {
+                            count++;
+                        }
+                    }
+                    phases[m].ms.push_back((to - from) / 1e6);
+                    phases[m].calls.push_back(count);
+                    from = to;
+                }
+            }
+
+            // Stop them last one first
+            while (!running.empty())
+            {
+                running.pop_back();
+            }
+        }
+
+        for (std::size_t i = 0; i < daemons.size(); i++)
+        {
+            std::printf("%s\n", fs::path(daemons[i]).filename().c_str());
+            double totalMs = 0;
+            uint64_t totalCalls = 0;
+            for (const auto& phase : results[i])
+            {
+                auto ms = median(phase.ms);
+                auto calls = median(phase.calls);
+                totalMs += ms;
+                totalCalls += calls;
+                std::printf("  %-12s p50 %9.3f ms  %4llu calls\n",
+                            phase.name.c_str(), ms,
+                            static_cast<unsigned long long>(calls));
+            }
+            std::printf("  %-12s     %9.3f ms  %4llu calls\n", "total",
+                        totalMs, static_cast<unsigned long long>(totalCalls));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        rc = 1;
+    }
+
+    stop = true;
+    fakes.join();
+
+    kill(busDaemon, SIGTERM);
+    waitpid(busDaemon, nullptr, 0);
+    fs::remove_all(dir);
+
+    return rc;
+}
@@ -0,0 +1,181 @@
+#include "state_journal.hpp"
+
+#include <sdeventplus/event.hpp>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace journal
+{
+
+namespace fs = std::filesystem;
+
+constexpr auto bmcReady = "xyz.openbmc_project.State.BMC.BMCState.Ready";
+constexpr auto bmcNotReady = "xyz.openbmc_project.State.BMC.BMCState.NotReady";
+constexpr auto chassisOff = "xyz.openbmc_project.State.Chassis.PowerState.Off";
+constexpr auto chassisOn = "xyz.openbmc_project.State.Chassis.PowerState.On";
+constexpr auto hostOff = "xyz.openbmc_project.State.Host.HostState.Off";
+constexpr auto hostStarting =
+    "xyz.openbmc_project.State.Host.HostState.TransitioningToRunning";
+constexpr auto hostRunning = "xyz.openbmc_project.State.Host.HostState.Running";
+
+class TestStateJournal : public testing::Test
+{
+  public:
+    sdeventplus::Event event = sdeventplus::Event::get_default();
+    fs::path dir;
+    std::string path;
+    std::string persistPath;
+
+    TestStateJournal()
+    {
+        char tmpl[] = "/tmp/state_journal_test.XXXXXX";
+        dir = mkdtemp(tmpl);
+        path = (dir / "run" / "state-journal").string();
+        persistPath = (dir / "persist" / "stateJournal").string();
+    }
+
+    ~TestStateJournal()
+    {
+        fs::remove_all(dir);
+    }
+};
+
+TEST_F(TestStateJournal, query)
+{
+    Writer writer{event, path.c_str(), persistPath.c_str(), 8};
+    writer.append(Source::Chassis, chassisOff, chassisOn);
+    writer.append(Source::Host, hostOff, hostStarting);
+    writer.append(Source::Host, hostStarting, hostRunning);
+
+    Reader reader{path.c_str()};
+    ASSERT_TRUE(reader.valid());
+
+    auto all = reader.query();
+    ASSERT_EQ(all.size(), 3);
+    EXPECT_EQ(all[0].sequence, 1);
+    EXPECT_EQ(all[2].sequence, 3);
+    EXPECT_LE(all[0].timeUs, all[2].timeUs);
+
+    auto host = reader.query({.source = Source::Host});
+    ASSERT_EQ(host.size(), 2);
+    EXPECT_EQ(stateName(host[1].previous)->name, hostStarting);
+    EXPECT_EQ(stateName(host[1].state)->name, hostRunning);
+
+    auto state = reader.query(
+        {.source = Source::Host,
+         .state = stateCode(Source::Host, hostStarting)});
+    ASSERT_EQ(state.size(), 1);
+    EXPECT_EQ(state[0].sequence, 2);
+
+    EXPECT_TRUE(reader.query({.toUs = all[0].timeUs - 1}).empty());
+    EXPECT_EQ(reader.query({.fromUs = all[0].timeUs}).size(), 3);
+}
+
+TEST_F(TestStateJournal, stateCodes)
+{
+    // Stored numbers are part of the file format, they must not move
+    EXPECT_EQ(stateCode(Source::BMC, bmcReady), 0);
+    EXPECT_EQ(stateCode(Source::Chassis, chassisOff), 4);
+    EXPECT_EQ(stateCode(Source::Host, hostOff), 8);
+    EXPECT_EQ(stateCode(Source::Host, hostRunning), 9);
+
+    // A state is only known for its own manager
+    EXPECT_EQ(stateCode(Source::BMC, hostOff), UNKNOWN_STATE);
+    EXPECT_EQ(stateCode(Source::Host, "Bogus"), UNKNOWN_STATE);
+    EXPECT_FALSE(stateName(UNKNOWN_STATE));
+
+    for (uint32_t i = 0; i < STATES.size(); i++)
+    {
+        EXPECT_EQ(stateCode(STATES[i].source, STATES[i].name), i);
+    }
+}
+
+TEST_F(TestStateJournal, wraps)
+{
+    Writer writer{event, path.c_str(), persistPath.c_str(), 4};
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        writer.append(Source::BMC, (i % 2) ? bmcReady : bmcNotReady,
+                      (i % 2) ? bmcNotReady : bmcReady);
+    }
+
+    Reader reader{path.c_str()};
+    auto records = reader.query();
+    ASSERT_EQ(records.size(), 4);
+    EXPECT_EQ(records.front().sequence, 7);
+    EXPECT_EQ(records.back().sequence, 10);
+    EXPECT_EQ(records.back().state, stateCode(Source::BMC, bmcNotReady));
+}
+
+TEST_F(TestStateJournal, persistAcrossReboot)
+{
+    {
+        Writer writer{event, path.c_str(), persistPath.c_str(), 8};
+        writer.append(Source::Host, hostOff, hostStarting);
+        writer.append(Source::Host, hostStarting, hostRunning);
+        writer.flush();
+        writer.append(Source::Host, hostRunning, hostOff);
+        writer.flush();
+    }
+    EXPECT_EQ(readPersisted(persistPath.c_str()).size(), 3);
+
+    // /run is empty after a reboot
+    fs::remove(path);
+
+    Writer writer{event, path.c_str(), persistPath.c_str(), 8};
+    writer.append(Source::Chassis, chassisOn, chassisOff);
+
+    Reader reader{path.c_str()};
+    auto records = reader.query();
+    ASSERT_EQ(records.size(), 4);
+    EXPECT_EQ(records[2].state, stateCode(Source::Host, hostOff));
+    EXPECT_EQ(records[3].sequence, 4);
+    EXPECT_EQ(records[3].source, Source::Chassis);
+}
+
+TEST_F(TestStateJournal, flushedOnDestruction)
+{
+    {
+        Writer writer{event, path.c_str(), persistPath.c_str(), 8};
+        writer.append(Source::Host, hostOff, hostStarting);
+        writer.append(Source::Host, hostStarting, hostRunning);
+    }
+
+    // Short of a batch, so only the destructor wrote them
+    auto records = readPersisted(persistPath.c_str());
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[1].state, stateCode(Source::Host, hostRunning));
+}
+
+TEST_F(TestStateJournal, otherCapacityReplaced)
+{
+    {
+        Writer writer{event, path.c_str(), persistPath.c_str(), 8};
+        writer.append(Source::Host, hostOff, hostStarting);
+    }
+
+    // The replacement carries on from what the old ring left on flash
+    Writer writer{event, path.c_str(), persistPath.c_str(), 16};
+    writer.append(Source::Host, hostStarting, hostRunning);
+
+    Reader reader{path.c_str()};
+    auto records = reader.query();
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].state, stateCode(Source::Host, hostStarting));
+    EXPECT_EQ(records[1].sequence, 2);
+    EXPECT_EQ(records[1].state, stateCode(Source::Host, hostRunning));
+}
+
+} // namespace journal
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,177 @@
+#include "state_machine.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <set>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+enum class LampState
+{
+    Off,
+    On,
+    Blinking
+};
+
+enum class LampTransition
+{
+    Off,
+    On
+};
+
+class Lamp
+{
+  public:
+    LampState state = LampState::Off;
+    std::set<std::string> activeUnits;
+    int blinks = 0;
+
+    LampState setState(LampState value)
+    {
+        state = value;
+        return state;
+    }
+
+    bool unitActive(const std::string& unit)
+    {
+        return activeUnits.contains(unit);
+    }
+
+    void blink()
+    {
+        blinks++;
+    }
+};
+
+using LampRule = sm::Rule<Lamp, LampState>;
+
+// Declared out of order on purpose, the engine sorts them
+constexpr auto lampMachine = sm::makeEngine(
+    &Lamp::setState, &Lamp::unitActive,
+    {LampRule{.event = "lamp-on.target",
+              .result = "done",
+              .guard = {"lamp-on.target", sm::Require::Active},
+              .state = LampState::On},
+     LampRule{.event = "lamp-blink.target", .action = &Lamp::blink},
+     LampRule{.event = "lamp-off.target",
+              .result = "done",
+              .guard = {"lamp-on.target", sm::Require::Inactive},
+              .state = LampState::Off},
+     LampRule{.event = "lamp-blink.target",
+              .result = "done",
+              .state = LampState::Blinking,
+              .action = &Lamp::blink}});
+static_assert(lampMachine.valid());
+static_assert(lampMachine.find("lamp-on.target", "done") != nullptr);
+static_assert(lampMachine.find("lamp-on.target", "failed") == nullptr);
+static_assert(lampMachine.find("lamp-blink.target") != nullptr);
+
+// Duplicate events are caught at compile time
+static_assert(!sm::makeEngine(&Lamp::setState, nullptr,
+                              {LampRule{.event = "lamp-on.target",
+                                        .state = LampState::On},
+                               LampRule{.event = "lamp-on.target",
+                                        .state = LampState::Off}})
+                   .valid());
+
+// So is a guard when there's no way to check units
+static_assert(
+    !sm::makeEngine(&Lamp::setState, nullptr,
+                    {LampRule{.event = "lamp-on.target",
+                              .guard = {"lamp-on.target", sm::Require::Active},
+                              .state = LampState::On}})
+         .valid());
+
+// And a rule that does nothing
+static_assert(!sm::makeEngine(&Lamp::setState, nullptr,
+                              {LampRule{.event = "lamp-on.target"}})
+                   .valid());
+
+using LampTarget = sm::Target<LampTransition>;
+constexpr std::array lampTargets = {
+    LampTarget{LampTransition::Off, "lamp-off.target"},
+    LampTarget{LampTransition::On, "lamp-on.target"}};
+static_assert(sm::validTargets(lampTargets));
+static_assert(sm::findTarget(lampTargets, LampTransition::On) ==
+              "lamp-on.target");
+static_assert(!sm::validTargets(std::array{
+    LampTarget{LampTransition::On, "lamp-on.target"},
+    LampTarget{LampTransition::On, "lamp-blink.target"}}));
+
+// Enough rules to be binary searched
+constexpr auto bigMachine = sm::makeEngine(
+    &Lamp::setState, nullptr,
+    {LampRule{.event = "lamp-9.target", .state = LampState::Off},
+     LampRule{.event = "lamp-1.target", .state = LampState::On},
+     LampRule{.event = "lamp-8.target", .state = LampState::Off},
+     LampRule{.event = "lamp-2.target", .state = LampState::On},
+     LampRule{.event = "lamp-7.target", .state = LampState::Off},
+     LampRule{.event = "lamp-3.target", .state = LampState::On},
+     LampRule{.event = "lamp-6.target", .state = LampState::Off},
+     LampRule{.event = "lamp-4.target", .state = LampState::On},
+     LampRule{.event = "lamp-10.target", .state = LampState::Blinking},
+     LampRule{.event = "lamp-5.target", .state = LampState::Off}});
+static_assert(bigMachine.valid());
+static_assert(bigMachine.find("lamp-10.target") != nullptr);
+static_assert(bigMachine.find("lamp-5.target") != nullptr);
+static_assert(bigMachine.find("lamp-0.target") == nullptr);
+static_assert(bigMachine.find("lamp-5.target", "done") == nullptr);
+
+TEST(StateMachine, dispatchWithGuards)
+{
+    Lamp lamp;
+
+    // Guard not met, nothing changes
+    EXPECT_FALSE(lampMachine.dispatch(lamp, "lamp-on.target", "done"));
+    EXPECT_EQ(lamp.state, LampState::Off);
+
+    lamp.activeUnits.insert("lamp-on.target");
+    EXPECT_TRUE(lampMachine.dispatch(lamp, "lamp-on.target", "done"));
+    EXPECT_EQ(lamp.state, LampState::On);
+
+    // The off rule requires the on target to be inactive
+    EXPECT_FALSE(lampMachine.dispatch(lamp, "lamp-off.target", "done"));
+    lamp.activeUnits.clear();
+    EXPECT_TRUE(lampMachine.dispatch(lamp, "lamp-off.target", "done"));
+    EXPECT_EQ(lamp.state, LampState::Off);
+
+    // Unknown events and results are ignored
+    EXPECT_FALSE(lampMachine.dispatch(lamp, "lamp-off.target", "failed"));
+    EXPECT_FALSE(lampMachine.dispatch(lamp, "other.target", "done"));
+}
+
+TEST(StateMachine, dispatchActions)
+{
+    Lamp lamp;
+
+    // An action on its own leaves the state alone
+    EXPECT_TRUE(lampMachine.dispatch(lamp, "lamp-blink.target"));
+    EXPECT_EQ(lamp.state, LampState::Off);
+    EXPECT_EQ(lamp.blinks, 1);
+
+    EXPECT_TRUE(lampMachine.dispatch(lamp, "lamp-blink.target", "done"));
+    EXPECT_EQ(lamp.state, LampState::Blinking);
+    EXPECT_EQ(lamp.blinks, 2);
+}
+
+TEST(StateMachine, dispatchSearched)
+{
+    Lamp lamp;
+
+    EXPECT_TRUE(bigMachine.dispatch(lamp, "lamp-10.target"));
+    EXPECT_EQ(lamp.state, LampState::Blinking);
+    EXPECT_TRUE(bigMachine.dispatch(lamp, "lamp-4.target"));
+    EXPECT_EQ(lamp.state, LampState::On);
+    EXPECT_FALSE(bigMachine.dispatch(lamp, "lamp-11.target"));
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -0,0 +1,131 @@
+/* Cost of handling a JobRemoved event with the state machine engine,
+ * against the if/else chain of string compares it replaced. Guards are
+ * left out since they're a D-Bus call either way and would swamp the
+ * lookup.
+ */
+#include "state_machine.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+enum class BenchState
+{
+    Off,
+    Running,
+    Quiesced,
+    DiagnosticMode
+};
+
+constexpr auto OFF_TGT = "obmc-host-stop@0.target";
+constexpr auto ON_TGT = "obmc-host-startmin@0.target";
+constexpr auto QUIESCE_TGT = "obmc-host-quiesce@0.target";
+constexpr auto DIAG_TGT = "obmc-host-diagnostic-mode@0.target";
+
+class BenchMachine
+{
+  public:
+    BenchState state = BenchState::Off;
+    uint64_t changes = 0;
+
+    BenchState setState(BenchState value)
+    {
+        state = value;
+        changes++;
+        return state;
+    }
+
+    void handleChain(const std::string& unit, const std::string& result)
+    {
+        if ((unit == OFF_TGT) && (result == "done"))
+        {
+            setState(BenchState::Off);
+        }
+        else if ((unit == ON_TGT) && (result == "done"))
+        {
+            setState(BenchState::Running);
+        }
+        else if ((unit == QUIESCE_TGT) && (result == "done"))
+        {
+            setState(BenchState::Quiesced);
+        }
+        else if ((unit == DIAG_TGT) && (result == "done"))
+        {
+            setState(BenchState::DiagnosticMode);
+        }
+    }
+};
+
+using BenchRule = sm::Rule<BenchMachine, BenchState>;
+
+constexpr auto benchMachine = sm::makeEngine(
+    &BenchMachine::setState, nullptr,
+    {BenchRule{.event = OFF_TGT, .result = "done", .state = BenchState::Off},
+     BenchRule{.event = ON_TGT,
+               .result = "done",
+               .state = BenchState::Running},
+     BenchRule{.event = QUIESCE_TGT,
+               .result = "done",
+               .state = BenchState::Quiesced},
+     BenchRule{.event = DIAG_TGT,
+               .result = "done",
+               .state = BenchState::DiagnosticMode}});
+static_assert(benchMachine.valid());
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
+
+using namespace phosphor::state::manager;
+
+template <typename Handler>
+static double nsPerEvent(const std::array<std::string, 6>& units,
+                         uint64_t iterations, Handler&& handler)
+{
+    const std::string done{"done"};
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        handler(units[i % units.size()], done);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           iterations;
+}
+
+int main()
+{
+    constexpr uint64_t iterations = 10000000;
+
+    // Most JobRemoved signals are for units nobody here cares about
+    const std::array<std::string, 6> units = {
+        OFF_TGT,  ON_TGT,         QUIESCE_TGT,
+        DIAG_TGT, "dbus.service", "systemd-tmpfiles-clean.service"};
+
+    BenchMachine machine;
+
+    auto chain = nsPerEvent(units, iterations,
+                            [&machine](const auto& unit, const auto& result) {
+                                machine.handleChain(unit, result);
+                            });
+    auto table = nsPerEvent(
+        units, iterations, [&machine](const auto& unit, const auto& result) {
+            benchMachine.dispatch(machine, unit, result);
+        });
+
+    std::printf("if/else chain: %.1f ns/event\n", chain);
+    std::printf("engine table:  %.1f ns/event\n", table);
+    std::printf("state changes: %llu\n",
+                static_cast<unsigned long long>(machine.changes));
+
+    return 0;
+}
@@ -0,0 +1,502 @@
+/* End-to-end latency of the Host, Chassis and BMC managers, from a
+ * transition request to the state change it leads to, and the signal rate
+ * that takes. The real managers run against a private dbus-daemon with
+ * stand-ins for systemd, the ObjectMapper and the settings daemon. The
+ * systemd stand-in finishes each job as soon as it's started, so what's
+ * measured is the managers and D-Bus rather than the targets.
+ *
+ * Each manager has its own thread and connection, as it would its own
+ * process, with the Host's systemd connection at SYSTEMD_EVENT_PRIORITY as
+ * its daemon has it. It's built with a config.h of its own, see
+ * test/bench/meson.build, so what they persist and put in /run goes under
+ * BENCH_STATE_DIR in the build directory.
+ *
+ * FLOOD has another connection send the Host that many GetAll calls a
+ * millisecond throughout, as bulk property traffic, and the time from each
+ * step's last JobRemoved to its state change is reported alongside. With
+ * "shared" the Host talks to systemd on its one connection instead, so
+ * JobRemoved waits in line with the flood, for comparison. Keep FLOOD
+ * below what the Host can serve or its queue just grows until the bus
+ * gives up on it.
+ *
+ * Usage: bench_state_manager [ROUNDS [FLOOD [shared]]]
+ */
+#include "config.h"
+
+#include "bmc_state_manager.hpp"
+#include "chassis_state_manager.hpp"
+#include "fake_system.hpp"
+#include "host_state_manager.hpp"
+
+#include <stdlib.h>
+#include <systemd/sd-bus.h>
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+#include <sdbusplus/exception.hpp>
+#include <sdbusplus/server/manager.hpp>
+#include <sdeventplus/event.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+/** @brief Longest a step may take before the run is abandoned */
+constexpr auto STEP_TIMEOUT = std::chrono::seconds{10};
+
+/** @class Driver
+ *  @brief Requests transitions and follows the resulting signals
+ */
+class Driver
+{
+  public:
+    Driver(const Driver&) = delete;
+    Driver& operator=(const Driver&) = delete;
+    Driver(Driver&&) = delete;
+    Driver& operator=(Driver&&) = delete;
+
+    Driver(sdbusplus::bus::bus& bus, const sdeventplus::Event& event) :
+        bus(bus), event(event),
+        signals(bus, "type='signal'",
+                std::bind(std::mem_fn(&Driver::signal), this,
+                          std::placeholders::_1))
+    {}
+
+    /** @brief Each property's and JobRemoved unit's count of signals */
+    std::map<std::string, uint64_t> counts;
+
+    /** @brief The last value of each string property */
+    std::map<std::string, std::string> states;
+
+    /** @brief All signals seen */
+    uint64_t signalCount = 0;
+
+    /** @brief When the last JobRemoved was seen */
+    std::chrono::steady_clock::time_point lastJobRemoved;
+
+    /** @brief Set a string property */
+    void set(const char* service, const std::string& path,
+             const char* interface, const char* property,
+             const std::string& value)
+    {
+        auto method = bus.new_method_call(service, path.c_str(),
+                                          "org.freedesktop.DBus.Properties",
+                                          "Set");
+        method.append(interface, property, std::variant<std::string>(value));
+        bus.call_noreply(method);
+    }
+
+    /** @brief Start a unit on the systemd stand-in */
+    void startUnit(const std::string& unit)
+    {
+        auto method = bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
+                                          SYSTEMD_INTERFACE, "StartUnit");
+        method.append(unit, std::string{"replace"});
+        bus.call_noreply(method);
+    }
+
+    /** @brief Process signals until done returns true, false on timeout */
+    bool waitFor(const std::function<bool()>& done)
+    {
+        auto deadline = std::chrono::steady_clock::now() + STEP_TIMEOUT;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                return false;
+            }
+            event.run(POLL_INTERVAL);
+        }
+        return true;
+    }
+
+  private:
+    void signal(sdbusplus::message::message& msg)
+    {
+        signalCount++;
+
+        std::string member = msg.get_member();
+        try
+        {
+            if (member == "JobRemoved")
+            {
+                uint32_t id;
+                sdbusplus::message::object_path job;
+                std::string unit;
+                std::string result;
+                msg.read(id, job, unit, result);
+                counts[unit]++;
+                lastJobRemoved = std::chrono::steady_clock::now();
+            }
+            else if (member == "PropertiesChanged")
+            {
+                std::string interface;
+                std::map<std::string,
+                         std::variant<std::string, bool, uint32_t, uint64_t,
+                                      int64_t, std::vector<std::string>>>
+                    changed;
+                msg.read(interface, changed);
+                for (const auto& [property, value] : changed)
+                {
+                    counts[property]++;
+                    if (auto state = std::get_if<std::string>(&value))
+                    {
+                        states[property] = *state;
+                    }
+                }
+            }
+        }
+        catch (const sdbusplus::exception::exception&)
+        {
+            // Not one the steps wait on
+        }
+    }
+
+    sdbusplus::bus::bus& bus;
+    const sdeventplus::Event& event;
+    sdbusplus::bus::match_t signals;
+};
+
+/** @brief Run a manager on its own connection until stop is set */
+template <typename Manager>
+static void runManager(std::promise<void> ready, const std::atomic<bool>& stop,
+                       const char* busName, std::string objPath)
+{
+    auto event = sdeventplus::Event::get_default();
+    auto bus = sdbusplus::bus::new_default();
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    sdbusplus::server::manager::manager objManager(bus, objPath.c_str());
+
+    std::unique_ptr<Manager> manager;
+    try
+    {
+        manager = std::make_unique<Manager>(bus, objPath.c_str());
+        bus.request_name(busName);
+    }
+    catch (...)
+    {
+        ready.set_exception(std::current_exception());
+        return;
+    }
+    ready.set_value();
+
+    while (!stop)
+    {
+        event.run(POLL_INTERVAL);
+    }
+}
+
+/** @brief Run the Host until stop is set, talking to systemd on a
+ *  connection of its own unless shared is set
+ */
+static void runHost(std::promise<void> ready, const std::atomic<bool>& stop,
+                    std::string objPath, bool shared)
+{
+    auto event = sdeventplus::Event::get_default();
+    auto bus = sdbusplus::bus::new_default();
+    // A connection of its own, new_default() would be the same one again
+    auto systemdBus = sdbusplus::bus::new_system();
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+    sdbusplus::server::manager::manager objManager(bus, objPath.c_str());
+
+    std::unique_ptr<Host> manager;
+    try
+    {
+        // attach_event() drops the result, and the split is what's measured
+        auto r = sd_bus_attach_event(systemdBus.get(), event.get(),
+                                     SYSTEMD_EVENT_PRIORITY);
+        if (r < 0)
+        {
+            throw std::runtime_error("Attaching the systemd connection: " +
+                                     std::to_string(-r));
+        }
+        manager = std::make_unique<Host>(bus, shared ? bus : systemdBus,
+                                         objPath.c_str());
+        bus.request_name(HOST_BUSNAME);
+    }
+    catch (...)
+    {
+        ready.set_exception(std::current_exception());
+        return;
+    }
+    ready.set_value();
+
+    while (!stop)
+    {
+        event.run(POLL_INTERVAL);
+    }
+}
+
+/** @brief Send the Host perMs GetAll calls a millisecond until stop is set */
+static void runFlood(std::promise<void> ready, const std::atomic<bool>& stop,
+                     std::string objPath, uint64_t perMs)
+{
+    auto bus = sdbusplus::bus::new_default();
+    ready.set_value();
+
+    auto next = std::chrono::steady_clock::now();
+    while (!stop)
+    {
+        for (uint64_t call = 0; call < perMs; call++)
+        {
+            auto method = bus.new_method_call(
+                HOST_BUSNAME, objPath.c_str(),
+                "org.freedesktop.DBus.Properties", "GetAll");
+            method.append("xyz.openbmc_project.State.Host");
+            // Without a cookie to wait on the call goes out as no reply
+            // expected, so the flood doesn't have to read anything back
+            sd_bus_send(nullptr, method.get(), nullptr);
+        }
+        bus.flush();
+
+        next += std::chrono::milliseconds{1};
+        std::this_thread::sleep_until(next);
+    }
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
+
+using namespace phosphor::state::manager;
+
+/** @brief Print a step's latencies */
+static void report(const std::string& name, std::vector<double>& us)
+{
+    if (us.empty())
+    {
+        return;
+    }
+
+    std::sort(us.begin(), us.end());
+    std::printf("%-18s %5zu  min %9.1f  p50 %9.1f  p95 %9.1f  max %9.1f us\n",
+                name.c_str(), us.size(), us.front(), us[us.size() / 2],
+                us[(us.size() * 95) / 100], us.back());
+}
+
+int main(int argc, char** argv)
+{
+    namespace fs = std::filesystem;
+    using namespace std::chrono;
+
+    uint64_t rounds = (argc > 1) ? std::stoull(argv[1]) : 100;
+    uint64_t flood = (argc > 2) ? std::stoull(argv[2]) : 0;
+    bool shared = (argc > 3) && (std::string{argv[3]} == "shared");
+
+    char tmpl[] = "/tmp/state_manager_bench.XXXXXX";
+    fs::path dir = mkdtemp(tmpl);
+
+    // Start from nothing persisted, as a new BMC would
+    fs::remove_all(BENCH_STATE_DIR);
+    for (const auto& file :
+         {HOST_STATE_PERSIST_PATH, POH_COUNTER_PERSIST_PATH,
+          CHASSIS_STATE_CHANGE_PERSIST_PATH, STATE_JOURNAL_FILE})
+    {
+        fs::create_directories(fs::path(file).parent_path());
+    }
+
+    auto [daemon, address] = startBus(dir);
+    if (daemon < 0)
+    {
+        std::fprintf(stderr, "Could not start dbus-daemon, skipping\n");
+        fs::remove_all(dir);
+        return 77;
+    }
+
+    // Every connection, including the ones the managers make for
+    // themselves, goes to the private bus
+    setenv("DBUS_STARTER_BUS_TYPE", "system", 1);
+    setenv("DBUS_SYSTEM_BUS_ADDRESS", address.c_str(), 1);
+    setenv("DBUS_SESSION_BUS_ADDRESS", address.c_str(), 1);
+
+    auto bmcPath = std::string{BMC_OBJPATH} + '0';
+    auto chassisPath = std::string{CHASSIS_OBJPATH} + '0';
+    auto hostPath = std::string{HOST_OBJPATH} + '0';
+
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> threads;
+    auto start = [&threads](auto&& body, auto&&... args) {
+        std::promise<void> ready;
+        auto started = ready.get_future();
+        threads.emplace_back(body, std::move(ready), args...);
+        started.get();
+    };
+
+    int rc = 0;
+    try
+    {
+        // Host checks chassis power as it starts, so it goes last
+        start(runFakeSystem, std::cref(stop));
+        start(runManager<Chassis>, std::cref(stop), CHASSIS_BUSNAME,
+              chassisPath);
+        start(runManager<BMC>, std::cref(stop), BMC_BUSNAME, bmcPath);
+        start(runHost, std::cref(stop), hostPath, shared);
+
+        auto event = sdeventplus::Event::get_default();
+        auto bus = sdbusplus::bus::new_default();
+        bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
+        Driver driver{bus, event};
+
+        struct Step
+        {
+            std::string name;
+            std::function<void()> request;
+            std::string watch;
+            std::string state;
+            uint64_t changes;
+        };
+
+        auto hostRequest = [&driver, &hostPath](const char* transition) {
+            return [&driver, &hostPath, transition]() {
+                driver.set(HOST_BUSNAME, hostPath,
+                           "xyz.openbmc_project.State.Host",
+                           "RequestedHostTransition",
+                           std::string{"xyz.openbmc_project.State.Host."
+                                       "Transition."} +
+                               transition);
+            };
+        };
+        auto chassisRequest = [&driver, &chassisPath](const char* transition) {
+            return [&driver, &chassisPath, transition]() {
+                driver.set(CHASSIS_BUSNAME, chassisPath,
+                           "xyz.openbmc_project.State.Chassis",
+                           "RequestedPowerTransition",
+                           std::string{"xyz.openbmc_project.State.Chassis."
+                                       "Transition."} +
+                               transition);
+            };
+        };
+
+        constexpr auto hostOff = "xyz.openbmc_project.State.Host.HostState.Off";
+        constexpr auto hostRunning =
+            "xyz.openbmc_project.State.Host.HostState.Running";
+        constexpr auto chassisOff =
+            "xyz.openbmc_project.State.Chassis.PowerState.Off";
+        constexpr auto chassisOn =
+            "xyz.openbmc_project.State.Chassis.PowerState.On";
+
+        // The BMC only becomes ready once, everything else goes round
+        Step bmcReady{"bmc ready",
+                      [&driver]() { driver.startUnit(BMC_STANDBY_TGT); },
+                      "CurrentBMCState",
+                      "xyz.openbmc_project.State.BMC.BMCState.Ready", 1};
+        std::vector<Step> steps = {
+            {"chassis on", chassisRequest("On"), "CurrentPowerState",
+             chassisOn, 1},
+            {"chassis off", chassisRequest("Off"), "CurrentPowerState",
+             chassisOff, 1},
+            {"host on", hostRequest("On"), "CurrentHostState", hostRunning, 1},
+            {"host reboot", hostRequest("Reboot"), "CurrentHostState",
+             hostRunning, 2},
+            {"host off", hostRequest("Off"), "CurrentHostState", hostOff, 1},
+            {"bmc reboot",
+             [&driver, &bmcPath]() {
+                 driver.set(BMC_BUSNAME, bmcPath,
+                            "xyz.openbmc_project.State.BMC",
+                            "RequestedBMCTransition",
+                            "xyz.openbmc_project.State.BMC.Transition.Reboot");
+             },
+             BMC_REBOOT_TGT, "", 1}};
+
+        std::map<std::string, std::vector<double>> latencies;
+        std::map<std::string, std::vector<double>> sinceJob;
+        auto runStep = [&driver, &latencies, &sinceJob](const Step& step) {
+            auto before = driver.counts[step.watch];
+            auto begin = steady_clock::now();
+            step.request();
+            auto done = driver.waitFor([&driver, &step, before]() {
+                return (driver.counts[step.watch] >= before + step.changes) &&
+                       (step.state.empty() ||
+                        (driver.states[step.watch] == step.state));
+            });
+            if (!done)
+            {
+                throw std::runtime_error("Timed out in step " + step.name);
+            }
+            auto end = steady_clock::now();
+            latencies[step.name].push_back(
+                duration<double, std::micro>(end - begin).count());
+            if (driver.lastJobRemoved > begin)
+            {
+                sinceJob[step.name].push_back(
+                    duration<double, std::micro>(end - driver.lastJobRemoved)
+                        .count());
+            }
+        };
+
+        runStep(bmcReady);
+        if (flood != 0)
+        {
+            start(runFlood, std::cref(stop), hostPath, flood);
+        }
+
+        auto signalsBefore = driver.signalCount;
+        auto begin = steady_clock::now();
+        for (uint64_t round = 0; round < rounds; round++)
+        {
+            for (const auto& step : steps)
+            {
+                runStep(step);
+            }
+        }
+        auto elapsed = duration<double>(steady_clock::now() - begin).count();
+
+        report(bmcReady.name, latencies[bmcReady.name]);
+        for (const auto& step : steps)
+        {
+            report(step.name, latencies[step.name]);
+        }
+        if (flood != 0)
+        {
+            std::printf("flood: %llu calls/ms, %s systemd connection\n",
+                        static_cast<unsigned long long>(flood),
+                        shared ? "shared" : "separate");
+            for (const auto& step : steps)
+            {
+                report(step.name + " job", sinceJob[step.name]);
+            }
+        }
+        std::printf("signals: %llu in %.2f s, %.0f/s\n",
+                    static_cast<unsigned long long>(driver.signalCount -
+                                                    signalsBefore),
+                    elapsed, (driver.signalCount - signalsBefore) / elapsed);
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        rc = 1;
+    }
+
+    stop = true;
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    kill(daemon, SIGTERM);
+    waitpid(daemon, nullptr, 0);
+    fs::remove_all(dir);
+    fs::remove_all(BENCH_STATE_DIR);
+
+    return rc;
+}
@@ -0,0 +1,113 @@
+#include "state_snapshot.hpp"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+namespace snapshot
+{
+
+namespace fs = std::filesystem;
+
+class TestStateSnapshot : public testing::Test
+{
+  public:
+    fs::path dir;
+    std::string path;
+
+    TestStateSnapshot()
+    {
+        char tmpl[] = "/tmp/state_snapshot_test.XXXXXX";
+        dir = mkdtemp(tmpl);
+        path = (dir / "state-snapshot").string();
+    }
+
+    ~TestStateSnapshot()
+    {
+        fs::remove_all(dir);
+    }
+};
+
+TEST_F(TestStateSnapshot, noFile)
+{
+    Reader reader{path.c_str()};
+    EXPECT_FALSE(reader.valid());
+    EXPECT_FALSE(reader.read(&Snapshot::host));
+}
+
+TEST_F(TestStateSnapshot, publishAndRead)
+{
+    Writer chassisWriter{path.c_str()};
+    Writer hostWriter{path.c_str()};
+
+    Reader reader{path.c_str()};
+    ASSERT_TRUE(reader.valid());
+
+    // Nothing published yet
+    EXPECT_FALSE(reader.read(&Snapshot::chassis));
+
+    chassisWriter.publish(&Snapshot::chassis,
+                          {"xyz.openbmc_project.State.Chassis.PowerState.On",
+                           "xyz.openbmc_project.State.Chassis.PowerStatus."
+                           "Good"});
+    EXPECT_EQ(reader.value(&Snapshot::chassis, CurrentPowerState),
+              "xyz.openbmc_project.State.Chassis.PowerState.On");
+    EXPECT_EQ(reader.value(&Snapshot::chassis, CurrentPowerStatus),
+              "xyz.openbmc_project.State.Chassis.PowerStatus.Good");
+
+    // Sections are independent
+    EXPECT_FALSE(reader.read(&Snapshot::host));
+    hostWriter.publish(&Snapshot::host,
+                       {"xyz.openbmc_project.State.Host.HostState.Running", "",
+                        "", ""});
+    EXPECT_EQ(reader.value(&Snapshot::host, CurrentHostState),
+              "xyz.openbmc_project.State.Host.HostState.Running");
+    EXPECT_FALSE(reader.value(&Snapshot::host, BootProgress));
+
+    chassisWriter.publish(&Snapshot::chassis,
+                          {"xyz.openbmc_project.State.Chassis.PowerState.Off",
+                           "xyz.openbmc_project.State.Chassis.PowerStatus."
+                           "Good"});
+    EXPECT_EQ(reader.value(&Snapshot::chassis, CurrentPowerState),
+              "xyz.openbmc_project.State.Chassis.PowerState.Off");
+}
+
+TEST_F(TestStateSnapshot, longValueTruncated)
+{
+    Writer writer{path.c_str()};
+    Reader reader{path.c_str()};
+
+    writer.publish(&Snapshot::bmc, {std::string(VALUE_MAX * 2, 'x')});
+    EXPECT_EQ(reader.value(&Snapshot::bmc, CurrentBMCState),
+              std::string(VALUE_MAX - 1, 'x'));
+}
+
+TEST_F(TestStateSnapshot, otherVersionReplaced)
+{
+    {
+        std::ofstream file{path};
+        file << "not a snapshot";
+    }
+    EXPECT_FALSE(Reader{path.c_str()}.valid());
+
+    Writer writer{path.c_str()};
+    writer.publish(&Snapshot::bmc,
+                   {"xyz.openbmc_project.State.BMC.BMCState.Ready"});
+
+    Reader reader{path.c_str()};
+    EXPECT_EQ(reader.value(&Snapshot::bmc, CurrentBMCState),
+              "xyz.openbmc_project.State.BMC.BMCState.Ready");
+}
+
+} // namespace snapshot
+} // namespace manager
+} // namespace state
+} // namespace phosphor
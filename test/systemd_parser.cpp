@@ -136,3 +136,93 @@ TEST(TargetJsonParser, NotJustDefault)
                  std::invalid_argument);
     std::remove("/tmp/not_just_default_file.json");
 }
+
+TEST(TargetJsonParser, ActivationTimeBudget)
+{
+    auto budgetData = R"(
+        {
+            "targets" : {
+                "multi-user.target" : {
+                    "errorsToMonitor": ["default"],
+                    "errorToLog": "xyz.openbmc_project.State.BMC.Error.MultiUserTargetFailure",
+                    "maxDurationMs": 30000,
+                    "durationErrorToLog": "xyz.openbmc_project.State.BMC.Error.MultiUserTargetSlow"},
+                "obmc-chassis-poweron@0.target" : {
+                    "errorsToMonitor": ["default"],
+                    "errorToLog": "xyz.openbmc_project.State.Chassis.Error.PowerOnTargetFailure"}
+                }
+        }
+    )"_json;
+
+    std::FILE* tmpf = fopen("/tmp/budget_file.json", "w");
+    std::fputs(budgetData.dump().c_str(), tmpf);
+    std::fclose(tmpf);
+
+    std::vector<std::string> filePaths;
+    filePaths.push_back("/tmp/budget_file.json");
+
+    TargetErrorData targetData = parseFiles(filePaths);
+
+    targetEntry tgt = targetData["multi-user.target"];
+    EXPECT_EQ(tgt.maxDurationMs, 30000);
+    EXPECT_EQ(tgt.durationErrorToLog,
+              "xyz.openbmc_project.State.BMC.Error.MultiUserTargetSlow");
+
+    // Budget is optional
+    tgt = targetData["obmc-chassis-poweron@0.target"];
+    EXPECT_EQ(tgt.maxDurationMs, 0);
+    EXPECT_TRUE(tgt.durationErrorToLog.empty());
+
+    std::remove("/tmp/budget_file.json");
+}
+
+TEST(TargetJsonParser, MissingOrMistypedFields)
+{
+    auto parse = [](const json& data) {
+        std::FILE* tmpf = fopen("/tmp/bad_field_file.json", "w");
+        std::fputs(data.dump().c_str(), tmpf);
+        std::fclose(tmpf);
+
+        std::vector<std::string> filePaths;
+        filePaths.push_back("/tmp/bad_field_file.json");
+        return parseFiles(filePaths);
+    };
+
+    // Caught as a std::exception by a reload, which keeps the old tables
+    auto noErrorToLog = R"(
+        {
+            "targets" : {
+                "multi-user.target" : {
+                    "errorsToMonitor": ["default"]}
+                }
+        }
+    )"_json;
+    EXPECT_THROW(parse(noErrorToLog), std::invalid_argument);
+
+    auto noErrorsToMonitor = R"(
+        {
+            "targets" : {
+                "multi-user.target" : {
+                    "errorsToMonitor": [],
+                    "errorToLog": "xyz.openbmc_project.State.BMC.Error.MultiUserTargetFailure"}
+                }
+        }
+    )"_json;
+    EXPECT_THROW(parse(noErrorsToMonitor), std::invalid_argument);
+
+    auto wrongType = R"(
+        {
+            "targets" : {
+                "multi-user.target" : {
+                    "errorsToMonitor": "default",
+                    "errorToLog": "xyz.openbmc_project.State.BMC.Error.MultiUserTargetFailure"}
+                }
+        }
+    )"_json;
+    EXPECT_THROW(parse(wrongType), json::type_error);
+
+    auto noTargets = R"({"services" : []})"_json;
+    EXPECT_THROW(parse(noTargets), json::out_of_range);
+
+    std::remove("/tmp/bad_field_file.json");
+}
@@ -0,0 +1,104 @@
+#include "systemd_target_stats.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+namespace phosphor
+{
+namespace state
+{
+namespace manager
+{
+
+TEST(DurationWindow, empty)
+{
+    DurationWindow window;
+
+    EXPECT_EQ(window.count(), 0);
+    EXPECT_EQ(window.last(), 0);
+    EXPECT_EQ(window.percentile(50), 0);
+    EXPECT_EQ(window.percentile(99), 0);
+}
+
+TEST(DurationWindow, nearestRank)
+{
+    DurationWindow window;
+
+    // Out of order, the window sorts for the percentiles
+    for (uint64_t ms : {7, 3, 10, 1, 5, 9, 2, 8, 4, 6})
+    {
+        window.add(ms);
+    }
+
+    EXPECT_EQ(window.count(), 10);
+    EXPECT_EQ(window.last(), 6);
+    EXPECT_EQ(window.percentile(0), 1);
+    EXPECT_EQ(window.percentile(50), 5);
+    EXPECT_EQ(window.percentile(51), 6);
+    EXPECT_EQ(window.percentile(99), 10);
+    EXPECT_EQ(window.percentile(100), 10);
+
+    // Past 100 is 100
+    EXPECT_EQ(window.percentile(150), 10);
+}
+
+TEST(DurationWindow, wrapsAround)
+{
+    DurationWindow window;
+
+    for (uint64_t ms = 1; ms <= 100; ms++)
+    {
+        window.add(ms);
+    }
+
+    // Only the last 64, 37 to 100, count towards the percentiles
+    EXPECT_EQ(window.count(), 100);
+    EXPECT_EQ(window.last(), 100);
+    EXPECT_EQ(window.percentile(0), 37);
+    EXPECT_EQ(window.percentile(50), 68);
+    EXPECT_EQ(window.percentile(99), 100);
+
+    // A window's worth of new samples leaves none of the old ones
+    for (size_t i = 0; i < DurationWindow::maxSamples; i++)
+    {
+        window.add(1);
+    }
+    EXPECT_EQ(window.percentile(99), 1);
+    EXPECT_EQ(window.last(), 1);
+}
+
+class TestUnitStats : public testing::Test
+{
+  public:
+    sdbusplus::SdBusMock sdbusMock;
+    sdbusplus::bus::bus mockedBus = sdbusplus::get_mocked_new(&sdbusMock);
+    UnitStats stats{mockedBus, "multi-user.target"};
+};
+
+TEST_F(TestUnitStats, noResults)
+{
+    EXPECT_EQ(stats.failureRate(), 0.0);
+}
+
+TEST_F(TestUnitStats, onlyFailuresCount)
+{
+    stats.addResult("done");
+    stats.addResult("done");
+    stats.addResult("canceled");
+    stats.addResult("skipped");
+    EXPECT_EQ(stats.failureRate(), 0.0);
+
+    // Each failure result counts, out of every job
+    stats.addResult("failed");
+    stats.addResult("timeout");
+    stats.addResult("dependency");
+    stats.addResult("failed");
+    EXPECT_EQ(stats.failureRate(), 0.5);
+}
+
+} // namespace manager
+} // namespace state
+} // namespace phosphor
@@ -46,9 +46,48 @@ class TestScheduledHostTransition : public testing::Test
         return scheduledHostTransition.timer.isEnabled();
     }
 
-    void bmcTimeChange()
+    void bmcTimeChange(uint64_t wentBack = 0)
     {
-        scheduledHostTransition.handleTimeUpdates();
+        scheduledHostTransition.handleTimeUpdates(wentBack);
+    }
+
+    void learnBoot(uint64_t durationMs)
+    {
+        scheduledHostTransition.readyBy = true;
+        scheduledHostTransition.addBootSample(durationMs);
+    }
+
+    uint64_t bootEstimate()
+    {
+        return scheduledHostTransition.bootEstimateMs;
+    }
+
+    uint64_t fireTime(uint64_t time)
+    {
+        return scheduledHostTransition.fireTime(
+            scheduledHostTransition.schedule.find(time));
+    }
+
+    void queueEntry(uint64_t time, Transition trans, uint64_t period)
+    {
+        scheduledHostTransition.schedule.emplace(
+            time, ScheduledHostTransition::ScheduleEntry{trans, period});
+    }
+
+    void processSchedule()
+    {
+        scheduledHostTransition.processSchedule();
+    }
+
+    void hostOff()
+    {
+        scheduledHostTransition.hostOff();
+    }
+
+    seconds timerRemaining()
+    {
+        return duration_cast<seconds>(
+            scheduledHostTransition.timer.getRemaining());
     }
 };
 
@@ -112,6 +151,191 @@ TEST_F(TestScheduledHostTransition, bmcTimeChangeBackward)
     EXPECT_TRUE(isTimerEnabled());
 }
 
+TEST_F(TestScheduledHostTransition, queuedTransitions)
+{
+    scheduledHostTransition.scheduledTime(0);
+
+    uint64_t offTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(60)).count());
+    uint64_t onTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(120)).count());
+
+    // Queue out of order, the earliest entry is the one published
+    scheduledHostTransition.addTransition(onTime, Transition::On);
+    scheduledHostTransition.addTransition(offTime, Transition::Off);
+    EXPECT_TRUE(isTimerEnabled());
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              offTime);
+    EXPECT_EQ(scheduledHostTransition.scheduledTransition(), Transition::Off);
+
+    // Removing the earliest moves on to the next one
+    EXPECT_TRUE(scheduledHostTransition.removeTransition(offTime));
+    EXPECT_FALSE(scheduledHostTransition.removeTransition(offTime));
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(), onTime);
+    EXPECT_EQ(scheduledHostTransition.scheduledTransition(), Transition::On);
+
+    // Writing 0 clears the whole queue
+    scheduledHostTransition.scheduledTime(0);
+    EXPECT_FALSE(isTimerEnabled());
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(), 0);
+}
+
+TEST_F(TestScheduledHostTransition, recurringRebasedAfterTimeChange)
+{
+    scheduledHostTransition.scheduledTime(0);
+
+    constexpr uint64_t daily = 86400;
+    auto now = static_cast<uint64_t>(getCurrentTime().count());
+
+    // As if the clock went back three days after the entry was queued
+    queueEntry(now + 3 * daily + 60, Transition::Reboot, daily);
+    bmcTimeChange(3 * daily);
+
+    EXPECT_TRUE(isTimerEnabled());
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              now + 60);
+    EXPECT_EQ(scheduledHostTransition.scheduledTransition(),
+              Transition::Reboot);
+
+    scheduledHostTransition.scheduledTime(0);
+}
+
+TEST_F(TestScheduledHostTransition, recurringKeptWithoutClockGoingBack)
+{
+    scheduledHostTransition.scheduledTime(0);
+
+    constexpr uint64_t daily = 86400;
+    auto now = static_cast<uint64_t>(getCurrentTime().count());
+
+    // Queued days out on purpose, a restart or the clock going forward
+    // leaves it be, and going back less than a period does too
+    queueEntry(now + 3 * daily + 60, Transition::Reboot, daily);
+    bmcTimeChange();
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              now + 3 * daily + 60);
+
+    bmcTimeChange(3600);
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              now + 3 * daily + 60);
+
+    // Going back a day brings it back a day, no further
+    bmcTimeChange(daily + 3600);
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              now + 2 * daily + 60);
+
+    scheduledHostTransition.scheduledTime(0);
+}
+
+TEST_F(TestScheduledHostTransition, recurringRequeuedWhenFiredOnTime)
+{
+    scheduledHostTransition.scheduledTime(0);
+
+    constexpr uint64_t daily = 86400;
+    auto now = static_cast<uint64_t>(getCurrentTime().count());
+
+    // The timer fires right at the entry's time, it comes round again a
+    // period later
+    queueEntry(now, Transition::Off, daily);
+    processSchedule();
+
+    EXPECT_TRUE(isTimerEnabled());
+    EXPECT_EQ(scheduledHostTransition.HostTransition::scheduledTime(),
+              now + daily);
+    EXPECT_EQ(scheduledHostTransition.scheduledTransition(), Transition::Off);
+
+    scheduledHostTransition.scheduledTime(0);
+}
+
+TEST_F(TestScheduledHostTransition, recurringCollisionKept)
+{
+    scheduledHostTransition.scheduledTime(0);
+
+    constexpr uint64_t daily = 86400;
+    constexpr uint64_t weekly = 7 * daily;
+    auto now = static_cast<uint64_t>(getCurrentTime().count());
+
+    // The daily entry comes round to the weekly one's time, both stay
+    queueEntry(now, Transition::Off, daily);
+    queueEntry(now + daily, Transition::On, weekly);
+    processSchedule();
+
+    auto entries = scheduledHostTransition.getEntries();
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_EQ(std::get<0>(entries[0]), now + daily);
+    EXPECT_EQ(std::get<0>(entries[1]), now + daily);
+    EXPECT_EQ(std::get<2>(entries[0]) + std::get<2>(entries[1]),
+              daily + weekly);
+
+    scheduledHostTransition.scheduledTime(0);
+}
+
+TEST_F(TestScheduledHostTransition, readyByEstimate)
+{
+    scheduledHostTransition.scheduledTime(0);
+
+    // First sample is taken as is, later ones are weighted by 1/4
+    learnBoot(120000);
+    EXPECT_EQ(bootEstimate(), 120000);
+    learnBoot(160000);
+    EXPECT_EQ(bootEstimate(), 130000);
+
+    // A power on is requested the estimate ahead of its time
+    uint64_t onTime =
+        static_cast<uint64_t>((getCurrentTime() + seconds(3600)).count());
+    scheduledHostTransition.addTransition(onTime, Transition::On);
+    EXPECT_EQ(fireTime(onTime), onTime - 130);
+
+    // But not ahead of the entry before it
+    scheduledHostTransition.addTransition(onTime - 60, Transition::Off);
+    EXPECT_EQ(fireTime(onTime), onTime - 60);
+    EXPECT_TRUE(scheduledHostTransition.removeTransition(onTime - 60));
+
+    // Other transitions are requested at their time
+    scheduledHostTransition.scheduledTransition(Transition::Off);
+    EXPECT_EQ(fireTime(onTime), onTime);
+
+    // Switching back to a power on rearms the timer with the lead
+    scheduledHostTransition.scheduledTransition(Transition::On);
+    EXPECT_TRUE(isTimerEnabled());
+    EXPECT_LE(timerRemaining(), seconds(3600 - 130));
+
+    scheduledHostTransition.scheduledTime(0);
+}
+
+TEST_F(TestScheduledHostTransition, readyByOffOnPair)
+{
+    scheduledHostTransition.scheduledTime(0);
+    learnBoot(120000);
+
+    // The on's lead reaches back past the off, the off is still requested
+    // and the on waits for it
+    auto now = static_cast<uint64_t>(getCurrentTime().count());
+    queueEntry(now, Transition::Off, 0);
+    queueEntry(now + 60, Transition::On, 0);
+    processSchedule();
+
+    auto entries = scheduledHostTransition.getEntries();
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(std::get<0>(entries[0]), now + 60);
+    EXPECT_EQ(fireTime(now + 60), now + 60);
+
+    // Once the host is off the on is due right away
+    hostOff();
+    EXPECT_EQ(fireTime(now + 60), now - 60);
+    EXPECT_TRUE(isTimerEnabled());
+    processSchedule();
+    EXPECT_TRUE(scheduledHostTransition.getEntries().empty());
+    EXPECT_FALSE(isTimerEnabled());
+}
+
+TEST_F(TestScheduledHostTransition, invalidQueuedTime)
+{
+    uint64_t schTime =
+        static_cast<uint64_t>((getCurrentTime() - seconds(60)).count());
+    EXPECT_THROW(scheduledHostTransition.addTransition(schTime, Transition::On),
+                 InvalidTimeError);
+}
+
 } // namespace manager
 } // namespace state
 } // namespace phosphor
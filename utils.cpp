@@ -1,9 +1,15 @@
 #include "utils.hpp"
 
+#include "io_worker.hpp"
+#include "state_probes.hpp"
+
 #include <gpiod.h>
 
 #include <phosphor-logging/lg2.hpp>
 
+#include <map>
+#include <mutex>
+
 namespace phosphor
 {
 namespace state
@@ -19,6 +25,14 @@ constexpr auto MAPPER_BUSNAME = "xyz.openbmc_project.ObjectMapper";
 constexpr auto MAPPER_PATH = "/xyz/openbmc_project/object_mapper";
 constexpr auto MAPPER_INTERFACE = "xyz.openbmc_project.ObjectMapper";
 constexpr auto PROPERTY_INTERFACE = "org.freedesktop.DBus.Properties";
+constexpr auto SYSTEMD_SERVICE = "org.freedesktop.systemd1";
+constexpr auto SYSTEMD_OBJ_PATH = "/org/freedesktop/systemd1";
+constexpr auto SYSTEMD_INTERFACE = "org.freedesktop.systemd1.Manager";
+
+// Managers holding the systemd subscription, by connection. Event loops on
+// other threads subscribe too, so it's guarded.
+static std::mutex systemdSubscribersLock;
+static std::map<sd_bus*, unsigned> systemdSubscribers;
 
 std::string getService(sdbusplus::bus::bus& bus, std::string path,
                        std::string interface)
@@ -33,6 +47,7 @@ std::string getService(sdbusplus::bus::bus& bus, std::string path,
 
     try
     {
+        probes::MapperCall probe{"GetObject", path.c_str()};
         auto mapperResponseMsg = bus.call(mapper);
 
         mapperResponseMsg.read(mapperResponse);
@@ -130,6 +145,45 @@ int getGpioValue(const std::string& gpioName)
     return gpioval;
 }
 
+void subscribeToSystemdSignals(sdbusplus::bus::bus& bus)
+{
+    std::lock_guard lock{systemdSubscribersLock};
+    auto& subscribers = systemdSubscribers[bus.get()];
+    if (subscribers == 0)
+    {
+        auto method = bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
+                                          SYSTEMD_INTERFACE, "Subscribe");
+        try
+        {
+            bus.call_noreply(method);
+        }
+        catch (...)
+        {
+            systemdSubscribers.erase(bus.get());
+            throw;
+        }
+    }
+    subscribers++;
+}
+
+void unsubscribeFromSystemdSignals(sdbusplus::bus::bus& bus)
+{
+    std::lock_guard lock{systemdSubscribersLock};
+    auto subscribers = systemdSubscribers.find(bus.get());
+    if (subscribers == systemdSubscribers.end())
+    {
+        return;
+    }
+
+    if (--subscribers->second == 0)
+    {
+        systemdSubscribers.erase(subscribers);
+        auto method = bus.new_method_call(SYSTEMD_SERVICE, SYSTEMD_OBJ_PATH,
+                                          SYSTEMD_INTERFACE, "Unsubscribe");
+        bus.call_noreply(method);
+    }
+}
+
 void createError(
     sdbusplus::bus::bus& bus, const std::string& errorMsg,
     sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level errLevel)
@@ -164,6 +218,24 @@ void createError(
     }
 }
 
+void queueError(
+    const std::string& errorMsg,
+    sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level errLevel)
+{
+    io::worker().queue([errorMsg, errLevel]() {
+        // The event loop's connection can't be used off its thread
+        static thread_local auto bus = sdbusplus::bus::new_default();
+        try
+        {
+            createError(bus, errorMsg, errLevel);
+        }
+        catch (const std::exception&)
+        {
+            // createError has logged why
+        }
+    });
+}
+
 } // namespace utils
 } // namespace manager
 } // namespace state
@@ -1,8 +1,21 @@
 #pragma once
 
+#include <sys/timerfd.h>
+
 #include <sdbusplus/bus.hpp>
 #include <xyz/openbmc_project/Logging/Entry/server.hpp>
 
+#include <ctime>
+
+// Need to do this since its not exported outside of the kernel.
+// Refer : https://gist.github.com/lethean/446cea944b7441228298
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+// Needed to make sure timerfd does not misfire even though we set CANCEL_ON_SET
+#define TIME_T_MAX (time_t)((1UL << ((sizeof(time_t) << 3) - 1)) - 1)
+
 namespace phosphor
 {
 namespace state
@@ -56,6 +69,25 @@ void setProperty(sdbusplus::bus::bus& bus, const std::string& path,
  */
 int getGpioValue(const std::string& gpioName);
 
+/** @brief Subscribe to systemd signals
+ *
+ *  systemd only tracks one subscription per bus connection, so when several
+ *  managers share a connection the first call subscribes and later ones
+ *  just take a reference.
+ *
+ * @param[in] bus          - The Dbus bus object
+ */
+void subscribeToSystemdSignals(sdbusplus::bus::bus& bus);
+
+/** @brief Drop a reference taken by subscribeToSystemdSignals
+ *
+ *  Only the last reference unsubscribes, so one manager giving up on
+ *  systemd signals doesn't stop them for the others on the connection.
+ *
+ * @param[in] bus          - The Dbus bus object
+ */
+void unsubscribeFromSystemdSignals(sdbusplus::bus::bus& bus);
+
 /** @brief Create an error log
  *
  * @param[in] bus          - The Dbus bus object
@@ -66,6 +98,18 @@ void createError(
     sdbusplus::bus::bus& bus, const std::string& errorMsg,
     sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level errLevel);
 
+/** @brief Queue creating an error log on the calling thread's I/O worker
+ *
+ *  The worker has a connection of its own for it, and failures are only
+ *  logged.
+ *
+ * @param[in] errorMsg     - The error message
+ * @param[in] errLevel     - The error level
+ */
+void queueError(
+    const std::string& errorMsg,
+    sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level errLevel);
+
 } // namespace utils
 } // namespace manager
 } // namespace state